@@ -2,6 +2,8 @@ workspace("lut_gen")
 	configurations { "Debug", "Release" }
 	
 	architecture "x64"
+	-- The 256-bit Vec3d / Vec4d specializations in math/vecSimd.h need AVX.
+	vectorextensions "AVX"
 	
 	-- Debug is a strict debug mode. No optimization will be performed.
 	filter "configurations:Debug"
@@ -26,6 +28,10 @@ project("Transmittance")
 	files {
 		"src/**.**"
 	}
+	-- The benchmark has its own main().
+	removefiles {
+		"src/benchmark/**"
+	}
 	
 	vpaths {
 		["AtmosphereParameters/*"] = {
@@ -37,6 +43,18 @@ project("Transmittance")
 		["Math/*"] = {
 			"math/**.*"
 		},
+		["Output/*"] = {
+			"output/**.*"
+		},
+		["Parallel/*"] = {
+			"parallel/**.*"
+		},
+		["Profile/*"] = {
+			"profile/**.*"
+		},
+		["Service/*"] = {
+			"service/**.*"
+		},
 		["stb/*"] = { 
 			"stb/**.*",
 		},
@@ -51,3 +69,53 @@ project("Transmittance")
 		"{MKDIR} "..path.join(cwd, "precomputed")
 	}
 	postbuildmessage ("creat precomputed path")
+
+-- Times the bake stages over thread counts, texture sizes and sample counts.
+project("Benchmark")
+	kind("ConsoleApp")
+	language("C++")
+	cppdialect("C++17")
+	
+	location("build")
+	
+	targetdir("bin")
+	files {
+		"src/**.**"
+	}
+	removefiles {
+		"src/Transmittance.cpp"
+	}
+	
+	vpaths {
+		["AtmosphereParameters/*"] = {
+			"atmosphereParameters/**.*"
+		},
+		["Benchmark/*"] = {
+			"benchmark/**.*"
+		},
+		["Functions/*"] = { 
+			"functions/**.*",
+		},
+		["Math/*"] = {
+			"math/**.*"
+		},
+		["Output/*"] = {
+			"output/**.*"
+		},
+		["Parallel/*"] = {
+			"parallel/**.*"
+		},
+		["Profile/*"] = {
+			"profile/**.*"
+		},
+		["Service/*"] = {
+			"service/**.*"
+		},
+		["stb/*"] = { 
+			"stb/**.*",
+		},
+	}
+	
+	includedirs {
+		"src"
+	}
@@ -1,9 +1,36 @@
 #include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
 #include <fstream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
 
 #include "functions/functions.h"
+#include "functions/bake.h"
+#include "functions/incrementalBake.h"
+#include "functions/progressiveBake.h"
+#include "functions/sweep.h"
 #include "atmosphereParameters/model.h"
+#include "atmosphereParameters/parameterFile.h"
+#include "atmosphereParameters/shaderGenerator.h"
+#include "output/analyticFit.h"
+#include "output/embeddedHeader.h"
+#include "output/errorHistogram.h"
+#include "output/lowRank.h"
+#include "output/textureWriter.h"
+#include "profile/trace.h"
+#include "service/bakeService.h"
+#include "service/localSocket.h"
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb/stb_image_write.h"
@@ -25,7 +52,8 @@ constexpr double kSunAngularRadius = 0.00935 / 2.0;
 constexpr double kSunSolidAngle = kPi * kSunAngularRadius * kSunAngularRadius;
 constexpr double kLengthUnitInMeters = 1000.0;
 
-void InitModel() {
+Model InitModel() {
+    TRACE_SCOPE("InitModel");
     // Values from "Reference Solar Spectral Irradiance: ASTM G-173", ETR column
     // (see http://rredc.nrel.gov/solar/spectra/am1.5/ASTMG173/ASTMG173.html),
     // summed and averaged in each bin (e.g. the value for 360nm is the average
@@ -113,59 +141,844 @@ void InitModel() {
         false, false);
 
     model.PrintAtmParameter();
+    return model;
 }
 
-float data[TRANSMITTANCE_TEXTURE_WIDTH * TRANSMITTANCE_TEXTURE_HEIGHT * 3];
+// 命令行参数：Transmittance <输出路径> [--format hdr|ktx2|dds|header] [--pixel-format <格式>] [--mips <层数>]
+//             [--bc6h-quality fast|normal|high] [--precision double|float] [--integrator uniform|layered|exponential]
+//             [--samples <采样次数>] [--threads <线程数>] [--density-table] [--rayleigh-profile <文件>] [--mie-profile <文件>]
+//             [--absorption-profile <文件>] [--sweep <参数>:<起点>:<终点>:<数量>] [--pca <误差>] [--fit <误差>]
+//             [--trace <文件>] [--cost-map] [--step-budget <微秒>] [--progressive] [--error-report] [--emit-shaders]
+//             [--convergence] [--atmosphere <文件>]
+//       或 Transmittance --serve <socket 路径> [--cache-mb <MB>] [--threads <线程数>]，见 Serve
+struct BakeOptions {
+    std::string output_path;
+    std::string container = "hdr";
+    PixelFormat pixel_format = PixelFormat::RGBA16F;
+    BC6HQuality bc6h_quality = BC6HQuality::Normal;
+    // 0 表示生成完整的 mip 链
+    int mip_levels = 1;
+    // 积分使用的标量类型，float kernel 更快但有约 1e-4 的相对误差
+    bool float_kernel = false;
+    IntegratorSettings integrator;
+    // 烘焙使用的线程数，0 表示使用硬件线程数，结果与线程数无关
+    int thread_count = 0;
+    // 从文件读取的密度分布，为空时使用 kEarthAtmosphere 的分布，格式见 LoadExtendedDensityProfile
+    std::string rayleigh_profile_path;
+    std::string mie_profile_path;
+    std::string absorption_profile_path;
+    // 不为空时在这些参数轴上烘焙纹理数组，只有一个轴时为 3D 纹理，见 BakeTransmittanceSweep
+    std::vector<SweepAxis> sweep_axes;
+    // 大于 0 时将扫描结果压缩为主成分，重建的相对误差不超过该值，见 CompressLowRank
+    double pca_error = 0.0;
+    // 大于 0 时以该相对误差拟合 Chebyshev 多项式并输出求值代码，见 FitTransmittance
+    double fit_error = 0.0;
+    // 打印各紧凑格式相对于 float 数据的误差直方图，使用 float kernel 时同时打印其相对于 double kernel 的误差
+    bool error_report = false;
+    // 输出常量折叠后的 GLSL、HLSL 与 C++ 代码
+    bool emit_shaders = false;
+    // 打印各积分模式在不同采样次数下的误差
+    bool convergence = false;
+    // 不为空时记录各阶段的耗时与计数，写为 Chrome trace_event 格式的 JSON，见 WriteTrace
+    std::string trace_path;
+    // 写出每个纹素的采样点数与耗时 LUT_cost.hdr，并打印每行的开销，见 BakeTransmittanceWithKernel
+    bool cost_map = false;
+    // 大于 0 时使用 IncrementalTransmittanceBaker 分步烘焙，每步的时间预算（微秒），打印步数与最长一步的耗时
+    double step_budget = 0.0;
+    // 由粗到细烘焙，每遍的预览写为 LUT_pass<遍数>，见 BakeTransmittanceProgressive
+    bool progressive = false;
+    // 从文件读取的大气参数，为空时使用 kEarthAtmosphere，格式见 LoadAtmosphereParameters
+    std::string atmosphere_path;
+    // 不为空时作为守护进程在该 Unix domain socket 上接受烘焙请求，见 Serve
+    std::string serve_path;
+    // 守护进程缓存的 LUT 占用内存的上限
+    int cache_megabytes = 256;
+    // 只用于守护进程的请求：不写出文件，返回保存 LUT 的共享内存的名字
+    bool shared_memory = false;
+};
 
-int main(int argc, char **argv) {
-    // ʼ Model ӡ AtmosphereParameters ĳʼ
-    InitModel();
-
-    const AtmosphereParameters ATMOSPHERE = AtmosphereParameters{
-        Vec3d(1.500000, 1.500000, 1.500000),
-        0.004675,
-        6360.000000,
-        6420.000000,
-        DensityProfile{
-            DensityProfileLayer{ 0.000000, 0.000000, 0.000000, 0.000000, 0.000000 },
-            DensityProfileLayer{ 0.000000, 1.000000, -0.125000, 0.000000, 0.000000 }
-        },
-        Vec3d(0.005802, 0.013558, 0.033100),
-        DensityProfile{
-            DensityProfileLayer{ 0.000000, 0.000000, 0.000000, 0.000000, 0.000000 },
-            DensityProfileLayer{ 0.000000, 1.000000, -0.833333, 0.000000, 0.000000 }
-        },
-        Vec3d(0.003996, 0.003996, 0.003996),
-        Vec3d(0.004440, 0.004440, 0.004440),
-        0.800000,
-        DensityProfile{
-            DensityProfileLayer{ 25.000000, 0.000000, 0.000000, 0.066667, -0.666667 },
-            DensityProfileLayer{ 0.000000, 0.000000, 0.000000, -0.066667, 2.666667 }
-        },
-        Vec3d(0.000650, 0.001881, 0.000085),
-        Vec3d(0.100000, 0.100000, 0.100000),
-        -0.207912 };
-
-    // ֻ Transmittance Ϊάͼ
-    for (int i = 0; i < TRANSMITTANCE_TEXTURE_HEIGHT; i++) {
-        for (int j = 0; j < TRANSMITTANCE_TEXTURE_WIDTH; j++) {
-            const Vec2d UV = { static_cast<double>(j), static_cast<double>(i) };
-            const Vec3d trans = ComputeTransmittanceToTopAtmosphereBoundaryTexture(ATMOSPHERE, UV);
-            //std::cout << trans.x << " " << trans.y << " " << trans.z << std::endl;
-            const int pixelIndex = i * TRANSMITTANCE_TEXTURE_WIDTH + j;
-            data[pixelIndex * 3 + 0] = static_cast<float>(trans.x);
-            data[pixelIndex * 3 + 1] = static_cast<float>(trans.y);
-            data[pixelIndex * 3 + 2] = static_cast<float>(trans.z);
+// 选项错误写入 errors，守护进程把它作为回复返回给客户端
+bool ParseOptions(int argc, char **argv, BakeOptions &options, std::ostream &errors = std::cerr) {
+    if (argc < 2) {
+        errors << "Usage: Transmittance <output path> [--format hdr|ktx2|dds|header] "
+            "[--pixel-format rgba16f|rgba32f|b10g11r11f|e5b9g9r9|bc6h|rgba16log] [--mips <levels>] "
+            "[--bc6h-quality fast|normal|high] [--precision double|float] [--integrator uniform|layered|exponential] "
+            "[--samples <count>] [--threads <count>] [--density-table] [--rayleigh-profile <file>] [--mie-profile <file>] "
+            "[--absorption-profile <file>] [--sweep rayleigh|mie|absorption:<begin>:<end>:<count>] [--pca <max error>] "
+            "[--fit <max error>] [--trace <file>] [--cost-map] [--step-budget <microseconds>] [--progressive] [--error-report] "
+            "[--emit-shaders] [--convergence] [--atmosphere <file>]\n"
+            "       Transmittance --serve <socket path> [--cache-mb <megabytes>] [--threads <count>]" << std::endl;
+        return false;
+    }
+    // 守护进程没有输出路径，输出路径由每个请求给出
+    const bool serve = std::strcmp(argv[1], "--serve") == 0;
+    if (!serve) {
+        options.output_path = argv[1];
+    }
+    // 给出了纹理输出相关的选项，--pca 只写出 LUT.pca，不能与它们同时使用
+    bool texture_options = false;
+    for (int i = serve ? 1 : 2; i < argc; i += 2) {
+        // 不带参数的开关
+        if (std::strcmp(argv[i], "--error-report") == 0) {
+            options.error_report = true;
+            --i;
+            continue;
+        }
+        if (std::strcmp(argv[i], "--emit-shaders") == 0) {
+            options.emit_shaders = true;
+            --i;
+            continue;
+        }
+        if (std::strcmp(argv[i], "--density-table") == 0) {
+            options.integrator.density_table = true;
+            --i;
+            continue;
+        }
+        if (std::strcmp(argv[i], "--convergence") == 0) {
+            options.convergence = true;
+            --i;
+            continue;
+        }
+        if (std::strcmp(argv[i], "--cost-map") == 0) {
+            options.cost_map = true;
+            --i;
+            continue;
+        }
+        if (std::strcmp(argv[i], "--progressive") == 0) {
+            options.progressive = true;
+            --i;
+            continue;
+        }
+        if (std::strcmp(argv[i], "--shm") == 0) {
+            options.shared_memory = true;
+            --i;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            errors << "Missing value for " << argv[i] << std::endl;
+            return false;
+        }
+        if (std::strcmp(argv[i], "--format") == 0 || std::strcmp(argv[i], "--pixel-format") == 0 ||
+            std::strcmp(argv[i], "--mips") == 0 || std::strcmp(argv[i], "--bc6h-quality") == 0) {
+            texture_options = true;
+        }
+        if (std::strcmp(argv[i], "--format") == 0) {
+            options.container = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--pixel-format") == 0) {
+            if (!ParsePixelFormat(argv[i + 1], options.pixel_format)) {
+                errors << "Unknown pixel format " << argv[i + 1] << std::endl;
+                return false;
+            }
+        } else if (std::strcmp(argv[i], "--mips") == 0) {
+            options.mip_levels = std::atoi(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--bc6h-quality") == 0) {
+            if (!ParseBC6HQuality(argv[i + 1], options.bc6h_quality)) {
+                errors << "Unknown BC6H quality " << argv[i + 1] << std::endl;
+                return false;
+            }
+        } else if (std::strcmp(argv[i], "--precision") == 0) {
+            if (std::strcmp(argv[i + 1], "double") != 0 && std::strcmp(argv[i + 1], "float") != 0) {
+                errors << "Unknown precision " << argv[i + 1] << std::endl;
+                return false;
+            }
+            options.float_kernel = std::strcmp(argv[i + 1], "float") == 0;
+        } else if (std::strcmp(argv[i], "--integrator") == 0) {
+            if (!ParseIntegrationMode(argv[i + 1], options.integrator.mode)) {
+                errors << "Unknown integrator " << argv[i + 1] << std::endl;
+                return false;
+            }
+        } else if (std::strcmp(argv[i], "--samples") == 0) {
+            options.integrator.sample_count = std::atoi(argv[i + 1]);
+            if (options.integrator.sample_count < 1) {
+                errors << "Invalid sample count " << argv[i + 1] << std::endl;
+                return false;
+            }
+        } else if (std::strcmp(argv[i], "--threads") == 0) {
+            options.thread_count = std::atoi(argv[i + 1]);
+            if (options.thread_count < 0) {
+                errors << "Invalid thread count " << argv[i + 1] << std::endl;
+                return false;
+            }
+        } else if (std::strcmp(argv[i], "--rayleigh-profile") == 0) {
+            options.rayleigh_profile_path = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--mie-profile") == 0) {
+            options.mie_profile_path = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--absorption-profile") == 0) {
+            options.absorption_profile_path = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--sweep") == 0) {
+            SweepAxis axis;
+            if (!ParseSweepAxis(argv[i + 1], axis)) {
+                errors << "Invalid sweep axis " << argv[i + 1] << std::endl;
+                return false;
+            }
+            options.sweep_axes.push_back(axis);
+        } else if (std::strcmp(argv[i], "--fit") == 0) {
+            options.fit_error = std::atof(argv[i + 1]);
+            if (!(options.fit_error > 0.0)) {
+                errors << "Invalid fit error bound " << argv[i + 1] << std::endl;
+                return false;
+            }
+        } else if (std::strcmp(argv[i], "--step-budget") == 0) {
+            options.step_budget = std::atof(argv[i + 1]);
+            if (!(options.step_budget > 0.0)) {
+                errors << "Invalid step budget " << argv[i + 1] << std::endl;
+                return false;
+            }
+        } else if (std::strcmp(argv[i], "--atmosphere") == 0) {
+            options.atmosphere_path = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--serve") == 0) {
+            options.serve_path = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--cache-mb") == 0) {
+            options.cache_megabytes = std::atoi(argv[i + 1]);
+            if (options.cache_megabytes < 1) {
+                errors << "Invalid cache size " << argv[i + 1] << std::endl;
+                return false;
+            }
+        } else if (std::strcmp(argv[i], "--trace") == 0) {
+            options.trace_path = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--pca") == 0) {
+            options.pca_error = std::atof(argv[i + 1]);
+            if (!(options.pca_error > 0.0)) {
+                errors << "Invalid PCA error bound " << argv[i + 1] << std::endl;
+                return false;
+            }
+        } else {
+            errors << "Unknown option " << argv[i] << std::endl;
+            return false;
+        }
+    }
+    if (options.pca_error > 0.0 && options.sweep_axes.empty()) {
+        errors << "--pca compresses the slices of --sweep" << std::endl;
+        return false;
+    }
+    if (options.pca_error > 0.0 && (texture_options || options.error_report)) {
+        errors << "--pca writes only LUT.pca and cannot be combined with --format, --pixel-format, --mips, "
+            "--bc6h-quality or --error-report" << std::endl;
+        return false;
+    }
+    if (options.step_budget > 0.0 && (options.float_kernel || options.cost_map || !options.sweep_axes.empty())) {
+        errors << "--step-budget bakes the single double-precision LUT and cannot be combined with "
+            "--precision float, --cost-map or --sweep" << std::endl;
+        return false;
+    }
+    if (options.progressive && (options.step_budget > 0.0 || options.cost_map || !options.sweep_axes.empty())) {
+        errors << "--progressive bakes the single LUT and cannot be combined with --step-budget, --cost-map or --sweep"
+            << std::endl;
+        return false;
+    }
+    if (options.cost_map && !options.sweep_axes.empty()) {
+        errors << "--cost-map measures the single bake and cannot be combined with --sweep" << std::endl;
+        return false;
+    }
+    if (serve && options.serve_path.empty()) {
+        errors << "--serve needs a socket path" << std::endl;
+        return false;
+    }
+    if (options.container != "hdr" && options.container != "ktx2" && options.container != "dds" &&
+        options.container != "header") {
+        errors << "Unknown format " << options.container << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// 打印 BC6H 压缩后第 0 级的误差，用于判断该 LUT 是否可以接受 6:1 的压缩
+void ReportBC6HError(const std::string &name, const TextureImage &image, BC6HQuality quality) {
+    std::vector<float> decoded(image.texels.size());
+    const size_t slice_size = static_cast<size_t>(image.width) * image.height * 3;
+    for (int z = 0; z < image.depth; ++z) {
+        const std::vector<uint8_t> blocks = CompressBC6H(image.GetTexel(0, 0, z), image.width, image.height, quality);
+        DecompressBC6H(blocks.data(), image.width, image.height, decoded.data() + z * slice_size);
+    }
+    const BC6HErrorReport report = MeasureBC6HError(image.texels.data(), decoded.data(), image.GetTexelCount());
+    std::cout << name << " BC6H (" << GetBC6HQualityName(quality) << "): PSNR " << report.psnr
+        << " dB, RMSE " << report.rmse << ", max relative error " << report.max_relative_error << std::endl;
+}
+
+// 打印纹理编码为各紧凑格式后的相对误差直方图
+void ReportFormatErrors(const std::string &name, const TextureImage &image, BC6HQuality quality) {
+    std::vector<ErrorHistogram> histograms;
+    for (PixelFormat format : { PixelFormat::RGBA16F, PixelFormat::B10G11R11F, PixelFormat::E5B9G9R9,
+        PixelFormat::RGBA16Log, PixelFormat::BC6H }) {
+        histograms.push_back(ComputeFormatErrorHistogram(image, format, quality));
+    }
+    std::cout << name << " relative error histogram:" << std::endl;
+    PrintErrorHistograms(std::cout, histograms);
+}
+
+// 打印逐纹素结果相对于默认设置（double kernel、500 次均匀采样）的误差，用于判断是否可以使用 float kernel 或更少的采样
+void ReportKernelError(IN(AtmosphereParameters) atmosphere, const ExtendedDensityProfiles &profiles,
+    const BakeOptions &options, const TextureImage &image) {
+    const TextureImage reference = BakeTransmittance<double>(atmosphere, profiles, image.width, image.height);
+    ErrorHistogram histogram = ComputeErrorHistogram(reference.texels.data(), image.texels.data(), image.texels.size());
+    const std::string label = std::string(options.float_kernel ? "float " : "double ") +
+        (options.integrator.density_table ? "table" : GetIntegrationModeName(options.integrator.mode)) + "/" +
+        std::to_string(options.integrator.sample_count);
+    histogram.label = label.c_str();
+    std::cout << "Kernel relative error against double uniform/500:" << std::endl;
+    PrintErrorHistograms(std::cout, { histogram });
+}
+
+// 打印各积分模式及累积密度表在不同采样次数下相对于 layered/20000 的误差
+// 参考值的区间端点落在密度分布的折点上，只剩下光滑部分的 O(1/n^2) 误差
+void ReportConvergence(IN(AtmosphereParameters) atmosphere, int width, int height) {
+    const IntegratorSettings reference_settings{ IntegrationMode::LayerBounded, 20000 };
+    const TextureImage reference = BakeTransmittance<double>(atmosphere, width, height, reference_settings);
+    std::vector<std::string> labels;
+    std::vector<ErrorHistogram> histograms;
+    for (IntegrationMode mode : { IntegrationMode::Uniform, IntegrationMode::LayerBounded, IntegrationMode::Exponential }) {
+        for (int sample_count : { 25, 50, 100, 200, 500 }) {
+            const TextureImage image = BakeTransmittance<double>(atmosphere, width, height, IntegratorSettings{ mode, sample_count });
+            histograms.push_back(ComputeErrorHistogram(reference.texels.data(), image.texels.data(), image.texels.size()));
+            labels.push_back(std::string(GetIntegrationModeName(mode)) + "/" + std::to_string(sample_count));
+        }
+    }
+    // 累积密度表的积分与模式无关
+    for (int sample_count : { 25, 50, 100, 200, 500 }) {
+        const TextureImage image = BakeTransmittance<double>(atmosphere, width, height,
+            IntegratorSettings{ IntegrationMode::LayerBounded, sample_count, true });
+        histograms.push_back(ComputeErrorHistogram(reference.texels.data(), image.texels.data(), image.texels.size()));
+        labels.push_back("table/" + std::to_string(sample_count));
+    }
+    for (size_t i = 0; i < histograms.size(); ++i) {
+        histograms[i].label = labels[i].c_str();
+    }
+    std::cout << "Kernel relative error against double layered/20000:" << std::endl;
+    PrintErrorHistograms(std::cout, histograms);
+}
+
+// 由实际烘焙 LUT 的大气参数与密度分布生成，与同一次运行写出的 LUT 一致
+bool WriteSpecializedShaders(const std::string &output_path, IN(AtmosphereParameters) atmosphere,
+    const ExtendedDensityProfiles &profiles) {
+    const SpecializedAtmosphereParameters parameters = MakeSpecializedAtmosphereParameters(atmosphere, profiles);
+    const std::pair<const char *, ShaderLanguage> outputs[] = {
+        { "/atmosphere.glsl", ShaderLanguage::GLSL },
+        { "/atmosphere.hlsl", ShaderLanguage::HLSL },
+        { "/atmosphere.h", ShaderLanguage::Cpp },
+    };
+    for (const auto &output : outputs) {
+        std::ofstream file(output_path + output.first);
+        file << GenerateSpecializedShader(parameters, output.second);
+        if (!file) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 拟合透射率并输出 LUT_fit.glsl、LUT_fit.hlsl 与 LUT_fit.h，打印各子区间的次数与相对于 LUT 的误差
+bool WriteAnalyticFit(const BakeOptions &options, IN(AtmosphereParameters) atmosphere, const TextureImage &image) {
+    TRACE_SCOPE("WriteAnalyticFit");
+    AnalyticFitSettings settings;
+    settings.max_relative_error = options.fit_error;
+    const AnalyticTransmittanceFit fit = FitTransmittance(atmosphere, image, settings);
+    size_t coefficient_count = 0;
+    std::cout << "Fit: " << fit.subdomains.size() << " subdomains, degrees";
+    for (const AnalyticFitSubdomain &subdomain : fit.subdomains) {
+        std::cout << " " << subdomain.degree_mu << "x" << subdomain.degree_r;
+        coefficient_count += subdomain.coefficients.size();
+    }
+    std::cout << ", " << coefficient_count << " RGB coefficients, max relative error " << fit.max_relative_error
+        << ", mean " << fit.mean_relative_error << std::endl;
+    if (fit.max_relative_error > options.fit_error) {
+        std::cerr << "The fit does not reach " << options.fit_error << " within the degree and subdomain limits" << std::endl;
+    }
+    const std::pair<const char *, ShaderLanguage> outputs[] = {
+        { "/LUT_fit.glsl", ShaderLanguage::GLSL },
+        { "/LUT_fit.hlsl", ShaderLanguage::HLSL },
+        { "/LUT_fit.h", ShaderLanguage::Cpp },
+    };
+    for (const auto &output : outputs) {
+        std::ofstream file(options.output_path + output.first);
+        file << GenerateAnalyticFitShader(fit, output.second);
+        if (!file) {
+            std::cerr << "Failed to write " << options.output_path + output.first << std::endl;
+            return false;
         }
     }
+    return true;
+}
+
+// 记录写出的文件大小
+void CountWrittenBytes(const std::string &path) {
+    if (IsTraceCounting()) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        TRACE_COUNT(BytesWritten, std::max<std::streamoff>(file.tellg(), 0));
+    }
+}
+
+// 读取选项中给出的大气参数与密度分布，没有给出的使用 kEarthAtmosphere 的值
+bool LoadAtmosphere(const BakeOptions &options, AtmosphereParameters &atmosphere, ExtendedDensityProfiles &profiles) {
+    return LoadAtmosphere(options.atmosphere_path, options.rayleigh_profile_path, options.mie_profile_path,
+        options.absorption_profile_path, atmosphere, profiles);
+}
+
+// 按选项写出烘焙结果，ktx2 与 dds 可以直接上传到 GPU，header 输出可以直接编译进程序的 C++ 头文件
+bool WriteTexture(const BakeOptions &options, const std::string &name, const TextureImage &image,
+    IN(AtmosphereParameters) atmosphere) {
+    TRACE_SCOPE("WriteTexture");
+    if (options.container == "header") {
+        const std::string path = options.output_path + "/" + name + ".h";
+        const bool written = WriteEmbeddedHeader(path, "Transmittance", atmosphere, image);
+        CountWrittenBytes(path);
+        return written;
+    }
+    const std::string path = options.output_path + "/" + name + "." + options.container;
+    if (options.container == "hdr") {
+        TRACE_SCOPE("stbi_write_hdr");
+        if (image.depth == 1) {
+            const bool written = stbi_write_hdr(path.c_str(), image.width, image.height, 3, image.texels.data()) != 0;
+            CountWrittenBytes(path);
+            return written;
+        }
+        // hdr 只能保存二维图像，每个切片写为 <name>_<z>.hdr
+        for (int z = 0; z < image.depth; ++z) {
+            const std::string slice_path = options.output_path + "/" + name + "_" + std::to_string(z) + ".hdr";
+            if (stbi_write_hdr(slice_path.c_str(), image.width, image.height, 3, image.GetTexel(0, 0, z)) == 0) {
+                return false;
+            }
+            CountWrittenBytes(slice_path);
+        }
+        return true;
+    }
+    if (options.pixel_format == PixelFormat::BC6H) {
+        ReportBC6HError(name, image, options.bc6h_quality);
+    }
+    const std::vector<TextureImage> mips = GenerateMipChain(image, options.mip_levels);
+    const bool written = options.container == "ktx2" ?
+        WriteKTX2(path, mips, options.pixel_format, options.bc6h_quality) :
+        WriteDDS(path, mips, options.pixel_format, options.bc6h_quality);
+    CountWrittenBytes(path);
+    return written;
+}
+
+// 写出 LUT_cost.hdr 并打印每行的海拔、每个纹素的平均与最大采样点数、平均耗时及该行占总耗时的比例
+// 最后一行的比例最大与平均之比反映按行分配线程时的负载不均
+bool WriteCostMap(const BakeOptions &options, IN(AtmosphereParameters) atmosphere, const TextureImage &cost) {
+    const TransmittanceParameterization parameterization = CreateTransmittanceParameterization(atmosphere, cost.width, cost.height);
+    std::vector<double> row_times(cost.height, 0.0);
+    double total_time = 0.0;
+    double total_samples = 0.0;
+    for (int y = 0; y < cost.height; ++y) {
+        for (int x = 0; x < cost.width; ++x) {
+            row_times[y] += cost.GetTexel(x, y)[1];
+            total_samples += cost.GetTexel(x, y)[0];
+        }
+        total_time += row_times[y];
+    }
+    std::cout << "row altitude_km mean_samples max_samples mean_us time_share" << std::endl;
+    char line[128];
+    for (int y = 0; y < cost.height; ++y) {
+        double samples = 0.0;
+        float max_samples = 0.0f;
+        for (int x = 0; x < cost.width; ++x) {
+            samples += cost.GetTexel(x, y)[0];
+            max_samples = std::max(max_samples, cost.GetTexel(x, y)[0]);
+        }
+        std::snprintf(line, sizeof(line), "%3d %11.3f %12.1f %11.0f %7.3f %9.2f%%", y,
+            parameterization.rows[y].r - atmosphere.bottom_radius, samples / cost.width, max_samples,
+            row_times[y] / cost.width * 1e-3, total_time > 0.0 ? 100.0 * row_times[y] / total_time : 0.0);
+        std::cout << line << std::endl;
+    }
+    const double max_row_time = *std::max_element(row_times.begin(), row_times.end());
+    std::cout << "Cost: " << total_samples / (static_cast<double>(cost.width) * cost.height) << " samples and "
+        << total_time / (static_cast<double>(cost.width) * cost.height) * 1e-3 << " us per texel, slowest row "
+        << (total_time > 0.0 ? max_row_time * cost.height / total_time : 0.0) << "x the mean" << std::endl;
+    // 与 LUT 的容器无关，总是写为 hdr，便于直接查看
+    const std::string path = options.output_path + "/LUT_cost.hdr";
+    if (stbi_write_hdr(path.c_str(), cost.width, cost.height, 3, cost.texels.data()) == 0) {
+        std::cerr << "Failed to write " << path << std::endl;
+        return false;
+    }
+    CountWrittenBytes(path);
+    return true;
+}
+
+// 以 options.step_budget 为每步的预算分步烘焙，模拟运行时每帧调用一次 Step
+TextureImage BakeIncrementally(const BakeOptions &options, IN(AtmosphereParameters) atmosphere,
+    const ExtendedDensityProfiles &profiles) {
+    IncrementalTransmittanceBaker baker(TRANSMITTANCE_TEXTURE_WIDTH, TRANSMITTANCE_TEXTURE_HEIGHT, options.integrator);
+    baker.Restart(atmosphere, profiles);
+    int step_count = 0;
+    double longest_step = 0.0;
+    bool done = false;
+    while (!done) {
+        const auto begin = std::chrono::steady_clock::now();
+        done = baker.Step(options.step_budget);
+        longest_step = std::max(longest_step,
+            std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count());
+        ++step_count;
+    }
+    std::cout << "Incremental: " << step_count << " steps of " << options.step_budget << " us, longest step "
+        << longest_step << " us" << std::endl;
+    return *baker.GetCurrent();
+}
+
+// 由粗到细烘焙，除最后一遍外每遍的预览写为 LUT_pass<遍数>，打印每遍的网格、采样次数、计算的纹素数与耗时
+bool BakeProgressively(const BakeOptions &options, IN(AtmosphereParameters) atmosphere,
+    const ExtendedDensityProfiles &profiles, TextureImage &transmittance) {
+    bool written = true;
+    auto publish = [&](const ProgressiveBakePass &pass, const TextureImage &image) {
+        std::cout << "Pass " << pass.index << ": 1/" << pass.stride << " grid, "
+            << GetIntegrationModeName(pass.settings.mode) << "/" << pass.settings.sample_count << ", "
+            << pass.computed_texels << " texels in " << pass.milliseconds << " ms" << std::endl;
+        if (!pass.final && !WriteTexture(options, "LUT_pass" + std::to_string(pass.index), image, atmosphere)) {
+            std::cerr << "Failed to write pass " << pass.index << " to " << options.output_path << std::endl;
+            written = false;
+        }
+    };
+    transmittance = options.float_kernel ?
+        BakeTransmittanceProgressive<float>(atmosphere, profiles, TRANSMITTANCE_TEXTURE_WIDTH, TRANSMITTANCE_TEXTURE_HEIGHT,
+            options.integrator, options.thread_count, publish) :
+        BakeTransmittanceProgressive<double>(atmosphere, profiles, TRANSMITTANCE_TEXTURE_WIDTH, TRANSMITTANCE_TEXTURE_HEIGHT,
+            options.integrator, options.thread_count, publish);
+    return written;
+}
+
+// 打印各切片对应的参数，第一个轴变化最快
+void PrintSweepSlices(const std::vector<SweepAxis> &axes) {
+    const int slice_count = GetSweepSliceCount(axes);
+    for (int z = 0; z < slice_count; ++z) {
+        std::cout << "slice " << z << ":";
+        int index = z;
+        for (const SweepAxis &axis : axes) {
+            std::cout << " " << GetSweepParameterName(axis.parameter) << " x" << axis.GetValue(index % axis.count);
+            index /= axis.count;
+        }
+        std::cout << std::endl;
+    }
+}
+
+// 将扫描的各切片压缩为主成分并写出 LUT.pca，打印压缩率与所有切片重建后的误差
+bool WriteLowRankSweep(const BakeOptions &options, const TextureImage &family) {
+    TRACE_SCOPE("WriteLowRankSweep");
+    const LowRankTexture texture = CompressLowRank(family, options.pca_error, 0, options.thread_count);
+    std::vector<float> reconstructed(family.texels.size());
+    const size_t slice_size = texture.GetValueCount();
+    for (int z = 0; z < family.depth; ++z) {
+        ReconstructLowRank(texture, texture.coefficients.data() + static_cast<size_t>(z) * texture.rank,
+            reconstructed.data() + z * slice_size);
+    }
+    ErrorHistogram histogram = ComputeErrorHistogram(family.texels.data(), reconstructed.data(), reconstructed.size());
+    const std::string label = "pca/" + std::to_string(texture.rank);
+    histogram.label = label.c_str();
+    std::cout << "PCA: rank " << texture.rank << " for " << texture.variant_count << " slices, "
+        << texture.GetStorageSize() << " floats instead of " << family.texels.size() << " ("
+        << static_cast<double>(family.texels.size()) / texture.GetStorageSize() << "x)" << std::endl;
+    PrintErrorHistograms(std::cout, { histogram });
+    const std::string path = options.output_path + "/LUT.pca";
+    if (!WriteLowRankTexture(path, texture)) {
+        std::cerr << "Failed to write " << path << std::endl;
+        return false;
+    }
+    // 读回 LUT.pca，按运行时的两种方式重建每个切片，应与内存中的重建逐位相同
+    LowRankTexture read_back;
+    if (!ReadLowRankTexture(path, read_back)) {
+        return false;
+    }
+    std::vector<float> weights(read_back.variant_count, 0.0f);
+    std::vector<float> blended(slice_size);
+    for (int z = 0; z < family.depth; ++z) {
+        const float *expected = reconstructed.data() + z * slice_size;
+        const TextureImage variant = ReconstructLowRankVariant(read_back, z);
+        weights[z] = 1.0f;
+        ReconstructLowRank(read_back, BlendLowRankCoefficients(read_back, weights).data(), blended.data());
+        weights[z] = 0.0f;
+        if (std::memcmp(variant.texels.data(), expected, slice_size * sizeof(float)) != 0 ||
+            std::memcmp(blended.data(), expected, slice_size * sizeof(float)) != 0) {
+            std::cerr << path << " does not reconstruct slice " << z << " as written" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// 在 options.sweep_axes 张成的参数网格上烘焙并写出 LUT，指定 --pca 时写出压缩后的 LUT.pca
+bool BakeSweep(const BakeOptions &options, IN(AtmosphereParameters) atmosphere, const ExtendedDensityProfiles &profiles) {
+    const TextureImage transmittance = options.float_kernel ?
+        BakeTransmittanceSweep<float>(atmosphere, profiles, TRANSMITTANCE_TEXTURE_WIDTH, TRANSMITTANCE_TEXTURE_HEIGHT,
+            options.sweep_axes, options.integrator, options.thread_count) :
+        BakeTransmittanceSweep<double>(atmosphere, profiles, TRANSMITTANCE_TEXTURE_WIDTH, TRANSMITTANCE_TEXTURE_HEIGHT,
+            options.sweep_axes, options.integrator, options.thread_count);
+    PrintSweepSlices(options.sweep_axes);
+    if (options.pca_error > 0.0) {
+        return WriteLowRankSweep(options, transmittance);
+    }
+    if (options.error_report) {
+        ReportFormatErrors("LUT", transmittance, options.bc6h_quality);
+    }
+    if (!WriteTexture(options, "LUT", transmittance, atmosphere)) {
+        std::cerr << "Failed to write LUT to " << options.output_path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int Run(const BakeOptions &options) {
+    if (options.shared_memory) {
+        std::cerr << "--shm is only valid in requests sent to Transmittance --serve" << std::endl;
+        return 1;
+    }
+    // 初始化 Model 并打印 AtmosphereParameters 的初始化参数
+    const Model model = InitModel();
+
+    AtmosphereParameters base_atmosphere;
+    ExtendedDensityProfiles profiles;
+    if (!LoadAtmosphere(options, base_atmosphere, profiles)) {
+        return 1;
+    }
+    // 生成的代码只能表示两层的解析分布，不能与 LUT 一致时不写出
+    if (options.emit_shaders && (!FitsInDensityProfile(profiles.rayleigh) || !FitsInDensityProfile(profiles.mie) ||
+        !FitsInDensityProfile(profiles.absorption))) {
+        std::cerr << "Specialized shaders need density profiles with at most two layers and no table" << std::endl;
+        return 1;
+    }
+    if (options.emit_shaders && !WriteSpecializedShaders(options.output_path, base_atmosphere, profiles)) {
+        std::cerr << "Failed to write specialized shaders to " << options.output_path << std::endl;
+        return 1;
+    }
+    // 超过两层或表格形式的分布无法写入 AtmosphereParameters，嵌入头文件中仍是默认的分布
+    AtmosphereParameters atmosphere = base_atmosphere;
+    if (!ApplyExtendedDensityProfiles(profiles, atmosphere) && options.container == "header") {
+        std::cerr << "Density profiles do not fit in two layers, LUT.h keeps the default AtmosphereParameters profiles" << std::endl;
+    }
+
+    if (!options.sweep_axes.empty()) {
+        return BakeSweep(options, atmosphere, profiles) ? 0 : 1;
+    }
+
+    // 只计算 Transmittance 并将结果保存为二维的贴图
+    TextureImage cost;
+    if (options.cost_map) {
+        StartTraceCounters();
+    }
+    TextureImage *cost_output = options.cost_map ? &cost : nullptr;
+    TextureImage progressive;
+    if (options.progressive && !BakeProgressively(options, base_atmosphere, profiles, progressive)) {
+        return 1;
+    }
+    const TextureImage transmittance = options.progressive ? std::move(progressive) :
+        options.step_budget > 0.0 ?
+        BakeIncrementally(options, base_atmosphere, profiles) :
+        options.float_kernel ?
+        BakeTransmittance<float>(base_atmosphere, profiles, TRANSMITTANCE_TEXTURE_WIDTH, TRANSMITTANCE_TEXTURE_HEIGHT,
+            options.integrator, options.thread_count, cost_output) :
+        BakeTransmittance<double>(base_atmosphere, profiles, TRANSMITTANCE_TEXTURE_WIDTH, TRANSMITTANCE_TEXTURE_HEIGHT,
+            options.integrator, options.thread_count, cost_output);
+    if (options.cost_map && !WriteCostMap(options, base_atmosphere, cost)) {
+        return 1;
+    }
+    const bool default_kernel = !options.float_kernel && options.integrator.mode == IntegrationMode::Uniform &&
+        options.integrator.sample_count == IntegratorSettings().sample_count && !options.integrator.density_table;
+    if (!default_kernel && options.error_report) {
+        ReportKernelError(base_atmosphere, profiles, options, transmittance);
+    }
+    if (options.convergence) {
+        ReportConvergence(base_atmosphere, TRANSMITTANCE_TEXTURE_WIDTH, TRANSMITTANCE_TEXTURE_HEIGHT);
+    }
+    if (options.fit_error > 0.0 && !WriteAnalyticFit(options, base_atmosphere, transmittance)) {
+        return 1;
+    }
+    // 与输出容器无关，hdr 与 header 也打印各紧凑格式的误差
+    if (options.error_report) {
+        ReportFormatErrors("LUT", transmittance, options.bc6h_quality);
+    }
     //stbi_flip_vertically_on_write(true);
-    std::string outPutPath(argv[1]);
-    outPutPath += "/LUT.hdr";
-    stbi_write_hdr(outPutPath.c_str(), TRANSMITTANCE_TEXTURE_WIDTH, TRANSMITTANCE_TEXTURE_HEIGHT, 3, data);
+    if (!WriteTexture(options, "LUT", transmittance, atmosphere)) {
+        std::cerr << "Failed to write LUT to " << options.output_path << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+// 处理发送给守护进程的一行请求并返回回复，请求的参数与命令行相同，第一个为输出路径，以空白分隔（路径中不能有空格）
+// 只支持单张 LUT 的烘焙与写出，烘焙使用守护进程的线程数；带 --shm 时不写出文件而返回共享内存的名字
+// 回复为一行：ok file <路径> <来源>、ok shm <名字> <宽> <高> <来源> 或 error <原因>，来源见 BakeServiceSource
+std::string HandleServiceRequest(const std::string &request, BakeService &service) {
+    std::istringstream stream(request);
+    std::vector<std::string> arguments = { "Transmittance" };
+    std::string argument;
+    while (stream >> argument) {
+        arguments.push_back(argument);
+    }
+    std::vector<char *> argv;
+    for (std::string &value : arguments) {
+        argv.push_back(&value[0]);
+    }
+    BakeOptions options;
+    if (arguments.size() < 2 || arguments[1] == "--serve") {
+        return "error invalid request\n";
+    }
+    std::ostringstream errors;
+    if (!ParseOptions(static_cast<int>(argv.size()), argv.data(), options, errors)) {
+        // 回复只有一行
+        std::string message = errors.str();
+        while (!message.empty() && message.back() == '\n') {
+            message.pop_back();
+        }
+        std::replace(message.begin(), message.end(), '\n', ' ');
+        return "error " + (message.empty() ? std::string("invalid request") : message) + "\n";
+    }
+    if (!options.sweep_axes.empty() || options.fit_error > 0.0 || !options.trace_path.empty() || options.cost_map ||
+        options.step_budget > 0.0 || options.progressive || options.error_report || options.emit_shaders ||
+        options.convergence) {
+        return "error the service only bakes and writes a single LUT\n";
+    }
+    BakeServiceInputs inputs;
+    if (!LoadAtmosphere(options, inputs.atmosphere, inputs.profiles)) {
+        return "error failed to load the atmosphere or density profiles\n";
+    }
+    inputs.width = TRANSMITTANCE_TEXTURE_WIDTH;
+    inputs.height = TRANSMITTANCE_TEXTURE_HEIGHT;
+    inputs.settings = options.integrator;
+    inputs.float_kernel = options.float_kernel;
+    BakeServiceSource source;
+    std::shared_ptr<const CachedTransmittance> lut;
+    try {
+        lut = service.Get(inputs, source);
+    } catch (const std::exception &e) {
+        return std::string("error bake failed: ") + e.what() + "\n";
+    } catch (...) {
+        return "error bake failed\n";
+    }
+    const std::string source_name = GetBakeServiceSourceName(source);
+    if (options.shared_memory) {
+        std::string name;
+        if (!service.GetSharedMemory(lut, name)) {
+            return "error failed to create shared memory\n";
+        }
+        return "ok shm " + name + " " + std::to_string(lut->image.width) + " " + std::to_string(lut->image.height) + " " +
+            source_name + "\n";
+    }
+    // 与 Run 相同，嵌入头文件中写入能表示为两层的密度分布
+    AtmosphereParameters atmosphere = inputs.atmosphere;
+    ApplyExtendedDensityProfiles(inputs.profiles, atmosphere);
+    // 输出路径相同的请求可能同时写出，先写到本请求的临时文件再替换，读者不会看到写了一半的文件
+    static std::atomic<int> next_temporary{ 0 };
+    const std::string temporary_name = "LUT.partial" + std::to_string(next_temporary++);
+    const std::string extension = options.container == "header" ? "h" : options.container;
+    const std::string temporary_path = options.output_path + "/" + temporary_name + "." + extension;
+    const std::string path = options.output_path + "/LUT." + extension;
+    if (!WriteTexture(options, temporary_name, lut->image, atmosphere)) {
+        std::remove(temporary_path.c_str());
+        return "error failed to write LUT to " + options.output_path + "\n";
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary_path, path, error);
+    if (error) {
+        std::remove(temporary_path.c_str());
+        return "error failed to replace " + path + "\n";
+    }
+    return "ok file " + path + " " + source_name + "\n";
+}
 
+// 作为守护进程在 options.serve_path 上接受请求，每个连接在单独的线程上处理，一个连接可以依次发送多个请求
+// 请求为 stats 时回复统计，为 shutdown 时关闭所有连接（正在处理的请求仍会完成并回复），等待处理线程结束后退出
+int Serve(const BakeOptions &options) {
+    LocalSocketServer server;
+    if (!server.Listen(options.serve_path)) {
+        std::cerr << "Failed to listen on " << options.serve_path << std::endl;
+        return 1;
+    }
+    BakeService service(static_cast<size_t>(options.cache_megabytes) << 20, options.thread_count);
+    std::atomic<bool> stopping{ false };
+    std::mutex mutex;
+    std::condition_variable finished;
+    int active = 0;
+    // 打开的连接，退出时关闭，否则保持连接但不再发送请求的客户端会使其处理线程一直阻塞在 ReadLine 中
+    std::set<LocalConnection *> connections;
+    auto serve_connection = [&](LocalConnection &connection) {
+        std::string request;
+        while (connection.ReadLine(request)) {
+            std::string reply;
+            if (request == "stats") {
+                const BakeServiceStats stats = service.GetStats();
+                reply = "ok stats requests " + std::to_string(stats.requests) + " bakes " + std::to_string(stats.bakes) +
+                    " coalesced " + std::to_string(stats.coalesced) + " cached " + std::to_string(stats.cache_hits) +
+                    " evictions " + std::to_string(stats.evictions) + " luts " + std::to_string(stats.cached_luts) +
+                    " bytes " + std::to_string(stats.cached_bytes) + "\n";
+            } else if (request == "shutdown") {
+                stopping = true;
+                reply = "ok shutdown\n";
+            } else {
+                reply = HandleServiceRequest(request, service);
+            }
+            if (!connection.Write(reply) || stopping) {
+                break;
+            }
+        }
+    };
+    std::cout << "Serving on " << options.serve_path << std::endl;
+    while (!stopping) {
+        LocalConnection connection = server.Accept();
+        if (!connection.IsValid() || stopping) {
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++active;
+        }
+        std::thread([&, connection = std::move(connection)]() mutable {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                connections.insert(&connection);
+                // 主线程可能已经关闭了其他连接
+                if (stopping) {
+                    connection.Shutdown();
+                }
+            }
+            serve_connection(connection);
+            if (stopping) {
+                // 唤醒阻塞在 Accept 上的主线程
+                ConnectLocalSocket(options.serve_path);
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            connections.erase(&connection);
+            --active;
+            finished.notify_all();
+        }).detach();
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (LocalConnection *connection : connections) {
+            connection->Shutdown();
+        }
+        finished.wait(lock, [&]() { return active == 0; });
+    }
+    server.Close();
+    const BakeServiceStats stats = service.GetStats();
+    std::cout << "Served " << stats.requests << " requests: " << stats.bakes << " bakes, " << stats.coalesced
+        << " coalesced, " << stats.cache_hits << " cached, " << stats.evictions << " evictions" << std::endl;
     return 0;
 }
 
+int main(int argc, char **argv) {
+    BakeOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        return 1;
+    }
+    if (!options.serve_path.empty()) {
+        return Serve(options);
+    }
+    if (options.trace_path.empty()) {
+        return Run(options);
+    }
+    StartTrace();
+    const int result = Run(options);
+    std::cout << "Trace:";
+    for (TraceCounter counter : { TraceCounter::Samples, TraceCounter::ExpCalls, TraceCounter::Texels,
+        TraceCounter::BytesWritten }) {
+        std::cout << " " << GetTraceCounterName(counter) << " " << GetTraceCount(counter);
+    }
+    std::cout << std::endl;
+    if (!WriteTrace(options.trace_path)) {
+        std::cerr << "Failed to write trace to " << options.trace_path << std::endl;
+        return 1;
+    }
+    return result;
+}
+
 /*
 const AtmosphereParameters ATMOSPHERE = AtmosphereParameters(
 vec3(1.500000,1.500000,1.500000),
@@ -0,0 +1,179 @@
+#include "densityProfile.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+namespace {
+
+// 与 GetLayerDensity 相同
+double GetLayerDensity(const DensityProfileLayer &layer, double altitude) {
+    const double density = layer.exp_term * std::exp(layer.exp_scale * altitude) +
+        layer.linear_term * altitude + layer.constant_term;
+    return std::clamp(density, 0.0, 1.0);
+}
+
+double GetTabulatedDensity(const TabulatedDensityProfile &table, double altitude) {
+    const std::vector<double> &h = table.altitudes;
+    if (h.empty() || altitude < h.front() || altitude > h.back()) {
+        return 0.0;
+    }
+    const size_t i = std::upper_bound(h.begin(), h.end(), altitude) - h.begin();
+    if (i == h.size()) {
+        return table.densities.back();
+    }
+    const double u = (altitude - h[i - 1]) / (h[i] - h[i - 1]);
+    return table.densities[i - 1] * (1.0 - u) + table.densities[i] * u;
+}
+
+// 分段线性函数的积分是精确的
+double IntegrateTabulatedDensity(const TabulatedDensityProfile &table, double begin, double end) {
+    const std::vector<double> &h = table.altitudes;
+    double result = 0.0;
+    for (size_t i = 0; i + 1 < h.size(); ++i) {
+        const double a = std::max(begin, h[i]);
+        const double b = std::min(end, h[i + 1]);
+        if (a < b) {
+            result += (GetTabulatedDensity(table, a) + GetTabulatedDensity(table, b)) * 0.5 * (b - a);
+        }
+    }
+    return result;
+}
+
+// 每层内部是光滑的，使用 8 个子区间的 Simpson 法则；构建累积密度表时每次积分的区间只有一个单元格长
+double IntegrateLayer(const DensityProfileLayer &layer, double begin, double end) {
+    constexpr int kIntervalCount = 8;
+    const double dx = (end - begin) / kIntervalCount;
+    double result = GetLayerDensity(layer, begin) + GetLayerDensity(layer, end);
+    for (int i = 1; i < kIntervalCount; ++i) {
+        result += GetLayerDensity(layer, begin + i * dx) * (i % 2 == 1 ? 4.0 : 2.0);
+    }
+    return result * dx / 3.0;
+}
+
+} // namespace
+
+ExtendedDensityProfile MakeExtendedDensityProfile(const DensityProfile &profile) {
+    ExtendedDensityProfile result;
+    result.layers.assign(std::begin(profile.layers), std::end(profile.layers));
+    return result;
+}
+
+ExtendedDensityProfiles GetExtendedDensityProfiles(const AtmosphereParameters &atmosphere) {
+    return ExtendedDensityProfiles{
+        MakeExtendedDensityProfile(atmosphere.rayleigh_density),
+        MakeExtendedDensityProfile(atmosphere.mie_density),
+        MakeExtendedDensityProfile(atmosphere.absorption_density) };
+}
+
+bool FitsInDensityProfile(const ExtendedDensityProfile &profile) {
+    return profile.table.altitudes.empty() && profile.layers.size() <= 2;
+}
+
+DensityProfile ToDensityProfile(const ExtendedDensityProfile &profile) {
+    assert(FitsInDensityProfile(profile));
+    std::vector<DensityProfileLayer> layers = profile.layers;
+    while (layers.size() < 2) {
+        layers.insert(layers.begin(), DensityProfileLayer());
+    }
+    return DensityProfile{ { layers[0], layers[1] } };
+}
+
+bool ApplyExtendedDensityProfiles(const ExtendedDensityProfiles &profiles, AtmosphereParameters &atmosphere) {
+    if (!FitsInDensityProfile(profiles.rayleigh) || !FitsInDensityProfile(profiles.mie) ||
+        !FitsInDensityProfile(profiles.absorption)) {
+        return false;
+    }
+    atmosphere.rayleigh_density = ToDensityProfile(profiles.rayleigh);
+    atmosphere.mie_density = ToDensityProfile(profiles.mie);
+    atmosphere.absorption_density = ToDensityProfile(profiles.absorption);
+    return true;
+}
+
+double GetExtendedProfileDensity(const ExtendedDensityProfile &profile, double altitude) {
+    if (!profile.table.altitudes.empty()) {
+        return GetTabulatedDensity(profile.table, altitude);
+    }
+    double layer_end = 0.0;
+    for (size_t i = 0; i + 1 < profile.layers.size(); ++i) {
+        layer_end += profile.layers[i].width;
+        if (altitude < layer_end) {
+            return GetLayerDensity(profile.layers[i], altitude);
+        }
+    }
+    return profile.layers.empty() ? 0.0 : GetLayerDensity(profile.layers.back(), altitude);
+}
+
+double IntegrateExtendedProfileDensity(const ExtendedDensityProfile &profile, double begin, double end) {
+    if (!profile.table.altitudes.empty()) {
+        return IntegrateTabulatedDensity(profile.table, begin, end);
+    }
+    // 在层的分界处拆开
+    constexpr double kInfinity = std::numeric_limits<double>::infinity();
+    double result = 0.0;
+    double layer_begin = -kInfinity;
+    for (size_t i = 0; i < profile.layers.size(); ++i) {
+        const double layer_end = i + 1 < profile.layers.size() ?
+            std::max(layer_begin, 0.0) + profile.layers[i].width : kInfinity;
+        const double a = std::max(begin, layer_begin);
+        const double b = std::min(end, layer_end);
+        if (a < b) {
+            result += IntegrateLayer(profile.layers[i], a, b);
+        }
+        layer_begin = layer_end;
+    }
+    return result;
+}
+
+void GetExtendedProfileRange(const ExtendedDensityProfile &profile, double max_altitude, double &begin, double &end) {
+    begin = 0.0;
+    end = max_altitude;
+    if (!profile.table.altitudes.empty()) {
+        begin = std::clamp(profile.table.altitudes.front(), 0.0, max_altitude);
+        end = std::clamp(profile.table.altitudes.back(), begin, max_altitude);
+    }
+}
+
+bool LoadExtendedDensityProfile(const std::string &path, ExtendedDensityProfile &profile) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Failed to open density profile " << path << std::endl;
+        return false;
+    }
+    ExtendedDensityProfile result;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream stream(line);
+        std::vector<double> values;
+        double value;
+        while (stream >> value) {
+            values.push_back(value);
+        }
+        if (values.size() == 2 && result.layers.empty()) {
+            if (!result.table.altitudes.empty() && values[0] <= result.table.altitudes.back()) {
+                std::cerr << path << ": altitudes must be increasing" << std::endl;
+                return false;
+            }
+            result.table.altitudes.push_back(values[0]);
+            result.table.densities.push_back(std::clamp(values[1], 0.0, 1.0));
+        } else if (values.size() == 5 && result.table.altitudes.empty()) {
+            result.layers.push_back(DensityProfileLayer{ values[0], values[1], values[2], values[3], values[4] });
+        } else if (!values.empty()) {
+            std::cerr << path << ": expected \"altitude density\" or \"width exp_term exp_scale linear_term constant_term\" in every line" << std::endl;
+            return false;
+        }
+    }
+    if (result.table.altitudes.size() == 1 || (result.table.altitudes.empty() && result.layers.empty())) {
+        std::cerr << path << ": a density profile needs at least one layer or two samples" << std::endl;
+        return false;
+    }
+    profile = result;
+    return true;
+}
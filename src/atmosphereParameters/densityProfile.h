@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "definitions.h"
+
+// 由 (海拔, 密度) 样本定义的密度分布，例如探空或激光雷达的测量数据
+// 样本按海拔递增排列，样本之间线性插值，第一个样本以下与最后一个样本以上密度为 0
+struct TabulatedDensityProfile {
+    std::vector<double> altitudes;
+    std::vector<double> densities;
+};
+
+// 不限层数的密度分布，规则与 DensityProfile 相同：
+// 各层从下到上叠加，第 i 层位于 [前 i 层的宽度之和, 前 i + 1 层的宽度之和)，最后一层延伸到大气顶部
+// table 不为空时使用表格形式的分布，忽略 layers
+struct ExtendedDensityProfile {
+    std::vector<DensityProfileLayer> layers;
+    TabulatedDensityProfile table;
+};
+
+// 三种粒子的密度分布，长度单位与 AtmosphereParameters 相同
+struct ExtendedDensityProfiles {
+    ExtendedDensityProfile rayleigh;
+    ExtendedDensityProfile mie;
+    ExtendedDensityProfile absorption;
+};
+
+ExtendedDensityProfile MakeExtendedDensityProfile(const DensityProfile &profile);
+
+ExtendedDensityProfiles GetExtendedDensityProfiles(const AtmosphereParameters &atmosphere);
+
+// 不是表格且不超过两层时可以表示为 DensityProfile，不足两层时与 Model 一样在前面补宽度为 0 的空层
+bool FitsInDensityProfile(const ExtendedDensityProfile &profile);
+DensityProfile ToDensityProfile(const ExtendedDensityProfile &profile);
+
+// 三种分布都可以表示为 DensityProfile 时写入 atmosphere 并返回 true
+bool ApplyExtendedDensityProfiles(const ExtendedDensityProfiles &profiles, AtmosphereParameters &atmosphere);
+
+double GetExtendedProfileDensity(const ExtendedDensityProfile &profile, double altitude);
+
+// 密度在海拔 [begin, end] 上的积分，表格分布按分段线性精确计算，解析分布在各层内使用 Simpson 法则
+double IntegrateExtendedProfileDensity(const ExtendedDensityProfile &profile, double begin, double end);
+
+// 海拔在 [begin, end] 之外时密度为 0 的范围，begin 不低于 0，end 不高于 max_altitude
+void GetExtendedProfileRange(const ExtendedDensityProfile &profile, double max_altitude, double &begin, double &end);
+
+// 读取文本格式的密度分布，# 开头的行为注释：
+// 每行两个数为表格样本 "海拔 密度"，每行五个数为一层 "width exp_term exp_scale linear_term constant_term"
+// 两种格式不能混用，长度单位与 AtmosphereParameters 相同
+bool LoadExtendedDensityProfile(const std::string &path, ExtendedDensityProfile &profile);
@@ -1,7 +1,9 @@
 #include "model.h"
 
-// ʹĿ겨wavelengthвwavelengthsƥӦݣwavelength_function
-// TODO̫鷳ˣֻRGBͷð׹Ⱦ޳
+#include "profile/trace.h"
+
+// 使用目标波长（wavelength）在所有波长（wavelengths）中匹配对应的数据（wavelength_function）
+// TODO：太麻烦了，我们只用RGB，回头得把这套光谱渲染剔除掉
 double Interpolate(
     const std::vector<double> &wavelengths,
     const std::vector<double> &wavelength_function,
@@ -12,7 +14,7 @@ double Interpolate(
     }
     for (unsigned int i = 0; i < wavelengths.size() - 1; ++i) {
         if (wavelength < wavelengths[i + 1]) {
-            // ȫױwavelengthsĬ 10nm ΪλԾĲڱֵ
+            // 全光谱表（wavelengths）默认以 10nm 为单位步进，这里以具体的波长在表中做插值
             double u = (wavelength - wavelengths[i]) / (wavelengths[i + 1] - wavelengths[i]);
             return wavelength_function[i] * (1.0 - u) + wavelength_function[i + 1] * u;
         }
@@ -41,9 +43,10 @@ Model::Model(
     bool combine_scattering_textures,
     bool half_precision) :
 
-    num_precomputed_wavelengths_(num_precomputed_wavelengths){
+    num_precomputed_wavelengths_(num_precomputed_wavelengths),
+    two_layer_density_profiles_(rayleigh_density.size() <= 2 && mie_density.size() <= 2 && absorption_density.size() <= 2) {
 
-    auto to_string = [&wavelengths](const std::vector<double> &v, const vec3 &lambdas, double scale) {
+    auto to_string = [wavelengths](const std::vector<double> &v, const vec3 &lambdas, double scale) {
             double r = Interpolate(wavelengths, v, lambdas[0]) * scale;
             double g = Interpolate(wavelengths, v, lambdas[1]) * scale;
             double b = Interpolate(wavelengths, v, lambdas[2]) * scale;
@@ -61,6 +64,8 @@ Model::Model(
     auto density_profile =
         [density_layer](std::vector<DensityProfileLayer> layers) {
         constexpr int kLayerCount = 2;
+        // 超过两层的分布无法写入 DensityProfile，见 PrintAtmParameter
+        assert(layers.size() <= kLayerCount);
         while (layers.size() < kLayerCount) {
             layers.insert(layers.begin(), DensityProfileLayer());
         }
@@ -73,7 +78,7 @@ Model::Model(
         return result;
     };
 
-    // ԭʹø Lambda  GLSL 
+    // 原代码中使用该 Lambda 生成 GLSL 代码
     glsl_header_factory_ = [=](const vec3 &lambdas) {
         return
             "const AtmosphereParameters ATMOSPHERE = AtmosphereParameters(\n" +
@@ -95,6 +100,11 @@ Model::Model(
 }
 
 void Model::PrintAtmParameter() {
+    TRACE_SCOPE("Model::PrintAtmParameter");
+    if (!two_layer_density_profiles_) {
+        std::cerr << "Density profiles with more than two layers cannot be written as AtmosphereParameters" << std::endl;
+        return;
+    }
     std::string str = glsl_header_factory_({ kLambdaR , kLambdaG , kLambdaB });
     std::cout << str << std::endl;
 }
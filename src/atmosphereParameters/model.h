@@ -9,55 +9,55 @@
 #include "atmosphereParameters/definitions.h"
 #include "atmosphereParameters/constants.h"
 
-// ڵǰʵУΪ˻ڳʼ AtmosphereParameters ȷ
+// 在当前的实现中，该类仅仅是为了获得用于初始化 AtmosphereParameters 的正确参数
 class Model {
 public:
     Model(
-        // ṩ̫ȡɢ䡢ɢ䡢͵Ĳֵλף˳
+        // 提供太阳辐射度、雷利散射、米氏散射、米氏消光和地面消光样本的波长值，单位是纳米，并按递增顺序排序
         const std::vector<double> &wavelengths,
         // The solar irradiance at the top of the atmosphere, in W/m^2/nm. This
-        // ̫ irradiance vetor  wavelengths ͬС
+        // 大气顶部的太阳 irradiance，该 vetor 必须与 wavelengths 相同大小
         const std::vector<double> &solar_irradiance,
-        // ̫Ľǰ뾶λǻ
+        // 太阳的角半径，单位是弧度
         double sun_angular_radius,
-        // 뾶
+        // 地球半径
         double bottom_radius,
-        // 뾶 + ߶
+        // 地球半径 + 大气高度
         double top_radius,
-        // ܶȷֲ
+        // 空气分子密度分布
         const std::vector<DensityProfileLayer> &rayleigh_density,
-        // ɢϵ
+        // 空气分子散射系数
         const std::vector<double> &rayleigh_scattering,
-        // ܽܶȷֲ
+        // 气溶胶密度分布
         const std::vector<DensityProfileLayer> &mie_density,
-        // ܽɢϵ
+        // 气溶胶散射系数
         const std::vector<double> &mie_scattering,
-        // ܽϵ
+        // 气溶胶消光系数
         const std::vector<double> &mie_extinction,
-        // ܽǶԳϵ
+        // 气溶胶像函数非对称性系数
         double mie_phase_function_g,
-        // ܶȷֲ
+        // 臭氧吸密度分布
         const std::vector<DensityProfileLayer> &absorption_density,
-        // ϵ
+        // 臭氧吸光系数
         const std::vector<double> &absorption_extinction,
-        // ƽ albedo vetor  wavelengths ͬС
+        // 地面的平均 albedo，该 vetor 必须与 wavelengths 相同大小
         const std::vector<double> &ground_albedo,
-        // ĵƽ춥
+        // 最大的地平线天顶角
         double max_sun_zenith_angle,
-        // ģ/ϵĵλһ
+        // 模型/坐标系的单位，即一个整体的缩放
         double length_unit_in_meters,
-        // Сڵ3ʹ {kLambdaR, kLambdaG, kLambdaB} Ⱦֹ
+        // 小于等于3使用 {kLambdaR, kLambdaG, kLambdaB} 进行渲染，否则拆分光谱
         unsigned int num_precomputed_wavelengths,
-        //  single Mie.r  Rayleigh and multiple scattering
+        // 打包 single Mie.r 和 Rayleigh and multiple scattering
         bool combine_scattering_textures,
-        // 뾫
+        // 半精度
         bool half_precision);
 
     static constexpr double kLambdaR = 680.0;
     static constexpr double kLambdaG = 550.0;
     static constexpr double kLambdaB = 440.0;
 
-    // ɵ GLSL ӡֶʼ AtmosphereParameters
+    // 将生成的 GLSL 代码打印出来，手动初始化 AtmosphereParameters
     void PrintAtmParameter();
 
 private:
@@ -65,6 +65,7 @@ private:
     typedef std::array<float, 9> mat3;
 
     unsigned int num_precomputed_wavelengths_;
+    bool two_layer_density_profiles_;
     bool half_precision_;
     std::function<std::string(const vec3 &)> glsl_header_factory_;
     int transmittance_texture_;
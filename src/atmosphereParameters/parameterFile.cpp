@@ -0,0 +1,102 @@
+#include "parameterFile.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "presets.h"
+
+namespace {
+
+struct ParameterField {
+    const char *name;
+    double *values;
+    size_t count;
+};
+
+} // namespace
+
+bool LoadAtmosphereParameters(const std::string &path, AtmosphereParameters &atmosphere) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Failed to open atmosphere parameters " << path << std::endl;
+        return false;
+    }
+    AtmosphereParameters result = atmosphere;
+    const ParameterField fields[] = {
+        { "solar_irradiance", &result.solar_irradiance.x, 3 },
+        { "sun_angular_radius", &result.sun_angular_radius, 1 },
+        { "bottom_radius", &result.bottom_radius, 1 },
+        { "top_radius", &result.top_radius, 1 },
+        { "rayleigh_scattering", &result.rayleigh_scattering.x, 3 },
+        { "mie_scattering", &result.mie_scattering.x, 3 },
+        { "mie_extinction", &result.mie_extinction.x, 3 },
+        { "mie_phase_function_g", &result.mie_phase_function_g, 1 },
+        { "absorption_extinction", &result.absorption_extinction.x, 3 },
+        { "ground_albedo", &result.ground_albedo.x, 3 },
+        { "mu_s_min", &result.mu_s_min, 1 },
+    };
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream stream(line);
+        std::string name;
+        if (!(stream >> name)) {
+            continue;
+        }
+        std::vector<double> values;
+        double value;
+        while (stream >> value) {
+            values.push_back(value);
+        }
+        const ParameterField *field = nullptr;
+        for (const ParameterField &candidate : fields) {
+            if (name == candidate.name) {
+                field = &candidate;
+            }
+        }
+        if (!field) {
+            std::cerr << path << ": unknown parameter " << name << std::endl;
+            return false;
+        }
+        if (values.size() != field->count) {
+            std::cerr << path << ": " << name << " expects " << field->count << " values" << std::endl;
+            return false;
+        }
+        // Vec3d 的三个分量连续存放
+        for (size_t i = 0; i < values.size(); ++i) {
+            field->values[i] = values[i];
+        }
+    }
+    if (!(result.bottom_radius > 0.0 && result.top_radius > result.bottom_radius)) {
+        std::cerr << path << ": top_radius must be greater than bottom_radius" << std::endl;
+        return false;
+    }
+    atmosphere = result;
+    return true;
+}
+
+bool LoadAtmosphere(const std::string &atmosphere_path, const std::string &rayleigh_profile_path,
+    const std::string &mie_profile_path, const std::string &absorption_profile_path,
+    AtmosphereParameters &atmosphere, ExtendedDensityProfiles &profiles) {
+    atmosphere = kEarthAtmosphere;
+    if (!atmosphere_path.empty() && !LoadAtmosphereParameters(atmosphere_path, atmosphere)) {
+        return false;
+    }
+    profiles = GetExtendedDensityProfiles(atmosphere);
+    const std::pair<const std::string &, ExtendedDensityProfile &> inputs[] = {
+        { rayleigh_profile_path, profiles.rayleigh },
+        { mie_profile_path, profiles.mie },
+        { absorption_profile_path, profiles.absorption },
+    };
+    for (const auto &input : inputs) {
+        if (!input.first.empty() && !LoadExtendedDensityProfile(input.first, input.second)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+
+#include "definitions.h"
+#include "densityProfile.h"
+
+// 读取文本格式的大气参数，# 开头的行为注释，每行为 "名称 值"，光谱为三个值，长度单位与 AtmosphereParameters 相同：
+// solar_irradiance、sun_angular_radius、bottom_radius、top_radius、rayleigh_scattering、mie_scattering、mie_extinction、
+// mie_phase_function_g、absorption_extinction、ground_albedo、mu_s_min
+// 文件中没有出现的参数保持 atmosphere 中原来的值；密度分布由 LoadExtendedDensityProfile 读取
+bool LoadAtmosphereParameters(const std::string &path, AtmosphereParameters &atmosphere);
+
+// 从 kEarthAtmosphere 开始读取 atmosphere_path 的大气参数与三个密度分布文件，路径为空时保留原来的值
+bool LoadAtmosphere(const std::string &atmosphere_path, const std::string &rayleigh_profile_path,
+    const std::string &mie_profile_path, const std::string &absorption_profile_path,
+    AtmosphereParameters &atmosphere, ExtendedDensityProfiles &profiles);
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "definitions.h"
+
+// 由 Model::PrintAtmParameter 打印出的地球大气参数，长度单位为 km
+inline constexpr AtmosphereParameters kEarthAtmosphere = AtmosphereParameters{
+    Vec3d(1.500000, 1.500000, 1.500000),
+    0.004675,
+    6360.000000,
+    6420.000000,
+    DensityProfile{
+        DensityProfileLayer{ 0.000000, 0.000000, 0.000000, 0.000000, 0.000000 },
+        DensityProfileLayer{ 0.000000, 1.000000, -0.125000, 0.000000, 0.000000 }
+    },
+    Vec3d(0.005802, 0.013558, 0.033100),
+    DensityProfile{
+        DensityProfileLayer{ 0.000000, 0.000000, 0.000000, 0.000000, 0.000000 },
+        DensityProfileLayer{ 0.000000, 1.000000, -0.833333, 0.000000, 0.000000 }
+    },
+    Vec3d(0.003996, 0.003996, 0.003996),
+    Vec3d(0.004440, 0.004440, 0.004440),
+    0.800000,
+    DensityProfile{
+        DensityProfileLayer{ 25.000000, 0.000000, 0.000000, 0.066667, -0.666667 },
+        DensityProfileLayer{ 0.000000, 0.000000, 0.000000, -0.066667, 2.666667 }
+    },
+    Vec3d(0.000650, 0.001881, 0.000085),
+    Vec3d(0.100000, 0.100000, 0.100000),
+    -0.207912 };
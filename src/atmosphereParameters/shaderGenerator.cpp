@@ -0,0 +1,257 @@
+#include "shaderGenerator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+// 各语言在语法上的差异
+struct ShaderSyntax {
+    const char *scalar;
+    const char *vec3;
+    const char *int_type;
+    const char *constant;
+    const char *function;
+    // 数值字面量的有效位数
+    int precision;
+};
+
+ShaderSyntax GetSyntax(ShaderLanguage language) {
+    switch (language) {
+    case ShaderLanguage::GLSL: return { "float", "vec3", "int", "const", "", 9 };
+    case ShaderLanguage::HLSL: return { "float", "float3", "int", "static const", "", 9 };
+    case ShaderLanguage::Cpp: return { "double", "Vec3d", "int", "constexpr", "inline ", 17 };
+    }
+    return { "float", "vec3", "int", "const", "", 9 };
+}
+
+std::string Literal(double value, const ShaderSyntax &syntax) {
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%.*g", syntax.precision, value);
+    std::string result = buffer;
+    // 保证是浮点数字面量
+    if (result.find_first_of(".eEn") == std::string::npos) {
+        result += ".0";
+    }
+    return result;
+}
+
+std::string Vec3Literal(const std::array<double, 3> &v, const ShaderSyntax &syntax) {
+    return std::string(syntax.vec3) + "(" + Literal(v[0], syntax) + ", " + Literal(v[1], syntax) + ", " + Literal(v[2], syntax) + ")";
+}
+
+std::string Clamp01(const std::string &x, ShaderLanguage language) {
+    switch (language) {
+    case ShaderLanguage::GLSL: return "clamp(" + x + ", 0.0, 1.0)";
+    case ShaderLanguage::HLSL: return "saturate(" + x + ")";
+    case ShaderLanguage::Cpp: return "std::clamp(" + x + ", 0.0, 1.0)";
+    }
+    return x;
+}
+
+std::string Abs(const std::string &x, ShaderLanguage language) {
+    return language == ShaderLanguage::Cpp ? "std::abs(" + x + ")" : "abs(" + x + ")";
+}
+
+std::string Max0(const std::string &x, ShaderLanguage language) {
+    return language == ShaderLanguage::Cpp ? "std::max(" + x + ", 0.0)" : "max(" + x + ", 0.0)";
+}
+
+// HLSL 没有只接受一个标量的向量构造函数，需要用标量转换
+std::string Vec3Zero(const ShaderSyntax &syntax, ShaderLanguage language) {
+    return language == ShaderLanguage::HLSL ? "(float3)0" : std::string(syntax.vec3) + "(0.0)";
+}
+
+bool IsZero(const std::array<double, 3> &v) {
+    return v[0] == 0.0 && v[1] == 0.0 && v[2] == 0.0;
+}
+
+bool IsZero(const DensityProfileLayer &layer) {
+    return layer.exp_term == 0.0 && layer.linear_term == 0.0 && layer.constant_term == 0.0;
+}
+
+bool SameLayer(const DensityProfileLayer &a, const DensityProfileLayer &b) {
+    return a.exp_term == b.exp_term && a.exp_scale == b.exp_scale &&
+        a.linear_term == b.linear_term && a.constant_term == b.constant_term;
+}
+
+// 单层密度的表达式，去掉值为 0 的项，结果必定在 [0, 1] 内时去掉 clamp
+std::string LayerExpression(const DensityProfileLayer &layer, const ShaderSyntax &syntax, ShaderLanguage language) {
+    // exp_scale 为 0 时指数项是常数
+    const double exp_constant = layer.exp_scale == 0.0 ? layer.exp_term : 0.0;
+    const double constant = layer.constant_term + exp_constant;
+    const bool has_exp = layer.exp_term != 0.0 && layer.exp_scale != 0.0;
+    const bool has_linear = layer.linear_term != 0.0;
+    if (!has_exp && !has_linear) {
+        return Literal(std::min(std::max(constant, 0.0), 1.0), syntax);
+    }
+    std::string expression;
+    if (has_exp) {
+        const std::string e = "exp(" + Literal(layer.exp_scale, syntax) + " * altitude)";
+        expression = layer.exp_term == 1.0 ? e : Literal(layer.exp_term, syntax) + " * " + e;
+    }
+    if (has_linear) {
+        expression += (expression.empty() ? "" : " + ") + Literal(layer.linear_term, syntax) + " * altitude";
+    }
+    if (constant != 0.0) {
+        expression += " + " + Literal(constant, syntax);
+    }
+    // 海拔非负时，系数在 (0, 1] 内的纯衰减指数项本身就在 [0, 1] 内
+    const bool bounded = has_exp && !has_linear && constant == 0.0 &&
+        layer.exp_term > 0.0 && layer.exp_term <= 1.0 && layer.exp_scale < 0.0;
+    return bounded ? expression : Clamp01(expression, language);
+}
+
+// 整个分布的表达式，返回空字符串表示密度恒为 0
+std::string ProfileExpression(std::vector<DensityProfileLayer> layers, const ShaderSyntax &syntax, ShaderLanguage language) {
+    // 与 Model 一致，不足两层时在前面补宽度为 0 的空层
+    assert(layers.size() <= 2);
+    while (layers.size() < 2) {
+        layers.insert(layers.begin(), DensityProfileLayer());
+    }
+    const DensityProfileLayer &lower = layers[0];
+    const DensityProfileLayer &upper = layers[1];
+    // 宽度为 0 的下层永远不会被使用
+    if (lower.width <= 0.0 || SameLayer(lower, upper)) {
+        return IsZero(upper) ? "" : LayerExpression(upper, syntax, language);
+    }
+    if (IsZero(lower) && IsZero(upper)) {
+        return "";
+    }
+    // 两层均为线性且在分界处相交、斜率相反：三角形分布，peak - slope * |h - width|
+    const bool linear_only = lower.exp_term == 0.0 && upper.exp_term == 0.0;
+    const double peak_lower = lower.linear_term * lower.width + lower.constant_term;
+    const double peak_upper = upper.linear_term * lower.width + upper.constant_term;
+    if (linear_only && lower.linear_term > 0.0 && upper.linear_term == -lower.linear_term &&
+        std::abs(peak_lower - peak_upper) <= 1e-9 * std::max(1.0, std::abs(peak_lower))) {
+        const std::string tent = Literal(peak_lower, syntax) + " - " + Literal(lower.linear_term, syntax) +
+            " * " + Abs("altitude - " + Literal(lower.width, syntax), language);
+        return peak_lower <= 1.0 ? Max0(tent, language) : Clamp01(tent, language);
+    }
+    const std::string lower_expression = LayerExpression(lower, syntax, language);
+    const std::string upper_expression = LayerExpression(upper, syntax, language);
+    return "altitude < " + Literal(lower.width, syntax) + " ? " + lower_expression + " : " + upper_expression;
+}
+
+std::array<double, 3> ToArray(const Vec3d &v) {
+    return { v.x, v.y, v.z };
+}
+
+} // namespace
+
+SpecializedAtmosphereParameters MakeSpecializedAtmosphereParameters(const AtmosphereParameters &atmosphere,
+    const ExtendedDensityProfiles &profiles) {
+    assert(FitsInDensityProfile(profiles.rayleigh) && FitsInDensityProfile(profiles.mie) &&
+        FitsInDensityProfile(profiles.absorption));
+    return SpecializedAtmosphereParameters{
+        ToArray(atmosphere.solar_irradiance),
+        atmosphere.sun_angular_radius,
+        atmosphere.bottom_radius,
+        atmosphere.top_radius,
+        profiles.rayleigh.layers,
+        ToArray(atmosphere.rayleigh_scattering),
+        profiles.mie.layers,
+        ToArray(atmosphere.mie_scattering),
+        ToArray(atmosphere.mie_extinction),
+        atmosphere.mie_phase_function_g,
+        profiles.absorption.layers,
+        ToArray(atmosphere.absorption_extinction),
+        ToArray(atmosphere.ground_albedo),
+        atmosphere.mu_s_min };
+}
+
+std::string GenerateSpecializedShader(const SpecializedAtmosphereParameters &p, ShaderLanguage language) {
+    const ShaderSyntax s = GetSyntax(language);
+    const std::string scalar = s.scalar;
+    const std::string vec3 = s.vec3;
+    const std::string constant = std::string(s.constant) + " ";
+    const std::string function = s.function;
+    const bool cpp = language == ShaderLanguage::Cpp;
+
+    std::string code;
+    code += "// Generated by Transmittance --emit-shaders, do not edit.\n";
+    if (cpp) {
+        code += "#pragma once\n\n#include <algorithm>\n#include <cmath>\n\n#include \"atmosphereParameters/definitions.h\"\n\n";
+        code += "namespace specialized {\n\n";
+    }
+    code += "\n";
+
+    code += constant + vec3 + " kSolarIrradiance = " + Vec3Literal(p.solar_irradiance, s) + ";\n";
+    code += constant + scalar + " kSunAngularRadius = " + Literal(p.sun_angular_radius, s) + ";\n";
+    code += constant + scalar + " kBottomRadius = " + Literal(p.bottom_radius, s) + ";\n";
+    code += constant + scalar + " kTopRadius = " + Literal(p.top_radius, s) + ";\n";
+    code += constant + vec3 + " kMieScattering = " + Vec3Literal(p.mie_scattering, s) + ";\n";
+    code += constant + scalar + " kMiePhaseFunctionG = " + Literal(p.mie_phase_function_g, s) + ";\n";
+    code += constant + vec3 + " kGroundAlbedo = " + Vec3Literal(p.ground_albedo, s) + ";\n";
+    code += constant + scalar + " kMuSMin = " + Literal(p.mu_s_min, s) + ";\n";
+    // 预先折叠的派生常量
+    code += constant + scalar + " kTopRadiusSquared = " + Literal(p.top_radius * p.top_radius, s) + ";\n";
+    code += constant + scalar + " kBottomRadiusSquared = " + Literal(p.bottom_radius * p.bottom_radius, s) + ";\n";
+    code += constant + scalar + " kHorizonDistance = " +
+        Literal(std::sqrt(p.top_radius * p.top_radius - p.bottom_radius * p.bottom_radius), s) + ";\n\n";
+
+    // 只保留非零的消光项
+    struct Extinction {
+        const char *name;
+        std::string density;
+        std::array<double, 3> coefficient;
+    };
+    const Extinction extinctions[3] = {
+        { "Rayleigh", ProfileExpression(p.rayleigh_density, s, language), p.rayleigh_scattering },
+        { "Mie", ProfileExpression(p.mie_density, s, language), p.mie_extinction },
+        { "Absorption", ProfileExpression(p.absorption_density, s, language), p.absorption_extinction },
+    };
+    std::string extinction_sum;
+    for (const Extinction &e : extinctions) {
+        if (e.density.empty() || IsZero(e.coefficient)) {
+            continue;
+        }
+        code += constant + vec3 + " k" + e.name + "Extinction = " + Vec3Literal(e.coefficient, s) + ";\n";
+        code += function + scalar + " Get" + e.name + "Density(" + scalar + " altitude) {\n";
+        code += "    return " + e.density + ";\n}\n\n";
+        extinction_sum += std::string(extinction_sum.empty() ? "" : " +\n            ") +
+            "k" + e.name + "Extinction * Get" + e.name + "Density(altitude)";
+    }
+
+    code += function + scalar + " DistanceToTopAtmosphereBoundary(" + scalar + " r, " + scalar + " mu) {\n";
+    code += "    " + scalar + " discriminant = r * r * (mu * mu - 1.0) + kTopRadiusSquared;\n";
+    code += "    return " + Max0("-r * mu + sqrt(" + Max0("discriminant", language) + ")", language) + ";\n}\n\n";
+
+    // 三种粒子共用采样点，在一个循环中累加
+    code += function + vec3 + " ComputeOpticalDepthToTopAtmosphereBoundary(" + scalar + " r, " + scalar + " mu) {\n";
+    code += "    " + constant + s.int_type + " SAMPLE_COUNT = 500;\n";
+    code += "    " + scalar + " dx = DistanceToTopAtmosphereBoundary(r, mu) / " + scalar + "(SAMPLE_COUNT);\n";
+    code += "    " + vec3 + " result = " + Vec3Zero(s, language) + ";\n";
+    if (!extinction_sum.empty()) {
+        code += "    for (" + std::string(s.int_type) + " i = 0; i <= SAMPLE_COUNT; ++i) {\n";
+        code += "        " + scalar + " d_i = " + scalar + "(i) * dx;\n";
+        // 贴近地平线时舍入误差会产生微小的负高度，截断到 0 后纯 exp 形式不会超过 1，因此不再需要 clamp
+        code += "        " + scalar + " altitude = " +
+            Max0("sqrt(d_i * d_i + 2.0 * r * mu * d_i + r * r) - kBottomRadius", language) + ";\n";
+        code += "        " + scalar + " weight_i = i == 0 || i == SAMPLE_COUNT ? 0.5 : 1.0;\n";
+        code += "        result += (" + extinction_sum + ") * (weight_i * dx);\n";
+        code += "    }\n";
+    }
+    code += "    return result;\n}\n\n";
+
+    code += function + vec3 + " ComputeTransmittanceToTopAtmosphereBoundary(" + scalar + " r, " + scalar + " mu) {\n";
+    code += "    return exp(-ComputeOpticalDepthToTopAtmosphereBoundary(r, mu));\n}\n\n";
+
+    // 透射率纹理的参数化，uv 为 [0, 1] 内的单位坐标
+    code += function + "void GetRMuFromTransmittanceUnitRange(" + scalar + " x_mu, " + scalar + " x_r, " +
+        (cpp ? scalar + " &r, " + scalar + " &mu" : "out " + scalar + " r, out " + scalar + " mu") + ") {\n";
+    code += "    " + scalar + " rho = kHorizonDistance * x_r;\n";
+    code += "    r = sqrt(rho * rho + kBottomRadiusSquared);\n";
+    code += "    " + scalar + " d_min = kTopRadius - r;\n";
+    code += "    " + scalar + " d_max = rho + kHorizonDistance;\n";
+    code += "    " + scalar + " d = d_min + x_mu * (d_max - d_min);\n";
+    code += "    mu = d == 0.0 ? 1.0 : (kHorizonDistance * kHorizonDistance - rho * rho - d * d) / (2.0 * r * d);\n";
+    code += "    mu = " + (cpp ? std::string("std::clamp(mu, -1.0, 1.0)") : std::string("clamp(mu, -1.0, 1.0)")) + ";\n}\n";
+
+    if (cpp) {
+        code += "\n} // namespace specialized\n";
+    }
+    return code;
+}
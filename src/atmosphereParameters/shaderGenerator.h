@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "definitions.h"
+#include "densityProfile.h"
+
+enum class ShaderLanguage {
+    GLSL,
+    HLSL,
+    // 使用 definitions.h 中的类型，可以直接被 CPU 端的 kernel 包含
+    Cpp,
+};
+
+// 生成特化代码所需的参数，长度均已换算为模型单位（length_unit_in_meters）
+struct SpecializedAtmosphereParameters {
+    std::array<double, 3> solar_irradiance;
+    double sun_angular_radius;
+    double bottom_radius;
+    double top_radius;
+    std::vector<DensityProfileLayer> rayleigh_density;
+    std::array<double, 3> rayleigh_scattering;
+    std::vector<DensityProfileLayer> mie_density;
+    std::array<double, 3> mie_scattering;
+    std::array<double, 3> mie_extinction;
+    double mie_phase_function_g;
+    std::vector<DensityProfileLayer> absorption_density;
+    std::array<double, 3> absorption_extinction;
+    std::array<double, 3> ground_albedo;
+    double mu_s_min;
+};
+
+// 由烘焙 LUT 所用的大气参数与密度分布得到生成代码的参数，长度单位与 atmosphere 相同
+// 三种分布都需要满足 FitsInDensityProfile
+SpecializedAtmosphereParameters MakeSpecializedAtmosphereParameters(const AtmosphereParameters &atmosphere,
+    const ExtendedDensityProfiles &profiles);
+
+// 生成常量折叠后的大气代码：
+// 所有参数都是字面常量，值为 0 的层与项被删除，单层的指数分布退化为一次 exp，
+// 对称的双层线性分布（臭氧）退化为不含分支的三角函数，三种粒子在同一个积分循环中累加消光
+std::string GenerateSpecializedShader(const SpecializedAtmosphereParameters &parameters, ShaderLanguage language);
@@ -0,0 +1,217 @@
+#include "accuracy.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <random>
+
+#include "functions/bake.h"
+#include "parallel/parallelFor.h"
+
+namespace {
+
+// 每个线程任务处理的探测点数
+constexpr int kChunkSize = 4096;
+// 检查真值精度时使用的探测点数
+constexpr int kReferenceCheckCount = 4096;
+
+int GetChunkCount(size_t count) {
+    return static_cast<int>((count + kChunkSize - 1) / kChunkSize);
+}
+
+// 在 [0, count) 的各个分块上并行调用 function(begin, end)
+template<class Function>
+void ParallelForChunks(size_t count, int thread_count, Function function) {
+    ParallelFor(GetChunkCount(count), thread_count, [&](int chunk) {
+        function(static_cast<size_t>(chunk) * kChunkSize, std::min(count, static_cast<size_t>(chunk + 1) * kChunkSize));
+    });
+}
+
+void IntegrateProbes(const AtmosphereParameters &atmosphere, const ExtendedDensityProfiles &profiles,
+    const std::vector<AccuracyProbe> &probes, size_t count, const IntegratorSettings &settings, int thread_count,
+    std::vector<std::array<double, 3>> &values) {
+    values.resize(count);
+    DispatchBakeKernel<double>(atmosphere, profiles, settings, [&](const auto &kernel) {
+        ParallelForChunks(count, thread_count, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                const Vec3d trans = kernel.ComputeTransmittanceToTopAtmosphereBoundary(probes[i].r, probes[i].mu, settings);
+                values[i] = { trans.x, trans.y, trans.z };
+            }
+        });
+    });
+}
+
+double GetMaxError(const std::array<double, 3> &reference, const std::array<double, 3> &value, ErrorSpace space) {
+    double error = 0.0;
+    for (int c = 0; c < 3; ++c) {
+        if (!(reference[c] > 0.0)) {
+            continue;
+        }
+        if (space == ErrorSpace::Linear) {
+            error = std::max(error, std::abs(value[c] - reference[c]) / reference[c]);
+        } else {
+            const double depth = -std::log(reference[c]);
+            const double value_depth = -std::log(std::max(value[c], std::numeric_limits<double>::min()));
+            error = std::max(error, std::abs(value_depth - depth) / std::max(depth, 1.0));
+        }
+    }
+    return error;
+}
+
+void MarkParetoFront(std::vector<AccuracyResult> &results, TransmittanceLookup lookup) {
+    const int index = static_cast<int>(lookup);
+    std::vector<AccuracyResult *> order;
+    for (AccuracyResult &result : results) {
+        order.push_back(&result);
+    }
+    std::sort(order.begin(), order.end(), [&](const AccuracyResult *a, const AccuracyResult *b) {
+        return a->bake_ms != b->bake_ms ? a->bake_ms < b->bake_ms : a->p99_error[index] < b->p99_error[index];
+    });
+    double best = std::numeric_limits<double>::infinity();
+    for (AccuracyResult *result : order) {
+        result->pareto = result->p99_error[index] < best;
+        best = std::min(best, result->p99_error[index]);
+    }
+}
+
+} // namespace
+
+AccuracyProbes CreateAccuracyProbes(const AtmosphereParameters &atmosphere, const ExtendedDensityProfiles &profiles,
+    int probe_count, int reference_sample_count, uint64_t seed, int thread_count) {
+    AccuracyProbes result;
+    result.probes.resize(probe_count);
+    // 每个分块使用 seed 与分块下标初始化自己的随机数
+    const TransmittanceParameterization parameterization = CreateTransmittanceParameterization(atmosphere, 0, 0);
+    ParallelForChunks(result.probes.size(), thread_count, [&](size_t begin, size_t end) {
+        std::mt19937_64 random(seed * 0x9E3779B97F4A7C15ull + begin / kChunkSize);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        for (size_t i = begin; i < end; ++i) {
+            const double x_mu = unit(random);
+            const double x_r = unit(random);
+            parameterization.GetRMuFromUnitCoords(x_mu, x_r, result.probes[i].r, result.probes[i].mu);
+        }
+    });
+    result.reference_settings = IntegratorSettings{ IntegrationMode::Exponential, reference_sample_count };
+    std::vector<std::array<double, 3>> values;
+    const auto begin = std::chrono::steady_clock::now();
+    IntegrateProbes(atmosphere, profiles, result.probes, result.probes.size(), result.reference_settings, thread_count, values);
+    result.reference_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    for (size_t i = 0; i < values.size(); ++i) {
+        result.probes[i].reference = values[i];
+    }
+    const size_t check_count = std::min(result.probes.size(), static_cast<size_t>(kReferenceCheckCount));
+    IntegrateProbes(atmosphere, profiles, result.probes, check_count,
+        IntegratorSettings{ IntegrationMode::LayerBounded, 5 * reference_sample_count }, thread_count, values);
+    for (size_t i = 0; i < check_count; ++i) {
+        result.reference_error = std::max(result.reference_error,
+            GetMaxError(values[i], result.probes[i].reference, ErrorSpace::Linear));
+    }
+    return result;
+}
+
+std::vector<float> MeasureLookupErrors(const AccuracyProbes &probes, const AtmosphereParameters &atmosphere,
+    const TextureImage &image, TransmittanceLookup lookup, ErrorSpace space, int thread_count) {
+    std::vector<float> errors(probes.probes.size());
+    const TransmittanceParameterization parameterization = CreateTransmittanceParameterization(atmosphere, 0, 0);
+    ParallelForChunks(errors.size(), thread_count, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const AccuracyProbe &probe = probes.probes[i];
+            errors[i] = static_cast<float>(GetMaxError(probe.reference,
+                SampleTransmittanceBilinear(image, parameterization, probe.r, probe.mu, lookup), space));
+        }
+    });
+    return errors;
+}
+
+std::vector<float> MeasureIntegratorErrors(const AccuracyProbes &probes, const AtmosphereParameters &atmosphere,
+    const ExtendedDensityProfiles &profiles, const IntegratorSettings &settings, ErrorSpace space, int thread_count) {
+    std::vector<std::array<double, 3>> values;
+    IntegrateProbes(atmosphere, profiles, probes.probes, probes.probes.size(), settings, thread_count, values);
+    std::vector<float> errors(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        errors[i] = static_cast<float>(GetMaxError(probes.probes[i].reference, values[i], space));
+    }
+    return errors;
+}
+
+double GetErrorQuantile(std::vector<float> &errors, double quantile) {
+    if (errors.empty()) {
+        return 0.0;
+    }
+    const size_t index = std::min(errors.size() - 1, static_cast<size_t>(quantile * errors.size()));
+    std::nth_element(errors.begin(), errors.begin() + index, errors.end());
+    return errors[index];
+}
+
+std::vector<AccuracyResult> RunAccuracyHarness(const AtmosphereParameters &atmosphere, const ExtendedDensityProfiles &profiles,
+    const AccuracyOptions &options) {
+    const AccuracyProbes probes = CreateAccuracyProbes(atmosphere, profiles, options.probe_count,
+        options.reference_sample_count, options.seed, options.thread_count);
+    std::cerr << "Reference: " << probes.probes.size() << " probes of exponential/" << options.reference_sample_count
+        << " in " << probes.reference_seconds << " s, max difference to layered/" << 5 * options.reference_sample_count
+        << " " << probes.reference_error << std::endl;
+
+    std::vector<AccuracyResult> results;
+    for (const auto &size : options.sizes) {
+        for (IntegrationMode mode : { IntegrationMode::Uniform, IntegrationMode::LayerBounded, IntegrationMode::Exponential }) {
+            for (int sample_count : options.sample_counts) {
+                const IntegratorSettings settings{ mode, sample_count };
+                TextureImage image;
+                AccuracyResult result{};
+                result.width = size.first;
+                result.height = size.second;
+                result.mode = mode;
+                result.sample_count = sample_count;
+                result.bake_ms = MeasureMedianMilliseconds(options.repeat, [&]() {
+                    image = BakeTransmittance<double>(atmosphere, profiles, size.first, size.second, settings,
+                        options.thread_count);
+                });
+                for (TransmittanceLookup lookup : { TransmittanceLookup::BakedGrid, TransmittanceLookup::ShaderUv }) {
+                    std::vector<float> errors = MeasureLookupErrors(probes, atmosphere, image, lookup, ErrorSpace::Linear,
+                        options.thread_count);
+                    const int index = static_cast<int>(lookup);
+                    double sum = 0.0;
+                    for (float error : errors) {
+                        sum += error;
+                    }
+                    result.mean_error[index] = sum / errors.size();
+                    result.p99_error[index] = GetErrorQuantile(errors, 0.99);
+                    result.max_error[index] = GetErrorQuantile(errors, 1.0);
+                }
+                results.push_back(result);
+            }
+        }
+        std::cerr << "Finished " << size.first << "x" << size.second << std::endl;
+    }
+    MarkParetoFront(results, options.pareto_lookup);
+    return results;
+}
+
+void WriteAccuracyResults(std::ostream &stream, const std::vector<AccuracyResult> &results, const std::string &format) {
+    char line[512];
+    if (format == "csv") {
+        stream << "width,height,integrator,samples,bake_ms,grid_mean,grid_p99,grid_max,shader_mean,shader_p99,shader_max,pareto\n";
+        for (const AccuracyResult &r : results) {
+            std::snprintf(line, sizeof(line), "%d,%d,%s,%d,%.4f,%.4e,%.4e,%.4e,%.4e,%.4e,%.4e,%d\n", r.width, r.height,
+                GetIntegrationModeName(r.mode), r.sample_count, r.bake_ms, r.mean_error[0], r.p99_error[0], r.max_error[0],
+                r.mean_error[1], r.p99_error[1], r.max_error[1], r.pareto ? 1 : 0);
+            stream << line;
+        }
+        return;
+    }
+    stream << "[\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const AccuracyResult &r = results[i];
+        std::snprintf(line, sizeof(line), "  { \"width\": %d, \"height\": %d, \"integrator\": \"%s\", \"samples\": %d, "
+            "\"bake_ms\": %.4f, \"grid_mean\": %.4e, \"grid_p99\": %.4e, \"grid_max\": %.4e, \"shader_mean\": %.4e, "
+            "\"shader_p99\": %.4e, \"shader_max\": %.4e, \"pareto\": %s }%s\n", r.width, r.height,
+            GetIntegrationModeName(r.mode), r.sample_count, r.bake_ms, r.mean_error[0], r.p99_error[0], r.max_error[0],
+            r.mean_error[1], r.p99_error[1], r.max_error[1], r.pareto ? "true" : "false", i + 1 < results.size() ? "," : "");
+        stream << line;
+    }
+    stream << "]\n";
+}
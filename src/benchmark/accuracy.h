@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "atmosphereParameters/densityProfile.h"
+#include "functions/integrator.h"
+#include "functions/lookup.h"
+
+// 误差的度量方式
+enum class ErrorSpace {
+    // |L - T| / T
+    Linear,
+    // 光学深度 -ln T 的误差，光学深度大于 1 时为相对误差，否则为绝对误差；
+    // 掠过地平线的射线 T 可以小于 1e-8，线性空间中的最大误差总是由它们决定
+    Log,
+};
+
+inline const char *GetErrorSpaceName(ErrorSpace space) {
+    return space == ErrorSpace::Linear ? "linear" : "log";
+}
+
+inline bool ParseErrorSpace(const char *name, ErrorSpace &space) {
+    if (std::strcmp(name, "linear") == 0) {
+        space = ErrorSpace::Linear;
+        return true;
+    }
+    if (std::strcmp(name, "log") == 0) {
+        space = ErrorSpace::Log;
+        return true;
+    }
+    return false;
+}
+
+struct AccuracyProbe {
+    double r;
+    double mu;
+    std::array<double, 3> reference;
+};
+
+// 随机探测点及其真值，在单位坐标 (x_mu, x_r) 上均匀分布，即按 LUT 的面积加权
+// 真值使用 Exponential 模式，该模式在分段端点处拆开且对指数分布按对数线性积分
+struct AccuracyProbes {
+    std::vector<AccuracyProbe> probes;
+    IntegratorSettings reference_settings;
+    // 在前 4096 个探测点上相对于 5 倍采样次数的 LayerBounded 模式的最大差异，即真值本身误差的估计
+    double reference_error = 0.0;
+    double reference_seconds = 0.0;
+};
+
+// 探测点由 seed 决定，与线程数无关
+AccuracyProbes CreateAccuracyProbes(const AtmosphereParameters &atmosphere, const ExtendedDensityProfiles &profiles,
+    int probe_count, int reference_sample_count, uint64_t seed, int thread_count);
+
+// 在 image 中查找每个探测点，返回三个通道中最大的误差
+std::vector<float> MeasureLookupErrors(const AccuracyProbes &probes, const AtmosphereParameters &atmosphere,
+    const TextureImage &image, TransmittanceLookup lookup, ErrorSpace space, int thread_count);
+
+// 不经过 LUT，直接以 settings 积分每个探测点的误差
+std::vector<float> MeasureIntegratorErrors(const AccuracyProbes &probes, const AtmosphereParameters &atmosphere,
+    const ExtendedDensityProfiles &profiles, const IntegratorSettings &settings, ErrorSpace space, int thread_count);
+
+// errors 的 quantile 分位数，1 为最大值，会改变 errors 的顺序
+double GetErrorQuantile(std::vector<float> &errors, double quantile);
+
+// 重复 repeat 次调用 function，返回耗时的中位数（毫秒）
+template<class Function>
+double MeasureMedianMilliseconds(int repeat, Function function) {
+    std::vector<double> times;
+    for (int i = 0; i < repeat; ++i) {
+        const auto begin = std::chrono::steady_clock::now();
+        function();
+        const auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+// 透射率 LUT 的精度与开销：在随机的 (r, mu) 上以高采样次数的积分为真值，
+// 与不同分辨率、积分模式与采样次数烘焙的 LUT 的双线性查找比较，按烘焙耗时与误差列出 Pareto 前沿
+struct AccuracyOptions {
+    int probe_count = 1000000;
+    int reference_sample_count = 1000;
+    uint64_t seed = 1;
+    std::vector<std::pair<int, int>> sizes;
+    std::vector<int> sample_counts;
+    int repeat = 1;
+    // 烘焙与探测使用的线程数，0 表示使用硬件线程数
+    int thread_count = 0;
+    // Pareto 前沿使用的查找方式
+    TransmittanceLookup pareto_lookup = TransmittanceLookup::ShaderUv;
+};
+
+struct AccuracyResult {
+    int width;
+    int height;
+    IntegrationMode mode;
+    int sample_count;
+    double bake_ms;
+    // 每个探测点取三个通道中最大的线性相对误差，按 TransmittanceLookup 的顺序
+    double mean_error[2];
+    double p99_error[2];
+    double max_error[2];
+    // 没有更快且 pareto_lookup 下 p99 误差不更大的设置
+    bool pareto;
+};
+
+std::vector<AccuracyResult> RunAccuracyHarness(const AtmosphereParameters &atmosphere, const ExtendedDensityProfiles &profiles,
+    const AccuracyOptions &options);
+
+void WriteAccuracyResults(std::ostream &stream, const std::vector<AccuracyResult> &results, const std::string &format);
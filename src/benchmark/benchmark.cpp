@@ -0,0 +1,401 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "functions/functions.h"
+#include "functions/bake.h"
+#include "functions/lazyBake.h"
+#include "atmosphereParameters/parameterFile.h"
+#include "parallel/parallelFor.h"
+#include "accuracy.h"
+#include "tuner.h"
+
+// 烘焙各阶段的基准测试，在线程数、纹理尺寸与采样次数上扫描，输出每项的中位数、p95 与每秒纹素数
+// 目前只有透射率一个烘焙阶段，没有散射阶段可以测量；--mode accuracy 时改为运行 RunAccuracyHarness，
+// --mode tune 时运行 TuneTransmittance
+
+// 命令行参数：Benchmark [--mode timing|accuracy|tune] [--threads 1,2,4,0] [--sizes 64x16,256x64,1024x256] [--samples 50,500]
+//             [--repeat <次数>] [--format csv|json] [--output <文件>]
+//             [--probes <数量>] [--reference-samples <采样次数>] [--lookup grid|shader]
+//             [--target <误差>] [--quantile <分位数>] [--space linear|log]
+//             [--rayleigh-profile <文件>] [--mie-profile <文件>] [--absorption-profile <文件>] [--atmosphere <文件>]
+struct BenchmarkOptions {
+    std::string mode = "timing";
+    // 0 表示使用硬件线程数
+    std::vector<int> thread_counts = { 1, 2, 4, 0 };
+    std::vector<std::pair<int, int>> sizes = { { 64, 16 }, { 256, 64 }, { 1024, 256 } };
+    std::vector<int> sample_counts = { 50, 500 };
+    int repeat = 5;
+    std::string format = "csv";
+    // 为空时输出到 stdout
+    std::string output_path;
+    // 以下只用于 accuracy 与 tune，--threads 只给出一个值时烘焙与探测使用该线程数，否则使用硬件线程数
+    AccuracyOptions accuracy;
+    // 以下只用于 tune，探测点数与真值的采样次数来自 accuracy
+    TunerOptions tuner;
+    bool probe_count_set = false;
+    // 以下只用于 accuracy 与 tune
+    // 从文件读取的大气参数，为空时使用 kEarthAtmosphere，格式见 LoadAtmosphereParameters
+    std::string atmosphere_path;
+    // 从文件读取的密度分布，为空时使用大气参数中的分布
+    std::string rayleigh_profile_path;
+    std::string mie_profile_path;
+    std::string absorption_profile_path;
+};
+
+struct BenchmarkResult {
+    std::string stage;
+    int thread_count;
+    int width;
+    int height;
+    int sample_count;
+    double median_ms;
+    double p95_ms;
+    double texels_per_second;
+};
+
+bool ParseIntList(const char *text, std::vector<int> &values) {
+    values.clear();
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        char *end = nullptr;
+        const long value = std::strtol(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0' || value < 0) {
+            return false;
+        }
+        values.push_back(static_cast<int>(value));
+    }
+    return !values.empty();
+}
+
+bool ParseSizeList(const char *text, std::vector<std::pair<int, int>> &sizes) {
+    sizes.clear();
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        int width = 0;
+        int height = 0;
+        if (std::sscanf(item.c_str(), "%dx%d", &width, &height) != 2 || width < 2 || height < 2) {
+            return false;
+        }
+        sizes.emplace_back(width, height);
+    }
+    return !sizes.empty();
+}
+
+bool ParseOptions(int argc, char **argv, BenchmarkOptions &options) {
+    for (int i = 1; i < argc; i += 2) {
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << argv[i] << std::endl;
+            return false;
+        }
+        bool valid = true;
+        if (std::strcmp(argv[i], "--mode") == 0) {
+            options.mode = argv[i + 1];
+            valid = options.mode == "timing" || options.mode == "accuracy" || options.mode == "tune";
+        } else if (std::strcmp(argv[i], "--threads") == 0) {
+            valid = ParseIntList(argv[i + 1], options.thread_counts);
+        } else if (std::strcmp(argv[i], "--sizes") == 0) {
+            valid = ParseSizeList(argv[i + 1], options.sizes);
+        } else if (std::strcmp(argv[i], "--samples") == 0) {
+            valid = ParseIntList(argv[i + 1], options.sample_counts) &&
+                std::find(options.sample_counts.begin(), options.sample_counts.end(), 0) == options.sample_counts.end();
+        } else if (std::strcmp(argv[i], "--repeat") == 0) {
+            options.repeat = std::atoi(argv[i + 1]);
+            valid = options.repeat >= 1;
+        } else if (std::strcmp(argv[i], "--format") == 0) {
+            options.format = argv[i + 1];
+            valid = options.format == "csv" || options.format == "json";
+        } else if (std::strcmp(argv[i], "--output") == 0) {
+            options.output_path = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--probes") == 0) {
+            options.accuracy.probe_count = std::atoi(argv[i + 1]);
+            options.probe_count_set = true;
+            valid = options.accuracy.probe_count >= 1;
+        } else if (std::strcmp(argv[i], "--reference-samples") == 0) {
+            options.accuracy.reference_sample_count = std::atoi(argv[i + 1]);
+            valid = options.accuracy.reference_sample_count >= 1;
+        } else if (std::strcmp(argv[i], "--lookup") == 0) {
+            valid = ParseTransmittanceLookup(argv[i + 1], options.accuracy.pareto_lookup);
+            options.tuner.lookup = options.accuracy.pareto_lookup;
+        } else if (std::strcmp(argv[i], "--target") == 0) {
+            options.tuner.target_error = std::atof(argv[i + 1]);
+            valid = options.tuner.target_error > 0.0;
+        } else if (std::strcmp(argv[i], "--quantile") == 0) {
+            options.tuner.quantile = std::atof(argv[i + 1]);
+            valid = options.tuner.quantile > 0.0 && options.tuner.quantile <= 1.0;
+        } else if (std::strcmp(argv[i], "--space") == 0) {
+            valid = ParseErrorSpace(argv[i + 1], options.tuner.space);
+        } else if (std::strcmp(argv[i], "--atmosphere") == 0) {
+            options.atmosphere_path = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--rayleigh-profile") == 0) {
+            options.rayleigh_profile_path = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--mie-profile") == 0) {
+            options.mie_profile_path = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--absorption-profile") == 0) {
+            options.absorption_profile_path = argv[i + 1];
+        } else {
+            std::cerr << "Usage: Benchmark [--mode timing|accuracy|tune] [--threads 1,2,4,0] [--sizes 64x16,256x64,1024x256] "
+                "[--samples 50,500] [--repeat <count>] [--format csv|json] [--output <file>] [--probes <count>] "
+                "[--reference-samples <count>] [--lookup grid|shader] [--target <max error>] [--quantile <quantile>] "
+                "[--space linear|log] [--rayleigh-profile <file>] [--mie-profile <file>] [--absorption-profile <file>] "
+                "[--atmosphere <file>]" << std::endl;
+            return false;
+        }
+        if (!valid) {
+            std::cerr << "Invalid value for " << argv[i] << ": " << argv[i + 1] << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// 防止被测的计算被优化掉
+volatile double g_sink = 0.0;
+
+// 重复 repeat 次调用 function，按每次的耗时统计
+template<class Function>
+BenchmarkResult Measure(const std::string &stage, int thread_count, int width, int height, int sample_count,
+    int repeat, Function function) {
+    std::vector<double> times;
+    for (int i = 0; i < repeat; ++i) {
+        const auto begin = std::chrono::steady_clock::now();
+        function();
+        const auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+    }
+    std::sort(times.begin(), times.end());
+    BenchmarkResult result;
+    result.stage = stage;
+    result.thread_count = ResolveThreadCount(thread_count);
+    result.width = width;
+    result.height = height;
+    result.sample_count = sample_count;
+    result.median_ms = times[times.size() / 2];
+    // 最近秩法
+    result.p95_ms = times[std::min(times.size() - 1, static_cast<size_t>(std::ceil(0.95 * times.size())) - 1)];
+    result.texels_per_second = static_cast<double>(width) * height / (result.median_ms * 1e-3);
+    return result;
+}
+
+// 不依赖线程数与采样次数的阶段，只在单线程下测量一次
+void MeasureSerialStages(const BenchmarkOptions &options, const AtmosphereParameters &atmosphere,
+    const ExtendedDensityProfiles &profiles, int width, int height, std::vector<BenchmarkResult> &results) {
+    // functions.h 中的参考实现，采样次数固定为 500
+    results.push_back(Measure("reference_optical_length", 1, width, height, 500, options.repeat, [&]() {
+        const TransmittanceParameterization parameterization = CreateTransmittanceParameterization(atmosphere, width, height);
+        double sum = 0.0;
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                double r;
+                double mu;
+                parameterization.GetRMu(x, y, r, mu);
+                sum += ComputeOpticalLengthToTopAtmosphereBoundary(atmosphere, atmosphere.rayleigh_density, r, mu);
+            }
+        }
+        g_sink = g_sink + sum;
+    }));
+    // GetRMuFromTransmittanceTextureUv 使用默认纹理尺寸换算单位坐标，其他尺寸下只有耗时有意义
+    results.push_back(Measure("reference_uv_mapping", 1, width, height, 0, options.repeat, [&]() {
+        double sum = 0.0;
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                double r;
+                double mu;
+                GetRMuFromTransmittanceTextureUv(atmosphere, Vec2d(double(x) / width, double(y) / height), r, mu);
+                sum += r + mu;
+            }
+        }
+        g_sink = g_sink + sum;
+    }));
+    results.push_back(Measure("uv_mapping", 1, width, height, 0, options.repeat, [&]() {
+        const TransmittanceParameterization parameterization = CreateTransmittanceParameterization(atmosphere, width, height);
+        double sum = 0.0;
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                double r;
+                double mu;
+                parameterization.GetRMu(x, y, r, mu);
+                sum += r + mu;
+            }
+        }
+        g_sink = g_sink + sum;
+    }));
+    // 地面附近 100 m 的相机在各方向上查找按需计算的 LUT，只有最下面的一行 tile 被计算，与 bake_double 的 500 次采样比较
+    // texels_per_second 按整张 LUT 计算
+    results.push_back(Measure("lazy_ground_view", 1, width, height, 500, options.repeat, [&]() {
+        const LazyTransmittanceImage image(atmosphere, profiles, width, height);
+        const double r = atmosphere.bottom_radius + 0.1;
+        double sum = 0.0;
+        for (int i = 0; i < 1024; ++i) {
+            sum += SampleTransmittanceBilinear(image, image.GetParameterization(), r, -1.0 + 2.0 * i / 1023.0, TransmittanceLookup::ShaderUv)[0];
+        }
+        g_sink = g_sink + sum;
+    }));
+}
+
+// 依赖线程数与采样次数的阶段
+void MeasureParallelStages(const BenchmarkOptions &options, const AtmosphereParameters &atmosphere,
+    const ExtendedDensityProfiles &profiles, int width, int height, int thread_count, int sample_count,
+    std::vector<BenchmarkResult> &results) {
+    const IntegratorSettings settings{ IntegrationMode::Uniform, sample_count };
+    results.push_back(Measure("kernel_optical_lengths", thread_count, width, height, sample_count, options.repeat, [&]() {
+        const TransmittanceParameterization parameterization = CreateTransmittanceParameterization(atmosphere, width, height);
+        std::vector<double> sums(height, 0.0);
+        DispatchBakeKernel<double>(atmosphere, profiles, settings, [&](const auto &kernel) {
+            ParallelFor(height, thread_count, [&](int y) {
+                for (int x = 0; x < width; ++x) {
+                    double r;
+                    double mu;
+                    parameterization.GetRMu(x, y, r, mu);
+                    const OpticalLengths<double> lengths = kernel.ComputeOpticalLengthsToTopAtmosphereBoundary(r, mu, settings);
+                    sums[y] += lengths.rayleigh + lengths.mie + lengths.absorption;
+                }
+            });
+        });
+        for (double sum : sums) {
+            g_sink = g_sink + sum;
+        }
+    }));
+    results.push_back(Measure("bake_double", thread_count, width, height, sample_count, options.repeat, [&]() {
+        const TextureImage image = BakeTransmittance<double>(atmosphere, profiles, width, height, settings, thread_count);
+        g_sink = g_sink + image.texels[0];
+    }));
+    results.push_back(Measure("bake_float", thread_count, width, height, sample_count, options.repeat, [&]() {
+        const TextureImage image = BakeTransmittance<float>(atmosphere, profiles, width, height, settings, thread_count);
+        g_sink = g_sink + image.texels[0];
+    }));
+}
+
+void WriteResults(std::ostream &stream, const std::vector<BenchmarkResult> &results, const std::string &format) {
+    char line[256];
+    if (format == "csv") {
+        stream << "stage,threads,width,height,samples,median_ms,p95_ms,texels_per_second\n";
+        for (const BenchmarkResult &r : results) {
+            std::snprintf(line, sizeof(line), "%s,%d,%d,%d,%d,%.4f,%.4f,%.0f\n", r.stage.c_str(), r.thread_count,
+                r.width, r.height, r.sample_count, r.median_ms, r.p95_ms, r.texels_per_second);
+            stream << line;
+        }
+        return;
+    }
+    stream << "[\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult &r = results[i];
+        std::snprintf(line, sizeof(line), "  { \"stage\": \"%s\", \"threads\": %d, \"width\": %d, \"height\": %d, \"samples\": %d, "
+            "\"median_ms\": %.4f, \"p95_ms\": %.4f, \"texels_per_second\": %.0f }%s\n", r.stage.c_str(), r.thread_count,
+            r.width, r.height, r.sample_count, r.median_ms, r.p95_ms, r.texels_per_second, i + 1 < results.size() ? "," : "");
+        stream << line;
+    }
+    stream << "]\n";
+}
+
+// 读取选项中给出的大气参数与密度分布，没有给出的使用 kEarthAtmosphere 的值
+bool LoadAtmosphere(const BenchmarkOptions &options, AtmosphereParameters &atmosphere, ExtendedDensityProfiles &profiles) {
+    return LoadAtmosphere(options.atmosphere_path, options.rayleigh_profile_path, options.mie_profile_path,
+        options.absorption_profile_path, atmosphere, profiles);
+}
+
+// 在选项给出的大气参数上测量，输出到 options.output_path，为空时输出到 stdout
+bool RunAccuracy(BenchmarkOptions &options) {
+    AtmosphereParameters atmosphere;
+    ExtendedDensityProfiles profiles;
+    if (!LoadAtmosphere(options, atmosphere, profiles)) {
+        return false;
+    }
+    options.accuracy.sizes = options.sizes;
+    options.accuracy.sample_counts = options.sample_counts;
+    options.accuracy.repeat = options.repeat;
+    options.accuracy.thread_count = options.thread_counts.size() == 1 ? options.thread_counts.front() : 0;
+    const std::vector<AccuracyResult> results = RunAccuracyHarness(atmosphere, profiles, options.accuracy);
+    if (options.output_path.empty()) {
+        WriteAccuracyResults(std::cout, results, options.format);
+        return true;
+    }
+    std::ofstream file(options.output_path);
+    WriteAccuracyResults(file, results, options.format);
+    if (!file) {
+        std::cerr << "Failed to write " << options.output_path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// 在选项给出的大气参数上搜索满足 --target 的最快设置，输出到 options.output_path，为空时输出到 stdout
+bool RunTuner(BenchmarkOptions &options) {
+    AtmosphereParameters atmosphere;
+    ExtendedDensityProfiles profiles;
+    if (!LoadAtmosphere(options, atmosphere, profiles)) {
+        return false;
+    }
+    if (options.probe_count_set) {
+        options.tuner.probe_count = options.accuracy.probe_count;
+    }
+    options.tuner.reference_sample_count = options.accuracy.reference_sample_count;
+    options.tuner.repeat = options.repeat;
+    options.tuner.thread_count = options.thread_counts.size() == 1 ? options.thread_counts.front() : 0;
+    const TunerResult result = TuneTransmittance(atmosphere, profiles, options.tuner);
+    if (!result.found) {
+        std::cerr << "No setting within " << options.tuner.max_width << "x" << options.tuner.max_height
+            << " reaches " << options.tuner.target_error << ", reporting the most accurate one" << std::endl;
+    }
+    if (options.output_path.empty()) {
+        WriteTunerResult(std::cout, options.tuner, result, options.format);
+        return result.found;
+    }
+    std::ofstream file(options.output_path);
+    WriteTunerResult(file, options.tuner, result, options.format);
+    if (!file) {
+        std::cerr << "Failed to write " << options.output_path << std::endl;
+        return false;
+    }
+    return result.found;
+}
+
+int main(int argc, char **argv) {
+    BenchmarkOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        return 1;
+    }
+    if (options.mode == "accuracy") {
+        return RunAccuracy(options) ? 0 : 1;
+    }
+    if (options.mode == "tune") {
+        return RunTuner(options) ? 0 : 1;
+    }
+    AtmosphereParameters atmosphere;
+    ExtendedDensityProfiles profiles;
+    if (!LoadAtmosphere(options, atmosphere, profiles)) {
+        return 1;
+    }
+    std::vector<BenchmarkResult> results;
+    for (const auto &size : options.sizes) {
+        MeasureSerialStages(options, atmosphere, profiles, size.first, size.second, results);
+        for (int sample_count : options.sample_counts) {
+            for (int thread_count : options.thread_counts) {
+                MeasureParallelStages(options, atmosphere, profiles, size.first, size.second, thread_count, sample_count, results);
+            }
+        }
+        // 进度输出到 stderr，不影响 stdout 上的结果
+        std::cerr << "Finished " << size.first << "x" << size.second << std::endl;
+    }
+    if (options.output_path.empty()) {
+        WriteResults(std::cout, results, options.format);
+        return 0;
+    }
+    std::ofstream file(options.output_path);
+    WriteResults(file, results, options.format);
+    if (!file) {
+        std::cerr << "Failed to write " << options.output_path << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,158 @@
+#include "tuner.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <utility>
+
+#include "functions/bake.h"
+
+namespace {
+
+constexpr int kMinSampleCount = 8;
+constexpr int kMaxSampleCount = 4096;
+// 分辨率取 4 的倍数，使 BC6H 的 4x4 块对齐
+constexpr int kSizeAlignment = 4;
+constexpr int kInitialWidth = 32;
+constexpr int kInitialHeight = 8;
+
+// 为每种积分模式找到满足预算的最少采样次数，返回积分最快的设置
+IntegratorSettings TuneIntegrator(const AccuracyProbes &probes, const AtmosphereParameters &atmosphere,
+    const ExtendedDensityProfiles &profiles, const TunerOptions &options, double &error) {
+    const double budget = options.target_error * options.integrator_share;
+    IntegratorSettings best{ IntegrationMode::Uniform, kMaxSampleCount };
+    double best_ms = std::numeric_limits<double>::infinity();
+    double best_error = std::numeric_limits<double>::infinity();
+    bool best_found = false;
+    for (IntegrationMode mode : { IntegrationMode::Uniform, IntegrationMode::LayerBounded, IntegrationMode::Exponential }) {
+        for (int sample_count = kMinSampleCount; sample_count <= kMaxSampleCount; sample_count *= 2) {
+            const IntegratorSettings settings{ mode, sample_count };
+            std::vector<float> errors;
+            const double ms = MeasureMedianMilliseconds(1, [&]() {
+                errors = MeasureIntegratorErrors(probes, atmosphere, profiles, settings, options.space, options.thread_count);
+            });
+            const double quantile_error = GetErrorQuantile(errors, options.quantile);
+            const bool found = quantile_error <= budget;
+            std::cerr << "integrator " << GetIntegrationModeName(mode) << "/" << sample_count << ": error "
+                << quantile_error << ", " << ms << " ms" << std::endl;
+            // 都达不到预算时取误差最小的设置
+            if (found ? (!best_found || ms < best_ms) : (!best_found && quantile_error < best_error)) {
+                best = settings;
+                best_ms = ms;
+                best_error = quantile_error;
+                best_found = found;
+            }
+            if (found) {
+                break;
+            }
+        }
+    }
+    error = best_error;
+    return best;
+}
+
+int AlignSize(int size) {
+    return std::max(kSizeAlignment, (size + kSizeAlignment - 1) / kSizeAlignment * kSizeAlignment);
+}
+
+} // namespace
+
+TunerResult TuneTransmittance(const AtmosphereParameters &atmosphere, const ExtendedDensityProfiles &profiles,
+    const TunerOptions &options) {
+    TunerResult result;
+    const AccuracyProbes probes = CreateAccuracyProbes(atmosphere, profiles, options.probe_count,
+        options.reference_sample_count, options.seed, options.thread_count);
+    std::cerr << "Reference: " << probes.probes.size() << " probes in " << probes.reference_seconds
+        << " s, max difference to layered/" << 5 * options.reference_sample_count << " " << probes.reference_error << std::endl;
+    result.settings = TuneIntegrator(probes, atmosphere, profiles, options, result.integrator_error);
+
+    // 同一分辨率只烘焙一次
+    std::map<std::pair<int, int>, double> errors;
+    auto measure = [&](int width, int height) {
+        const auto key = std::make_pair(width, height);
+        const auto found = errors.find(key);
+        if (found != errors.end()) {
+            return found->second;
+        }
+        const TextureImage image = BakeTransmittance<double>(atmosphere, profiles, width, height, result.settings,
+            options.thread_count);
+        std::vector<float> probe_errors = MeasureLookupErrors(probes, atmosphere, image, options.lookup, options.space,
+            options.thread_count);
+        const double error = GetErrorQuantile(probe_errors, options.quantile);
+        errors[key] = error;
+        result.steps.push_back(TunerStep{ width, height, result.settings, error });
+        std::cerr << "size " << width << "x" << height << ": error " << error << std::endl;
+        return error;
+    };
+
+    int width = kInitialWidth;
+    int height = kInitialHeight;
+    double error = measure(width, height);
+    while (error > options.target_error && (width * 2 <= options.max_width || height * 2 <= options.max_height)) {
+        const double wider = width * 2 <= options.max_width ? measure(width * 2, height) : std::numeric_limits<double>::infinity();
+        const double taller = height * 2 <= options.max_height ? measure(width, height * 2) : std::numeric_limits<double>::infinity();
+        if (wider <= taller) {
+            width *= 2;
+            error = wider;
+        } else {
+            height *= 2;
+            error = taller;
+        }
+    }
+    result.found = error <= options.target_error;
+    if (result.found) {
+        // 先将 upper 减半直到不满足，再在 (lower, upper] 中二分查找
+        // 加倍时只比较了宽与高中误差下降更多的一方，另一方减半后仍可能满足
+        auto shrink = [&](int upper, auto error_at) {
+            int lower = AlignSize(upper / 2);
+            while (lower < upper && error_at(lower) <= options.target_error) {
+                upper = lower;
+                lower = AlignSize(upper / 2);
+            }
+            while (upper - lower > kSizeAlignment) {
+                const int middle = AlignSize((lower + upper) / 2);
+                if (middle >= upper || middle <= lower) {
+                    break;
+                }
+                if (error_at(middle) <= options.target_error) {
+                    upper = middle;
+                } else {
+                    lower = middle;
+                }
+            }
+            return upper;
+        };
+        width = shrink(width, [&](int w) { return measure(w, height); });
+        height = shrink(height, [&](int h) { return measure(width, h); });
+        error = measure(width, height);
+    }
+    result.width = width;
+    result.height = height;
+    result.error = error;
+    result.bake_ms = MeasureMedianMilliseconds(options.repeat, [&]() {
+        BakeTransmittance<double>(atmosphere, profiles, width, height, result.settings, options.thread_count);
+    });
+    return result;
+}
+
+void WriteTunerResult(std::ostream &stream, const TunerOptions &options, const TunerResult &result, const std::string &format) {
+    char line[512];
+    if (format == "csv") {
+        stream << "target,quantile,space,lookup,found,width,height,integrator,samples,error,integrator_error,bake_ms\n";
+        std::snprintf(line, sizeof(line), "%.4e,%.4f,%s,%s,%d,%d,%d,%s,%d,%.4e,%.4e,%.4f\n", options.target_error,
+            options.quantile, GetErrorSpaceName(options.space), GetTransmittanceLookupName(options.lookup), result.found ? 1 : 0,
+            result.width, result.height, GetIntegrationModeName(result.settings.mode), result.settings.sample_count,
+            result.error, result.integrator_error, result.bake_ms);
+        stream << line;
+        return;
+    }
+    std::snprintf(line, sizeof(line), "{ \"target\": %.4e, \"quantile\": %.4f, \"space\": \"%s\", \"lookup\": \"%s\", "
+        "\"found\": %s, \"width\": %d, \"height\": %d, \"integrator\": \"%s\", \"samples\": %d, \"error\": %.4e, "
+        "\"integrator_error\": %.4e, \"bake_ms\": %.4f }\n", options.target_error, options.quantile,
+        GetErrorSpaceName(options.space), GetTransmittanceLookupName(options.lookup), result.found ? "true" : "false",
+        result.width, result.height, GetIntegrationModeName(result.settings.mode), result.settings.sample_count,
+        result.error, result.integrator_error, result.bake_ms);
+    stream << line;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "accuracy.h"
+
+// 在误差预算内寻找烘焙最快的透射率 LUT 分辨率与积分设置
+struct TunerOptions {
+    // 探测点误差的 quantile 分位数不超过 target_error，quantile 为 1 时即最大误差
+    double target_error = 1e-2;
+    double quantile = 1.0;
+    ErrorSpace space = ErrorSpace::Linear;
+    TransmittanceLookup lookup = TransmittanceLookup::ShaderUv;
+    // 积分误差占预算的比例，其余留给 LUT 的插值
+    double integrator_share = 0.25;
+    int probe_count = 200000;
+    int reference_sample_count = 1000;
+    uint64_t seed = 1;
+    int max_width = 2048;
+    int max_height = 1024;
+    int repeat = 3;
+    // 0 表示使用硬件线程数
+    int thread_count = 0;
+};
+
+// 搜索中烘焙过的一个设置
+struct TunerStep {
+    int width;
+    int height;
+    IntegratorSettings settings;
+    double error;
+};
+
+struct TunerResult {
+    // 在最大分辨率内是否达到 target_error，否则为搜索到的误差最小的设置
+    bool found = false;
+    int width = 0;
+    int height = 0;
+    IntegratorSettings settings;
+    double error = 0.0;
+    // 只积分、不经过 LUT 的误差
+    double integrator_error = 0.0;
+    double bake_ms = 0.0;
+    std::vector<TunerStep> steps;
+};
+
+// 先为每种积分模式将采样次数从 8 开始加倍，直到直接积分的误差在 integrator_share 的预算内，选择其中积分最快的；
+// 再从 32x8 开始，每次将宽或高中误差下降更多的一方加倍，直到满足 target_error，
+// 最后分别将宽与高减半直到不满足误差，再二分查找满足误差的最小值
+TunerResult TuneTransmittance(const AtmosphereParameters &atmosphere, const ExtendedDensityProfiles &profiles,
+    const TunerOptions &options);
+
+void WriteTunerResult(std::ostream &stream, const TunerOptions &options, const TunerResult &result, const std::string &format);
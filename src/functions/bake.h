@@ -0,0 +1,187 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+
+#include "densityTable.h"
+#include "kernel.h"
+#include "output/texture.h"
+#include "parallel/taskGraph.h"
+#include "profile/trace.h"
+
+// GetRMuFromTransmittanceTextureUv 中只与行有关的量
+struct TransmittanceRow {
+    // 射线起点与行星中心的距离
+    double r;
+    // 射线起点到大气顶部的距离在 mu = 1 时的值，及其到地平线方向的取值范围
+    double d_min;
+    double d_range;
+    // H^2 - rho^2
+    double horizon_term;
+    double two_r;
+};
+
+// 透射率贴图的参数化表，行参数按行、x_mu 按列只计算一次，每个纹素只剩一次乘加与一次除法
+// 纹素 (x, y) 对应 uv = (x / width, y / height)，与原来逐纹素调用 ComputeTransmittanceToTopAtmosphereBoundaryTexture 相同
+struct TransmittanceParameterization {
+    int width = 0;
+    int height = 0;
+    double bottom_radius = 0.0;
+    double top_radius = 0.0;
+    // 射向地平线的射线，从地表到大气顶部的距离 H
+    double horizon_distance = 0.0;
+    std::vector<double> x_mu;
+    std::vector<TransmittanceRow> rows;
+
+    // 单位坐标 x_r 所在行的参数
+    TransmittanceRow GetRow(double x_r) const {
+        const double H = horizon_distance;
+        const double rho = H * x_r;
+        TransmittanceRow row;
+        row.r = std::sqrt(rho * rho + bottom_radius * bottom_radius);
+        row.d_min = top_radius - row.r;
+        row.d_range = rho + H - row.d_min;
+        row.horizon_term = H * H - rho * rho;
+        row.two_r = 2.0 * row.r;
+        return row;
+    }
+
+    static void GetRMuFromRow(const TransmittanceRow &row, double x_mu, double &r, double &mu) {
+        const double d = row.d_min + x_mu * row.d_range;
+        r = row.r;
+        mu = d == 0.0 ? 1.0 : (row.horizon_term - d * d) / (row.two_r * d);
+        mu = std::clamp(mu, -1.0, 1.0);
+    }
+
+    void GetRMu(int x, int y, double &r, double &mu) const {
+        GetRMuFromRow(rows[y], x_mu[x], r, mu);
+    }
+
+    // 单位坐标 (x_mu, x_r) 与 (r, mu) 的相互转换，只用到半径，与贴图的尺寸无关
+    void GetRMuFromUnitCoords(double x_mu, double x_r, double &r, double &mu) const {
+        GetRMuFromRow(GetRow(x_r), x_mu, r, mu);
+    }
+
+    void GetUnitCoordsFromRMu(double r, double mu, double &x_mu, double &x_r) const {
+        const double H = horizon_distance;
+        const double rho = std::sqrt(std::max((r - bottom_radius) * (r + bottom_radius), 0.0));
+        const double discriminant = r * r * (mu * mu - 1.0) + top_radius * top_radius;
+        const double d = std::max(-r * mu + std::sqrt(std::max(discriminant, 0.0)), 0.0);
+        const double d_min = top_radius - r;
+        const double d_max = rho + H;
+        x_mu = d_max > d_min ? (d - d_min) / (d_max - d_min) : 0.0;
+        x_r = rho / H;
+    }
+};
+
+// width 与 height 为 0 时不建立行与列的表，只用于单位坐标的转换
+inline TransmittanceParameterization CreateTransmittanceParameterization(const AtmosphereParameters &atmosphere, int width, int height) {
+    // 与 GetUnitRangeFromTextureCoord 相同
+    auto unit_range = [](double u, int texture_size) {
+        return (u - 0.5 / double(texture_size)) / (1.0 - 1.0 / double(texture_size));
+    };
+    TransmittanceParameterization parameterization;
+    parameterization.width = width;
+    parameterization.height = height;
+    parameterization.bottom_radius = atmosphere.bottom_radius;
+    parameterization.top_radius = atmosphere.top_radius;
+    parameterization.horizon_distance = std::sqrt((atmosphere.top_radius - atmosphere.bottom_radius) *
+        (atmosphere.top_radius + atmosphere.bottom_radius));
+    parameterization.x_mu.resize(width);
+    for (int x = 0; x < width; ++x) {
+        parameterization.x_mu[x] = unit_range(double(x) / double(width), width);
+    }
+    parameterization.rows.resize(height);
+    for (int y = 0; y < height; ++y) {
+        parameterization.rows[y] = parameterization.GetRow(unit_range(double(y) / double(height), height));
+    }
+    return parameterization;
+}
+
+// 三种粒子都使用累积密度表的 kernel，用于超过两层或表格形式的密度分布
+template<class Scalar>
+using TabulatedTransmittanceKernel = TransmittanceKernel<Scalar, DensityTable<Scalar>, DensityTable<Scalar>, DensityTable<Scalar>>;
+
+template<class Scalar>
+TabulatedTransmittanceKernel<Scalar> CreateTabulatedTransmittanceKernel(const AtmosphereParameters &atmosphere,
+    const ExtendedDensityProfiles &profiles) {
+    const double max_altitude = atmosphere.top_radius - atmosphere.bottom_radius;
+    return TabulatedTransmittanceKernel<Scalar>{
+        static_cast<Scalar>(atmosphere.bottom_radius),
+        static_cast<Scalar>(atmosphere.top_radius),
+        CastSpectrum<Scalar>(atmosphere.rayleigh_scattering),
+        DensityTable<Scalar>::From(profiles.rayleigh, max_altitude),
+        CastSpectrum<Scalar>(atmosphere.mie_extinction),
+        DensityTable<Scalar>::From(profiles.mie, max_altitude),
+        CastSpectrum<Scalar>(atmosphere.absorption_extinction),
+        DensityTable<Scalar>::From(profiles.absorption, max_altitude) };
+}
+
+// 按行分配到 thread_count 个线程上，为 0 时使用硬件线程数；每个纹素独立计算，结果与线程数无关
+// cost 不为空时在其中写出每个纹素的开销：R 为积分的采样点数，G 为耗时（纳秒），B 为 0
+// 采样点数来自 TraceCounter::Samples，需要先调用 StartTraceCounters
+template<class Kernel>
+void BakeTransmittanceWithKernel(const TransmittanceParameterization &parameterization, const Kernel &kernel,
+    const IntegratorSettings &settings, TextureImage &transmittance, int thread_count = 1, TextureImage *cost = nullptr) {
+    using Scalar = typename Kernel::ScalarType;
+    RunTaskRange(parameterization.height, thread_count, [&](int y) {
+        TRACE_SCOPE("bake_row");
+        TRACE_COUNT(Texels, parameterization.width);
+        for (int x = 0; x < parameterization.width; ++x) {
+            const auto begin = cost ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+            const uint64_t begin_samples = cost ? GetThreadTraceCount(TraceCounter::Samples) : 0;
+            double r;
+            double mu;
+            parameterization.GetRMu(x, y, r, mu);
+            const Vec3<Scalar> trans = kernel.ComputeTransmittanceToTopAtmosphereBoundary(static_cast<Scalar>(r), static_cast<Scalar>(mu), settings);
+            float *texel = transmittance.GetTexel(x, y);
+            texel[0] = static_cast<float>(trans.x);
+            texel[1] = static_cast<float>(trans.y);
+            texel[2] = static_cast<float>(trans.z);
+            if (cost) {
+                float *cost_texel = cost->GetTexel(x, y);
+                cost_texel[0] = static_cast<float>(GetThreadTraceCount(TraceCounter::Samples) - begin_samples);
+                cost_texel[1] = static_cast<float>(
+                    std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count());
+                cost_texel[2] = 0.0f;
+            }
+        }
+    });
+}
+
+// 选择适用于 atmosphere 与 profiles 的 kernel 并调用 function(kernel)：
+// 密度分布都可以表示为 DensityProfile 时与 DispatchTransmittanceKernel 相同，否则或 settings.density_table 为 true 时使用累积密度表
+template<class Scalar, class Function>
+void DispatchBakeKernel(const AtmosphereParameters &atmosphere, const ExtendedDensityProfiles &profiles,
+    const IntegratorSettings &settings, Function function) {
+    AtmosphereParameters two_layer_atmosphere = atmosphere;
+    if (!settings.density_table && ApplyExtendedDensityProfiles(profiles, two_layer_atmosphere)) {
+        DispatchTransmittanceKernel<Scalar>(two_layer_atmosphere, function);
+    } else {
+        function(CreateTabulatedTransmittanceKernel<Scalar>(atmosphere, profiles));
+    }
+}
+
+// 使用标量类型为 Scalar 的 kernel 烘焙 width x height 的透射率贴图
+// 密度分布可以是任意层数或表格，见 DispatchBakeKernel；cost 不为空时写出每个纹素的开销，见 BakeTransmittanceWithKernel
+template<class Scalar>
+TextureImage BakeTransmittance(const AtmosphereParameters &atmosphere, const ExtendedDensityProfiles &profiles,
+    int width, int height, const IntegratorSettings &settings = IntegratorSettings(), int thread_count = 1,
+    TextureImage *cost = nullptr) {
+    TRACE_SCOPE("BakeTransmittance");
+    const TransmittanceParameterization parameterization = CreateTransmittanceParameterization(atmosphere, width, height);
+    TextureImage transmittance(width, height);
+    if (cost) {
+        *cost = TextureImage(width, height);
+    }
+    DispatchBakeKernel<Scalar>(atmosphere, profiles, settings, [&](const auto &kernel) {
+        BakeTransmittanceWithKernel(parameterization, kernel, settings, transmittance, thread_count, cost);
+    });
+    return transmittance;
+}
+
+template<class Scalar>
+TextureImage BakeTransmittance(const AtmosphereParameters &atmosphere, int width, int height,
+    const IntegratorSettings &settings = IntegratorSettings(), int thread_count = 1) {
+    return BakeTransmittance<Scalar>(atmosphere, GetExtendedDensityProfiles(atmosphere), width, height, settings, thread_count);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "atmosphereParameters/densityProfile.h"
+#include "integrator.h"
+
+// 任意层数或表格形式的密度分布，预先计算在海拔 [begin, end] 上等间距的累积密度 C(h) = ∫_begin^h density
+// 积分时相邻采样点之间的光学距离由 C 的差得到，与分布的层数和样本数无关，每个采样点只需常数次查表
+// 单元格内把密度看作过单元格平均值、斜率取相邻单元格中心差分的直线，C 在单元格内是二次函数，
+// 细于单元格的层仍然保留了正确的积分
+// 表格总是使用 double，float 下相近的 C 相减会损失精度
+template<class Scalar>
+struct DensityTable {
+    static constexpr DensityShape kShape = DensityShape::Tabulated;
+    // 只查表，不调用 exp
+    static constexpr int kExpCalls = 0;
+    // 默认的单元格数，地球大气 60 km 时约为 15 m
+    static constexpr int kDefaultCellCount = 4096;
+
+    double begin = 0.0;
+    double end = 0.0;
+    double cell_size = 1.0;
+    // 单元格边界处的 C，比 means 多一个
+    std::vector<double> cumulative;
+    // 各单元格的平均密度
+    std::vector<double> means;
+
+    static DensityTable From(const ExtendedDensityProfile &profile, double max_altitude,
+        int cell_count = kDefaultCellCount) {
+        DensityTable table;
+        GetExtendedProfileRange(profile, max_altitude, table.begin, table.end);
+        table.cell_size = std::max(table.end - table.begin, 1e-9) / cell_count;
+        table.cumulative.resize(cell_count + 1);
+        table.means.resize(cell_count);
+        table.cumulative[0] = 0.0;
+        for (int i = 0; i < cell_count; ++i) {
+            const double cell_begin = table.begin + i * table.cell_size;
+            const double integral = IntegrateExtendedProfileDensity(profile, cell_begin, cell_begin + table.cell_size);
+            table.cumulative[i + 1] = table.cumulative[i] + integral;
+            table.means[i] = integral / table.cell_size;
+        }
+        return table;
+    }
+
+    // 单元格 i 内密度的斜率
+    double GetSlope(size_t i) const {
+        const size_t lower = i > 0 ? i - 1 : i;
+        const size_t upper = std::min(i + 1, means.size() - 1);
+        return upper > lower ? (means[upper] - means[lower]) / (double(upper - lower) * cell_size) : 0.0;
+    }
+
+    // altitude 处密度的导数，超出范围时取端点所在单元格的值
+    double GetDerivative(double altitude) const {
+        const double x = std::clamp((altitude - begin) / cell_size, 0.0, double(means.size() - 1));
+        return GetSlope(static_cast<size_t>(x));
+    }
+
+    // 海拔 altitude 以下的累积密度，超出范围时取端点的值
+    double GetCumulative(double altitude) const {
+        const double x = std::clamp((altitude - begin) / cell_size, 0.0, double(means.size()));
+        const size_t i = std::min(static_cast<size_t>(x), means.size() - 1);
+        const double u = x - double(i);
+        return cumulative[i] + (means[i] * u + GetSlope(i) * cell_size * (u * u - u) * 0.5) * cell_size;
+    }
+
+    // 相邻单元格中心之间线性插值的密度
+    Scalar operator()(Scalar altitude) const {
+        const double x = (double(altitude) - begin) / cell_size;
+        if (!(x >= 0.0 && x < double(means.size()))) {
+            return Scalar(0.0);
+        }
+        const double center = std::clamp(x - 0.5, 0.0, double(means.size() - 1));
+        const size_t i = std::min(static_cast<size_t>(center), means.size() - 1);
+        const size_t j = std::min(i + 1, means.size() - 1);
+        const double u = center - double(i);
+        return static_cast<Scalar>(means[i] * (1.0 - u) + means[j] * u);
+    }
+
+    DensityBreakpoints GetBreakpoints() const {
+        DensityBreakpoints breakpoints;
+        breakpoints.count = 2;
+        breakpoints.altitudes[0] = begin;
+        breakpoints.altitudes[1] = end;
+        return breakpoints;
+    }
+};
@@ -4,7 +4,7 @@
 #include "atmosphereParameters/definitions.h"
 #include "util.h"
 
-// ľ
+// 距离大气顶部的距离
 Length DistanceToTopAtmosphereBoundary(IN(AtmosphereParameters) atmosphere, Length r, Number mu) {
     assert(r <= atmosphere.top_radius);
     assert(mu >= -1.0 && mu <= 1.0);
@@ -12,7 +12,7 @@ Length DistanceToTopAtmosphereBoundary(IN(AtmosphereParameters) atmosphere, Leng
     return ClampDistance(-r * mu + SafeSqrt(discriminant));
 }
 
-// رľ
+// 距离地表的距离
 Length DistanceToBottomAtmosphereBoundary(IN(AtmosphereParameters) atmosphere, Length r, Number mu) {
     assert(r >= atmosphere.bottom_radius);
     assert(mu >= -1.0 && mu <= 1.0);
@@ -20,62 +20,62 @@ Length DistanceToBottomAtmosphereBoundary(IN(AtmosphereParameters) atmosphere, L
     return ClampDistance(-r * mu - SafeSqrt(discriminant));
 }
 
-// Ƿཻ
+// 射线是否与地球相交
 bool RayIntersectsGround(IN(AtmosphereParameters) atmosphere, Length r, Number mu) {
     assert(r >= atmosphere.bottom_radius);
     assert(mu >= -1.0 && mu <= 1.0);
     return (mu < 0.0) && (r * r * (mu * mu - 1.0) + atmosphere.bottom_radius * atmosphere.bottom_radius >= 0.0f * m2);
 }
 
-// ָ㼶Ĵܶ
-// ڼǳʱùʽ˻Ϊ Number = exp(layer.exp_scale * altitude);
-// ڼʱùʽ˻Ϊ Numer = layer.linear_term * altitude + layer.constant_term;
+// 返回指定大气层级的大气密度
+// 在计算非臭氧大气粒子时该公式退化为 Number = exp(layer.exp_scale * altitude);
+// 在计算臭氧时该公式退化为 Numer = layer.linear_term * altitude + layer.constant_term;
 Number GetLayerDensity(IN(DensityProfileLayer) layer, Length altitude) {
     const Number density = layer.exp_term * exp(layer.exp_scale * altitude) + layer.linear_term * altitude + layer.constant_term;
     return clamp(density, Number(0.0), Number(1.0));
 }
 
-// ݺѡͬĴ㼶
+// 多层大气，根据海拔选择不同的大气层级
 Number GetProfileDensity(IN(DensityProfile) profile, Length altitude) {
     return altitude < profile.layers[0].width ?
         GetLayerDensity(profile.layers[0], altitude) :
         GetLayerDensity(profile.layers[1], altitude);
 }
 
-// 㵽֮Ĺѧ
+// 从射线起点到其与大气顶部交点之间的光学距离
 Length ComputeOpticalLengthToTopAtmosphereBoundary(IN(AtmosphereParameters) atmosphere, IN(DensityProfile) profile, Length r, Number mu) {
     assert(r >= atmosphere.bottom_radius && r <= atmosphere.top_radius);
     assert(mu >= -1.0 && mu <= 1.0);
-    // 
+    // 采样次数
     const int SAMPLE_COUNT = 500;
-    // ֵĳ
+    // 积分的长度
     const Length dx = DistanceToTopAtmosphereBoundary(atmosphere, r, mu) / Number(SAMPLE_COUNT);
     Length result = 0.0 * m;
     for (int i = 0; i <= SAMPLE_COUNT; ++i) {
         const Length d_i = Number(i) * dx;
-        // ǰĵľ
+        // 当前采样点与行星中心的距离
         const Length r_i = sqrt(d_i * d_i + 2.0 * r * mu * d_i + r * r);
-        // ĴܶȣԴײĴܶȣ
+        // 采样点的大气密度（除以大气底部的大气密度）
         const Number y_i = GetProfileDensity(profile, r_i - atmosphere.bottom_radius);
-        // Ȩ
+        // 采样权重
         const Number weight_i = i == 0 || i == SAMPLE_COUNT ? 0.5 : 1.0;
         result += y_i * weight_i * dx;
     }
     return result;
 }
 
-// 㵽֮͸ʣɢ䡢ɢ䡢
+// 从射线起点到其与大气顶部交点之间的透射率，考虑瑞利散射、米氏散射、吸收
 DimensionlessSpectrum ComputeTransmittanceToTopAtmosphereBoundary(IN(AtmosphereParameters) atmosphere, Length r, Number mu) {
     assert(r >= atmosphere.bottom_radius && r <= atmosphere.top_radius);
     assert(mu >= -1.0 && mu <= 1.0);
-    // rayleigh_scattering == rayleigh_extinctionɢ䲻չ
+    // rayleigh_scattering == rayleigh_extinction，瑞利散射不吸收光
     const DimensionlessSpectrum rayleighTerm = atmosphere.rayleigh_scattering * ComputeOpticalLengthToTopAtmosphereBoundary(atmosphere, atmosphere.rayleigh_density, r, mu);
     const DimensionlessSpectrum mieTerm = atmosphere.mie_extinction * ComputeOpticalLengthToTopAtmosphereBoundary(atmosphere, atmosphere.mie_density, r, mu);
     const DimensionlessSpectrum ozoneTerm = atmosphere.absorption_extinction * ComputeOpticalLengthToTopAtmosphereBoundary(atmosphere, atmosphere.absorption_density, r, mu);
     return exp(-(rayleighTerm + mieTerm + ozoneTerm));
 }
 
-// ӳ
+// 参数化重映射
 Number GetUnitRangeFromTextureCoord(Number u, int texture_size) {
     return (u - 0.5 / Number(texture_size)) / (1.0 - 1.0 / Number(texture_size));
 }
@@ -86,12 +86,12 @@ void GetRMuFromTransmittanceTextureUv(IN(AtmosphereParameters) atmosphere, IN(Ve
     assert(uv.y >= 0.0 && uv.y <= 1.0);
     Number x_mu = GetUnitRangeFromTextureCoord(uv.x, TRANSMITTANCE_TEXTURE_WIDTH);
     Number x_r = GetUnitRangeFromTextureCoord(uv.y, TRANSMITTANCE_TEXTURE_HEIGHT);
-    // ƽߵߣӵرľ
+    // 射向地平线的射线，从地表到大气顶部的距离
     Length H = sqrt(atmosphere.top_radius * atmosphere.top_radius - atmosphere.bottom_radius * atmosphere.bottom_radius);
-    // ƽߵߣ㵽رľ
+    // 射向地平线的射线，从起点到地表的距离
     Length rho = H * x_r;
     r = sqrt(rho * rho + atmosphere.bottom_radius * atmosphere.bottom_radius);
-    // 㵽߽ľ룬 mu ϵСֵr, 1ֵr, mu_horizon
+    // 射线起点到顶部大气边界的距离，及其在所有 mu 上的最小值（r, 1）和最大值（r, mu_horizon）
     Length d_min = atmosphere.top_radius - r;
     Length d_max = rho + H;
     Length d = d_min + x_mu * (d_max - d_min);
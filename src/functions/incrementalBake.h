@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+
+#include "bake.h"
+
+// 分帧烘焙透射率贴图：运行时修改大气参数（天气、切换星球）时，每帧调用 Step 计算一部分纹素，
+// 新版本完成后才替换当前版本，渲染始终读取一张完整的贴图
+// 纹素的计算与 BakeTransmittance 相同，完成的版本与一次烘焙的结果逐位相同
+// 之后加入散射等阶段时，按阶段顺序排在透射率之后，在最后一个阶段完成时一起交换
+class IncrementalTransmittanceBaker {
+public:
+    IncrementalTransmittanceBaker(int width, int height, const IntegratorSettings &settings = IntegratorSettings()) :
+        width_(width), height_(height), settings_(settings) {}
+
+    // 开始烘焙新的参数，正在进行的烘焙被丢弃并从头开始
+    void Restart(const AtmosphereParameters &atmosphere, const ExtendedDensityProfiles &profiles) {
+        parameterization_ = CreateTransmittanceParameterization(atmosphere, width_, height_);
+        const IntegratorSettings settings = settings_;
+        DispatchBakeKernel<double>(atmosphere, profiles, settings, [&](const auto &kernel) {
+            compute_texel_ = [kernel, settings](double r, double mu) {
+                return kernel.ComputeTransmittanceToTopAtmosphereBoundary(r, mu, settings);
+            };
+        });
+        // 渲染线程不再持有的旧版本可以复用为后缓冲
+        if (!back_ || back_.use_count() > 1) {
+            back_ = std::make_shared<TextureImage>(width_, height_);
+        }
+        next_texel_ = 0;
+        baking_ = true;
+    }
+
+    void Restart(const AtmosphereParameters &atmosphere) {
+        Restart(atmosphere, GetExtendedDensityProfiles(atmosphere));
+    }
+
+    // 放弃正在进行的烘焙，当前版本不变
+    void Cancel() {
+        baking_ = false;
+        next_texel_ = 0;
+    }
+
+    // 在约 budget_microseconds 内计算尽可能多的纹素（至少一个），超出的时间不超过一个纹素的耗时
+    // 最后一个纹素完成时交换缓冲并返回 true
+    bool Step(double budget_microseconds) {
+        if (!baking_) {
+            return false;
+        }
+        TRACE_SCOPE("IncrementalTransmittanceBaker::Step");
+        const auto deadline = std::chrono::steady_clock::now() +
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::micro>(budget_microseconds));
+        const int texel_count = width_ * height_;
+        const int first_texel = next_texel_;
+        do {
+            const int x = next_texel_ % width_;
+            const int y = next_texel_ / width_;
+            double r;
+            double mu;
+            parameterization_.GetRMu(x, y, r, mu);
+            const Vec3d trans = compute_texel_(r, mu);
+            float *texel = back_->GetTexel(x, y);
+            texel[0] = static_cast<float>(trans.x);
+            texel[1] = static_cast<float>(trans.y);
+            texel[2] = static_cast<float>(trans.z);
+            ++next_texel_;
+        } while (next_texel_ < texel_count && std::chrono::steady_clock::now() < deadline);
+        TRACE_COUNT(Texels, next_texel_ - first_texel);
+        if (next_texel_ < texel_count) {
+            return false;
+        }
+        // 发布新版本，旧版本成为下一次烘焙的后缓冲
+        std::shared_ptr<const TextureImage> previous = std::atomic_exchange(&current_, std::shared_ptr<const TextureImage>(back_));
+        back_ = std::const_pointer_cast<TextureImage>(previous);
+        ++version_;
+        baking_ = false;
+        return true;
+    }
+
+    bool IsBaking() const {
+        return baking_;
+    }
+
+    // 正在进行的烘焙已完成的比例
+    double GetProgress() const {
+        return static_cast<double>(next_texel_) / (static_cast<double>(width_) * height_);
+    }
+
+    // 最近完成的版本，可以在其他线程上调用；尚未完成任何版本时为空
+    std::shared_ptr<const TextureImage> GetCurrent() const {
+        return std::atomic_load(&current_);
+    }
+
+    // 已完成的版本数
+    uint64_t GetVersion() const {
+        return version_;
+    }
+
+private:
+    int width_;
+    int height_;
+    IntegratorSettings settings_;
+    TransmittanceParameterization parameterization_;
+    // kernel 的类型由 DispatchBakeKernel 决定，保存为按 (r, mu) 计算透射率的函数
+    std::function<Vec3d(double, double)> compute_texel_;
+    std::shared_ptr<const TextureImage> current_;
+    std::shared_ptr<TextureImage> back_;
+    int next_texel_ = 0;
+    bool baking_ = false;
+    uint64_t version_ = 0;
+};
@@ -0,0 +1,328 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "profile/trace.h"
+
+enum class IntegrationMode {
+    // 在射线到大气顶部的整段上均匀采样，三种粒子共用采样点
+    Uniform,
+    // 每种粒子只在密度不为 0 的海拔范围内积分，并在密度分布的分段处拆开
+    LayerBounded,
+    // 与 LayerBounded 的区间相同，指数分布在相邻采样点之间按对数线性插值积分，线性分布减去梯形法则的误差，
+    // 约 50 次采样即可达到 Uniform 500 次采样的精度
+    Exponential,
+};
+
+inline const char *GetIntegrationModeName(IntegrationMode mode) {
+    switch (mode) {
+    case IntegrationMode::Uniform: return "uniform";
+    case IntegrationMode::LayerBounded: return "layered";
+    case IntegrationMode::Exponential: return "exponential";
+    }
+    return "unknown";
+}
+
+inline bool ParseIntegrationMode(const char *name, IntegrationMode &mode) {
+    for (IntegrationMode candidate : { IntegrationMode::Uniform, IntegrationMode::LayerBounded,
+        IntegrationMode::Exponential }) {
+        if (std::strcmp(name, GetIntegrationModeName(candidate)) == 0) {
+            mode = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// 密度分布描述的形状，决定 Exponential 模式下每个区间使用的积分公式
+enum class DensityShape {
+    // exp(exp_scale * h)
+    Exponential,
+    // 每个分段内为 linear_term * h + constant_term
+    Linear,
+    // 不分析各项，使用梯形法则
+    Generic,
+    // 累积密度表，见 DensityTable，在所有模式下都使用 IntegrateRaySegmentCumulative
+    Tabulated,
+};
+
+struct IntegratorSettings {
+    IntegrationMode mode = IntegrationMode::Uniform;
+    // Uniform 为整段射线的采样次数，其余模式为每种粒子在所有区间上的采样次数之和
+    int sample_count = 500;
+    // 密度分布总是转换为累积密度表积分，用于验证 DensityTable 的精度
+    bool density_table = false;
+};
+
+// 三种粒子到大气顶部的光学距离，只与几何和密度分布有关，乘以各自的消光系数后即可得到透射率
+template<class Scalar>
+struct OpticalLengths {
+    Scalar rayleigh;
+    Scalar mie;
+    Scalar absorption;
+};
+
+// 光学距离的累加器，double 直接累加
+template<class Scalar>
+struct OpticalLengthSum {
+    Scalar sum = 0.0;
+
+    void Add(Scalar value) {
+        sum += value;
+    }
+
+    Scalar Get() const {
+        return sum;
+    }
+};
+
+// float 累加 500 次的舍入误差可以达到 1e-5 量级，使用 Kahan-Neumaier 补偿求和
+template<>
+struct OpticalLengthSum<float> {
+    float sum = 0.0f;
+    float compensation = 0.0f;
+
+    void Add(float value) {
+        const float t = sum + value;
+        compensation += std::abs(sum) >= std::abs(value) ? (sum - t) + value : (value - t) + sum;
+        sum = t;
+    }
+
+    float Get() const {
+        return sum + compensation;
+    }
+};
+
+// 射线上与起点距离为 d 处的海拔
+// 由 (r_d^2 - bottom^2) / (r_d + bottom) 得到，避免 r_d - bottom 在 float 下的相消误差
+template<class Scalar>
+struct RayAltitude {
+    Scalar two_r_mu;
+    // r^2 - bottom^2
+    Scalar r_squared_above_bottom;
+    Scalar bottom_radius;
+    Scalar bottom_radius_squared;
+    // 射线到行星中心距离的平方 r^2 (1 - mu^2)
+    Scalar impact_parameter_squared;
+
+    RayAltitude(Scalar r, Scalar mu, Scalar bottom_radius) :
+        two_r_mu(Scalar(2.0) * r * mu),
+        r_squared_above_bottom((r - bottom_radius) * (r + bottom_radius)),
+        bottom_radius(bottom_radius),
+        bottom_radius_squared(bottom_radius * bottom_radius),
+        impact_parameter_squared(r * r * (Scalar(1.0) - mu * mu)) {}
+
+    Scalar operator()(Scalar d) const {
+        const Scalar r_d_squared_above_bottom = d * (d + two_r_mu) + r_squared_above_bottom;
+        const Scalar r_d = std::sqrt(r_d_squared_above_bottom + bottom_radius_squared);
+        return r_d_squared_above_bottom / (r_d + bottom_radius);
+    }
+};
+
+// 密度分布的分段海拔：海拔在 [altitudes[0], altitudes[count - 1]] 之外时密度为 0，相邻两个分段海拔之间密度是光滑的
+// 没有上下界时使用正负无穷
+struct DensityBreakpoints {
+    static constexpr int kMaxCount = 3;
+    int count = 0;
+    double altitudes[kMaxCount];
+};
+
+// 射线上 [begin, end] 的一段
+struct RaySegment {
+    double begin;
+    double end;
+};
+
+// 射线 d ∈ [0, distance] 上与行星中心的距离位于 [inner_radius, outer_radius] 的部分，
+// 即射线与球壳的交，最多两段（射线先向下穿过内球再向上），写入 segments 并返回段数
+inline int IntersectRayWithShell(double r, double mu, double distance, double inner_radius, double outer_radius,
+    RaySegment segments[2]) {
+    // 射线与半径为 radius 的球的交点为 -r mu ± sqrt(discriminant)，
+    // discriminant = radius^2 - r^2 + (r mu)^2，先相减避免大数相消
+    auto discriminant = [r, mu](double radius) {
+        return (radius - r) * (radius + r) + (r * mu) * (r * mu);
+    };
+    double begin = 0.0;
+    double end = distance;
+    if (outer_radius < std::numeric_limits<double>::infinity()) {
+        const double outer = discriminant(outer_radius);
+        if (outer <= 0.0) {
+            return 0;
+        }
+        begin = std::max(begin, -r * mu - std::sqrt(outer));
+        end = std::min(end, -r * mu + std::sqrt(outer));
+    }
+    if (begin >= end) {
+        return 0;
+    }
+    const double inner = inner_radius > 0.0 ? discriminant(inner_radius) : 0.0;
+    if (inner <= 0.0) {
+        segments[0] = RaySegment{ begin, end };
+        return 1;
+    }
+    // 去掉射线在内球中的部分
+    int count = 0;
+    const double inner_begin = -r * mu - std::sqrt(inner);
+    const double inner_end = -r * mu + std::sqrt(inner);
+    if (begin < std::min(end, inner_begin)) {
+        segments[count++] = RaySegment{ begin, std::min(end, inner_begin) };
+    }
+    if (std::max(begin, inner_end) < end) {
+        segments[count++] = RaySegment{ std::max(begin, inner_end), end };
+    }
+    return count;
+}
+
+// 梯形法则，与 ComputeOpticalLengthToTopAtmosphereBoundary 相同，只是积分区间为 [begin, end]
+template<class Scalar, class Density>
+Scalar IntegrateRaySegment(const Density &density, const RayAltitude<Scalar> &altitude, Scalar begin, Scalar end,
+    int sample_count) {
+    const Scalar dx = (end - begin) / Scalar(sample_count);
+    OpticalLengthSum<Scalar> result;
+    for (int i = 0; i <= sample_count; ++i) {
+        const Scalar d_i = begin + Scalar(i) * dx;
+        const Scalar weight_i = i == 0 || i == sample_count ? Scalar(0.5) : Scalar(1.0);
+        result.Add(density(altitude(d_i)) * weight_i * dx);
+    }
+    return result.Get();
+}
+
+// 指数分布 exp(exp_scale * h) 在相邻采样点之间按对数线性插值积分，即把密度看作 e^(-k d)，
+// 每个小区间的积分为 dx (density_i - density_i+1) / ln(density_i / density_i+1)，对沿射线指数衰减的密度没有误差
+// ln(density) 沿射线的二阶导数 kappa = exp_scale * p^2 / r_d^3（p 为射线到行星中心的距离）不为 0，
+// 切点附近密度是 Gaussian 形状，再乘以 1 - kappa dx^2 / 12 修正插值的偏差
+// 两端密度为 0 的小区间（例如低于 width 处）退化为梯形法则
+template<class Scalar, class Density>
+Scalar IntegrateRaySegmentLogLinear(const Density &density, const RayAltitude<Scalar> &altitude, Scalar begin,
+    Scalar end, int sample_count) {
+    const Scalar dx = (end - begin) / Scalar(sample_count);
+    const Scalar curvature_scale = density.exp_scale * altitude.impact_parameter_squared * dx * dx / Scalar(12.0);
+    OpticalLengthSum<Scalar> result;
+    Scalar density_previous = density(altitude(begin));
+    int expm1_count = 0;
+    for (int i = 1; i <= sample_count; ++i) {
+        const Scalar altitude_i = altitude(begin + Scalar(i) * dx);
+        const Scalar density_i = density(altitude_i);
+        if (density_previous > Scalar(0.0) && density_i > Scalar(0.0)) {
+            // (e^x - 1) / x，x 接近 0 时 expm1 没有相消误差
+            const Scalar x = std::log(density_previous / density_i);
+            const Scalar factor = x == Scalar(0.0) ? Scalar(1.0) : std::expm1(x) / x;
+            ++expm1_count;
+            const Scalar r_i = altitude_i + altitude.bottom_radius;
+            result.Add(density_i * factor * (Scalar(1.0) - curvature_scale / (r_i * r_i * r_i)) * dx);
+        } else {
+            result.Add((density_previous + density_i) * Scalar(0.5) * dx);
+        }
+        density_previous = density_i;
+    }
+    TRACE_COUNT(ExpCalls, expm1_count);
+    return result.Get();
+}
+
+// 线性分布 linear_term * h + constant_term 在一个分段内的积分
+// h(d) 的二阶导数为 p^2 / r_d^3，梯形法则的误差为 linear_term * p^2 / r_d^3 * L dx^2 / 12，直接减去
+template<class Scalar, class Density>
+Scalar IntegrateRaySegmentLinear(const Density &density, const RayAltitude<Scalar> &altitude, Scalar begin,
+    Scalar end, int sample_count) {
+    const Scalar dx = (end - begin) / Scalar(sample_count);
+    const Scalar altitude_middle = altitude((begin + end) * Scalar(0.5));
+    const Scalar r_middle = altitude_middle + altitude.bottom_radius;
+    const Scalar correction = density.GetLinearTerm(altitude_middle) * altitude.impact_parameter_squared /
+        (r_middle * r_middle * r_middle) * (end - begin) * dx * dx / Scalar(12.0);
+    return IntegrateRaySegment(density, altitude, begin, end, sample_count) - correction;
+}
+
+// 累积密度表的积分：相邻采样点之间的光学距离取 dx 乘以海拔 [h_i, h_i+1] 上的平均密度 (C_i+1 - C_i) / (h_i+1 - h_i)
+// 海拔在区间内必须单调，即区间不能跨过切点；海拔几乎不变时直接查表
+// 按海拔平均忽略了射线在低处停留得更久，展开后两者之差为 -density' * h'' * dx^3 / 12，
+// 其中 h'' = p^2 / r^3，density' 取自表格
+template<class Scalar, class Density>
+Scalar IntegrateRaySegmentCumulative(const Density &density, const RayAltitude<Scalar> &altitude, Scalar begin,
+    Scalar end, int sample_count) {
+    const double dx = (double(end) - double(begin)) / double(sample_count);
+    const double min_altitude_step = density.cell_size * 1e-3;
+    const double curvature_scale = double(altitude.impact_parameter_squared) * dx * dx * dx / 12.0;
+    OpticalLengthSum<Scalar> result;
+    double altitude_previous = altitude(begin);
+    double cumulative_previous = density.GetCumulative(altitude_previous);
+    for (int i = 1; i <= sample_count; ++i) {
+        const double altitude_i = altitude(static_cast<Scalar>(double(begin) + i * dx));
+        const double cumulative_i = density.GetCumulative(altitude_i);
+        const double altitude_step = altitude_i - altitude_previous;
+        const double altitude_middle = (altitude_i + altitude_previous) * 0.5;
+        const double average_density = std::abs(altitude_step) > min_altitude_step ?
+            (cumulative_i - cumulative_previous) / altitude_step : double(density(static_cast<Scalar>(altitude_middle)));
+        const double derivative = density.GetDerivative(altitude_middle);
+        const double r_middle = altitude_middle + double(altitude.bottom_radius);
+        result.Add(static_cast<Scalar>(average_density * dx - derivative * curvature_scale / (r_middle * r_middle * r_middle)));
+        altitude_previous = altitude_i;
+        cumulative_previous = cumulative_i;
+    }
+    return result.Get();
+}
+
+// 每个区间至少使用的采样次数
+constexpr int kMinSegmentSampleCount = 4;
+
+// 只在密度分布的各分段与射线的交上积分，sample_count 按区间长度分配
+// 区间端点落在分段海拔上，梯形法则不会跨过密度分布的折点
+// Exponential 模式下按 Density::kShape 选择积分公式，Generic 分布仍使用梯形法则
+// 累积密度表总是使用 IntegrateRaySegmentCumulative，并在射线离行星中心最近的点 d = -r mu 处拆开，使每个区间内海拔单调
+template<class Scalar, class Density>
+Scalar ComputeLayerBoundedOpticalLength(const Density &density, Scalar bottom_radius, Scalar r, Scalar mu,
+    Scalar distance, const IntegratorSettings &settings) {
+    const DensityBreakpoints breakpoints = density.GetBreakpoints();
+    // 切点最多落在一个区间内
+    RaySegment segments[2 * (DensityBreakpoints::kMaxCount - 1) + 1];
+    int segment_count = 0;
+    for (int i = 0; i + 1 < breakpoints.count; ++i) {
+        segment_count += IntersectRayWithShell(r, mu, distance,
+            double(bottom_radius) + breakpoints.altitudes[i], double(bottom_radius) + breakpoints.altitudes[i + 1],
+            segments + segment_count);
+    }
+    if constexpr (Density::kShape == DensityShape::Tabulated) {
+        const double tangent = -double(r) * double(mu);
+        for (int i = 0; i < segment_count; ++i) {
+            if (segments[i].begin < tangent && tangent < segments[i].end) {
+                segments[segment_count++] = RaySegment{ tangent, segments[i].end };
+                segments[i].end = tangent;
+                break;
+            }
+        }
+    }
+    double total_length = 0.0;
+    for (int i = 0; i < segment_count; ++i) {
+        total_length += segments[i].end - segments[i].begin;
+    }
+    const RayAltitude<Scalar> altitude(r, mu, bottom_radius);
+    Scalar result = 0.0;
+    for (int i = 0; i < segment_count; ++i) {
+        const double length = segments[i].end - segments[i].begin;
+        const int segment_sample_count = std::max(kMinSegmentSampleCount,
+            static_cast<int>(std::ceil(settings.sample_count * length / total_length)));
+        TRACE_COUNT(Samples, segment_sample_count + 1);
+        TRACE_COUNT(ExpCalls, (segment_sample_count + 1) * Density::kExpCalls);
+        if constexpr (Density::kShape == DensityShape::Tabulated) {
+            result += IntegrateRaySegmentCumulative(density, altitude, Scalar(segments[i].begin),
+                Scalar(segments[i].end), segment_sample_count);
+            continue;
+        }
+        if (settings.mode == IntegrationMode::Exponential) {
+            if constexpr (Density::kShape == DensityShape::Exponential) {
+                result += IntegrateRaySegmentLogLinear(density, altitude, Scalar(segments[i].begin),
+                    Scalar(segments[i].end), segment_sample_count);
+                continue;
+            } else if constexpr (Density::kShape == DensityShape::Linear) {
+                result += IntegrateRaySegmentLinear(density, altitude, Scalar(segments[i].begin),
+                    Scalar(segments[i].end), segment_sample_count);
+                continue;
+            }
+        }
+        result += IntegrateRaySegment(density, altitude, Scalar(segments[i].begin), Scalar(segments[i].end),
+            segment_sample_count);
+    }
+    return result;
+}
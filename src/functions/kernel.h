@@ -0,0 +1,366 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#include "atmosphereParameters/constants.h"
+#include "atmosphereParameters/definitions.h"
+#include "atmosphereParameters/presets.h"
+#include "integrator.h"
+
+// functions.h 中透射率计算的模板版本，按标量类型与密度分布的形状实例化
+// GetLayerDensity 对每一层都要计算 exp、一次项、常数项并 clamp，
+// 这里由密度分布描述在编译期决定需要计算哪些项，已知形状的 kernel 内层循环不含分支与无用的项
+
+// 纯指数分布 exp(exp_scale * h)，即 layers[0] 为空、layers[1] 的 exp_term 为 1 且其他项为 0 的分布（瑞利散射、米氏散射）
+// 低于 layers[0].width 时密度为 0，与 GetProfileDensity 一致，编译为无分支的 select
+template<class Scalar>
+struct ExponentialDensity {
+    Scalar width;
+    Scalar exp_scale;
+    static constexpr DensityShape kShape = DensityShape::Exponential;
+    // 每次求密度调用 exp 的次数，用于 ExpCalls 计数
+    static constexpr int kExpCalls = 1;
+
+    static constexpr bool Matches(const DensityProfile &profile) {
+        const DensityProfileLayer &empty = profile.layers[0];
+        const DensityProfileLayer &layer = profile.layers[1];
+        return empty.exp_term == 0.0 && empty.linear_term == 0.0 && empty.constant_term == 0.0 &&
+            layer.exp_term == 1.0 && layer.linear_term == 0.0 && layer.constant_term == 0.0;
+    }
+
+    static constexpr ExponentialDensity From(const DensityProfile &profile) {
+        return ExponentialDensity{ static_cast<Scalar>(profile.layers[0].width), static_cast<Scalar>(profile.layers[1].exp_scale) };
+    }
+
+    Scalar operator()(Scalar altitude) const {
+        const Scalar density = std::min(std::exp(exp_scale * altitude), Scalar(1.0));
+        return altitude < width ? Scalar(0.0) : density;
+    }
+
+    // 密度低于 Scalar 的 epsilon 后对光学距离已经没有贡献，在此处截断（米氏散射约为 43 km，float 约为 19 km）
+    DensityBreakpoints GetBreakpoints() const {
+        const double cutoff = exp_scale < 0.0 ?
+            std::log(double(std::numeric_limits<Scalar>::epsilon())) / exp_scale : std::numeric_limits<double>::infinity();
+        DensityBreakpoints breakpoints;
+        breakpoints.count = 2;
+        breakpoints.altitudes[0] = width;
+        breakpoints.altitudes[1] = std::max(cutoff, double(width));
+        return breakpoints;
+    }
+};
+
+// 两层分段线性分布，即 exp_term 为 0 的双层分布（臭氧的三角分布）
+// 两层的值都计算出来后再选择，编译为无分支的 select
+template<class Scalar>
+struct LinearDensity {
+    Scalar width;
+    Scalar linear_term[2];
+    Scalar constant_term[2];
+    static constexpr DensityShape kShape = DensityShape::Linear;
+    static constexpr int kExpCalls = 0;
+
+    static constexpr bool Matches(const DensityProfile &profile) {
+        return profile.layers[0].exp_term == 0.0 && profile.layers[1].exp_term == 0.0;
+    }
+
+    static constexpr LinearDensity From(const DensityProfile &profile) {
+        return LinearDensity{ static_cast<Scalar>(profile.layers[0].width),
+            { static_cast<Scalar>(profile.layers[0].linear_term), static_cast<Scalar>(profile.layers[1].linear_term) },
+            { static_cast<Scalar>(profile.layers[0].constant_term), static_cast<Scalar>(profile.layers[1].constant_term) } };
+    }
+
+    Scalar operator()(Scalar altitude) const {
+        const Scalar density_0 = linear_term[0] * altitude + constant_term[0];
+        const Scalar density_1 = linear_term[1] * altitude + constant_term[1];
+        return std::clamp(altitude < width ? density_0 : density_1, Scalar(0.0), Scalar(1.0));
+    }
+
+    // altitude 所在层的一次项系数
+    Scalar GetLinearTerm(Scalar altitude) const {
+        return altitude < width ? linear_term[0] : linear_term[1];
+    }
+
+    // 两层各自大于 0 的海拔范围的并集，并在 width 处分段（臭氧为 10、25、40 km）
+    DensityBreakpoints GetBreakpoints() const {
+        constexpr double kInfinity = std::numeric_limits<double>::infinity();
+        const double layer_begin[2] = { -kInfinity, width };
+        const double layer_end[2] = { width, kInfinity };
+        double begin = kInfinity;
+        double end = -kInfinity;
+        for (int i = 0; i < 2; ++i) {
+            // linear_term * h + constant_term > 0 的范围
+            double positive_begin = -kInfinity;
+            double positive_end = kInfinity;
+            if (linear_term[i] > 0.0) {
+                positive_begin = -double(constant_term[i]) / linear_term[i];
+            } else if (linear_term[i] < 0.0) {
+                positive_end = -double(constant_term[i]) / linear_term[i];
+            } else if (constant_term[i] <= 0.0) {
+                continue;
+            }
+            positive_begin = std::max(positive_begin, layer_begin[i]);
+            positive_end = std::min(positive_end, layer_end[i]);
+            if (positive_begin < positive_end) {
+                begin = std::min(begin, positive_begin);
+                end = std::max(end, positive_end);
+            }
+        }
+        DensityBreakpoints breakpoints;
+        if (begin >= end) {
+            return breakpoints;
+        }
+        breakpoints.altitudes[breakpoints.count++] = begin;
+        if (begin < width && width < end) {
+            breakpoints.altitudes[breakpoints.count++] = width;
+        }
+        breakpoints.altitudes[breakpoints.count++] = end;
+        return breakpoints;
+    }
+};
+
+// 任意的双层分布，与 GetProfileDensity 相同，作为运行时参数的通用实现
+template<class Scalar>
+struct LayeredDensity {
+    struct Layer {
+        Scalar width;
+        Scalar exp_term;
+        Scalar exp_scale;
+        Scalar linear_term;
+        Scalar constant_term;
+    };
+    Layer layers[2];
+    static constexpr DensityShape kShape = DensityShape::Generic;
+    static constexpr int kExpCalls = 1;
+
+    static constexpr bool Matches(const DensityProfile &) {
+        return true;
+    }
+
+    static constexpr Layer FromLayer(const DensityProfileLayer &layer) {
+        return Layer{ static_cast<Scalar>(layer.width), static_cast<Scalar>(layer.exp_term),
+            static_cast<Scalar>(layer.exp_scale), static_cast<Scalar>(layer.linear_term),
+            static_cast<Scalar>(layer.constant_term) };
+    }
+
+    static constexpr LayeredDensity From(const DensityProfile &profile) {
+        return LayeredDensity{ { FromLayer(profile.layers[0]), FromLayer(profile.layers[1]) } };
+    }
+
+    Scalar operator()(Scalar altitude) const {
+        const Layer &layer = altitude < layers[0].width ? layers[0] : layers[1];
+        const Scalar density = layer.exp_term * std::exp(layer.exp_scale * altitude) +
+            layer.linear_term * altitude + layer.constant_term;
+        return std::clamp(density, Scalar(0.0), Scalar(1.0));
+    }
+
+    // 不分析各项的符号，只在两层的分界处分段
+    DensityBreakpoints GetBreakpoints() const {
+        DensityBreakpoints breakpoints;
+        breakpoints.count = 3;
+        breakpoints.altitudes[0] = -std::numeric_limits<double>::infinity();
+        breakpoints.altitudes[1] = layers[0].width;
+        breakpoints.altitudes[2] = std::numeric_limits<double>::infinity();
+        return breakpoints;
+    }
+};
+
+template<class Scalar>
+constexpr Vec3<Scalar> CastSpectrum(const DimensionlessSpectrum &spectrum) {
+    return Vec3<Scalar>(static_cast<Scalar>(spectrum.x), static_cast<Scalar>(spectrum.y), static_cast<Scalar>(spectrum.z));
+}
+
+// 透射率 kernel，RayleighDensity、MieDensity、AbsorptionDensity 为上面的密度分布描述
+template<class Scalar, class RayleighDensity, class MieDensity, class AbsorptionDensity>
+struct TransmittanceKernel {
+    using ScalarType = Scalar;
+    // 含有累积密度表时总是按区间积分，见 IntegrateRaySegmentCumulative
+    static constexpr bool kTabulated = RayleighDensity::kShape == DensityShape::Tabulated ||
+        MieDensity::kShape == DensityShape::Tabulated || AbsorptionDensity::kShape == DensityShape::Tabulated;
+
+    Scalar bottom_radius;
+    Scalar top_radius;
+    // rayleigh_scattering == rayleigh_extinction
+    Vec3<Scalar> rayleigh_extinction;
+    RayleighDensity rayleigh_density;
+    Vec3<Scalar> mie_extinction;
+    MieDensity mie_density;
+    Vec3<Scalar> absorption_extinction;
+    AbsorptionDensity absorption_density;
+
+    static constexpr bool Matches(const AtmosphereParameters &atmosphere) {
+        return RayleighDensity::Matches(atmosphere.rayleigh_density) && MieDensity::Matches(atmosphere.mie_density) &&
+            AbsorptionDensity::Matches(atmosphere.absorption_density);
+    }
+
+    static constexpr TransmittanceKernel From(const AtmosphereParameters &atmosphere) {
+        return TransmittanceKernel{
+            static_cast<Scalar>(atmosphere.bottom_radius),
+            static_cast<Scalar>(atmosphere.top_radius),
+            CastSpectrum<Scalar>(atmosphere.rayleigh_scattering),
+            RayleighDensity::From(atmosphere.rayleigh_density),
+            CastSpectrum<Scalar>(atmosphere.mie_extinction),
+            MieDensity::From(atmosphere.mie_density),
+            CastSpectrum<Scalar>(atmosphere.absorption_extinction),
+            AbsorptionDensity::From(atmosphere.absorption_density) };
+    }
+
+    Scalar DistanceToTopAtmosphereBoundary(Scalar r, Scalar mu) const {
+        const Scalar discriminant = r * r * (mu * mu - Scalar(1.0)) + top_radius * top_radius;
+        return std::max(-r * mu + std::sqrt(std::max(discriminant, Scalar(0.0))), Scalar(0.0));
+    }
+
+    // 三种粒子到大气顶部的光学距离，与 ComputeOpticalLengthToTopAtmosphereBoundary 相同，
+    // Uniform 模式下三种粒子共用采样点，在同一个循环中各自累加
+    OpticalLengths<Scalar> ComputeOpticalLengthsToTopAtmosphereBoundary(Scalar r, Scalar mu, const IntegratorSettings &settings) const {
+        assert(r >= bottom_radius && r <= top_radius);
+        assert(mu >= -1.0 && mu <= 1.0);
+        const Scalar distance = DistanceToTopAtmosphereBoundary(r, mu);
+        if (settings.mode != IntegrationMode::Uniform || kTabulated) {
+            return OpticalLengths<Scalar>{
+                ComputeLayerBoundedOpticalLength(rayleigh_density, bottom_radius, r, mu, distance, settings),
+                ComputeLayerBoundedOpticalLength(mie_density, bottom_radius, r, mu, distance, settings),
+                ComputeLayerBoundedOpticalLength(absorption_density, bottom_radius, r, mu, distance, settings) };
+        }
+        const int SAMPLE_COUNT = settings.sample_count;
+        const Scalar dx = distance / Scalar(SAMPLE_COUNT);
+        const RayAltitude<Scalar> altitude(r, mu, bottom_radius);
+        OpticalLengthSum<Scalar> rayleigh_length;
+        OpticalLengthSum<Scalar> mie_length;
+        OpticalLengthSum<Scalar> absorption_length;
+        for (int i = 0; i <= SAMPLE_COUNT; ++i) {
+            const Scalar d_i = Scalar(i) * dx;
+            const Scalar altitude_i = altitude(d_i);
+            const Scalar weight_i = i == 0 || i == SAMPLE_COUNT ? Scalar(0.5) : Scalar(1.0);
+            rayleigh_length.Add(rayleigh_density(altitude_i) * weight_i * dx);
+            mie_length.Add(mie_density(altitude_i) * weight_i * dx);
+            absorption_length.Add(absorption_density(altitude_i) * weight_i * dx);
+        }
+        TRACE_COUNT(Samples, SAMPLE_COUNT + 1);
+        TRACE_COUNT(ExpCalls, (SAMPLE_COUNT + 1) * (RayleighDensity::kExpCalls + MieDensity::kExpCalls +
+            AbsorptionDensity::kExpCalls));
+        return OpticalLengths<Scalar>{ rayleigh_length.Get(), mie_length.Get(), absorption_length.Get() };
+    }
+
+    Vec3<Scalar> ComputeTransmittanceFromOpticalLengths(const OpticalLengths<Scalar> &lengths) const {
+        TRACE_COUNT(ExpCalls, 3);
+        return exp(-(rayleigh_extinction * lengths.rayleigh + mie_extinction * lengths.mie +
+            absorption_extinction * lengths.absorption));
+    }
+
+    Vec3<Scalar> ComputeTransmittanceToTopAtmosphereBoundary(Scalar r, Scalar mu, const IntegratorSettings &settings) const {
+        return ComputeTransmittanceFromOpticalLengths(ComputeOpticalLengthsToTopAtmosphereBoundary(r, mu, settings));
+    }
+
+    Vec3<Scalar> ComputeTransmittanceToTopAtmosphereBoundary(Scalar r, Scalar mu) const {
+        return ComputeTransmittanceToTopAtmosphereBoundary(r, mu, IntegratorSettings());
+    }
+
+    static double GetUnitRangeFromTextureCoord(double u, int texture_size) {
+        return (u - 0.5 / double(texture_size)) / (1.0 - 1.0 / double(texture_size));
+    }
+
+    // 每个纹素只计算一次，总是使用 double，float kernel 只在积分中使用 float
+    // 否则贴近地平线时 r 与 mu 的舍入误差会使透射率的相对误差达到 1e-3 量级
+    void GetRMuFromTransmittanceTextureUv(const Vec2<Scalar> &uv, Scalar &r, Scalar &mu) const {
+        const double bottom = bottom_radius;
+        const double top = top_radius;
+        const double x_mu = GetUnitRangeFromTextureCoord(uv.x, TRANSMITTANCE_TEXTURE_WIDTH);
+        const double x_r = GetUnitRangeFromTextureCoord(uv.y, TRANSMITTANCE_TEXTURE_HEIGHT);
+        const double H = std::sqrt((top - bottom) * (top + bottom));
+        const double rho = H * x_r;
+        const double r_double = std::sqrt(rho * rho + bottom * bottom);
+        const double d_min = top - r_double;
+        const double d_max = rho + H;
+        const double d = d_min + x_mu * (d_max - d_min);
+        const double mu_double = d == 0.0 ? 1.0 : (H * H - rho * rho - d * d) / (2.0 * r_double * d);
+        r = static_cast<Scalar>(r_double);
+        mu = static_cast<Scalar>(std::clamp(mu_double, -1.0, 1.0));
+    }
+
+    Vec3<Scalar> ComputeTransmittanceToTopAtmosphereBoundaryTexture(const Vec2<Scalar> &frag_coord) const {
+        const Vec2<Scalar> TRANSMITTANCE_TEXTURE_SIZE = Vec2<Scalar>(TRANSMITTANCE_TEXTURE_WIDTH, TRANSMITTANCE_TEXTURE_HEIGHT);
+        Scalar r;
+        Scalar mu;
+        GetRMuFromTransmittanceTextureUv(frag_coord / TRANSMITTANCE_TEXTURE_SIZE, r, mu);
+        return ComputeTransmittanceToTopAtmosphereBoundary(r, mu);
+    }
+};
+
+// 瑞利散射与米氏散射为指数分布、臭氧为分段线性分布的大气，InitModel 中的地球大气属于这一类
+template<class Scalar>
+using EarthLikeTransmittanceKernel = TransmittanceKernel<Scalar, ExponentialDensity<Scalar>, ExponentialDensity<Scalar>, LinearDensity<Scalar>>;
+
+// 任意参数都可以使用的通用 kernel
+template<class Scalar>
+using GenericTransmittanceKernel = TransmittanceKernel<Scalar, LayeredDensity<Scalar>, LayeredDensity<Scalar>, LayeredDensity<Scalar>>;
+
+// 参数为编译期常量的 kernel，所有参数都来自 static constexpr 的 kKernel，内联后被常量折叠
+template<class Kernel, const AtmosphereParameters &kAtmosphere>
+struct PresetTransmittanceKernel {
+    static_assert(Kernel::Matches(kAtmosphere), "preset does not match the density profile shapes of the kernel");
+    using ScalarType = typename Kernel::ScalarType;
+    static constexpr Kernel kKernel = Kernel::From(kAtmosphere);
+
+    OpticalLengths<ScalarType> ComputeOpticalLengthsToTopAtmosphereBoundary(ScalarType r, ScalarType mu, const IntegratorSettings &settings) const {
+        return kKernel.ComputeOpticalLengthsToTopAtmosphereBoundary(r, mu, settings);
+    }
+
+    Vec3<ScalarType> ComputeTransmittanceFromOpticalLengths(const OpticalLengths<ScalarType> &lengths) const {
+        return kKernel.ComputeTransmittanceFromOpticalLengths(lengths);
+    }
+
+    Vec3<ScalarType> ComputeTransmittanceToTopAtmosphereBoundary(ScalarType r, ScalarType mu, const IntegratorSettings &settings) const {
+        return kKernel.ComputeTransmittanceToTopAtmosphereBoundary(r, mu, settings);
+    }
+
+    Vec3<ScalarType> ComputeTransmittanceToTopAtmosphereBoundary(ScalarType r, ScalarType mu) const {
+        return kKernel.ComputeTransmittanceToTopAtmosphereBoundary(r, mu);
+    }
+
+    void GetRMuFromTransmittanceTextureUv(const Vec2<ScalarType> &uv, ScalarType &r, ScalarType &mu) const {
+        kKernel.GetRMuFromTransmittanceTextureUv(uv, r, mu);
+    }
+
+    Vec3<ScalarType> ComputeTransmittanceToTopAtmosphereBoundaryTexture(const Vec2<ScalarType> &frag_coord) const {
+        return kKernel.ComputeTransmittanceToTopAtmosphereBoundaryTexture(frag_coord);
+    }
+};
+
+// 透射率只与半径、消光系数和密度分布有关，比较这些参数即可判断两组大气是否可以共用 kernel
+inline bool HasSameTransmittance(const AtmosphereParameters &a, const AtmosphereParameters &b) {
+    auto same_spectrum = [](const DimensionlessSpectrum &u, const DimensionlessSpectrum &v) {
+        return u.x == v.x && u.y == v.y && u.z == v.z;
+    };
+    auto same_profile = [](const DensityProfile &p, const DensityProfile &q) {
+        for (int i = 0; i < 2; ++i) {
+            const DensityProfileLayer &u = p.layers[i];
+            const DensityProfileLayer &v = q.layers[i];
+            if (u.width != v.width || u.exp_term != v.exp_term || u.exp_scale != v.exp_scale ||
+                u.linear_term != v.linear_term || u.constant_term != v.constant_term) {
+                return false;
+            }
+        }
+        return true;
+    };
+    return a.bottom_radius == b.bottom_radius && a.top_radius == b.top_radius &&
+        same_spectrum(a.rayleigh_scattering, b.rayleigh_scattering) && same_spectrum(a.mie_extinction, b.mie_extinction) &&
+        same_spectrum(a.absorption_extinction, b.absorption_extinction) &&
+        same_profile(a.rayleigh_density, b.rayleigh_density) && same_profile(a.mie_density, b.mie_density) &&
+        same_profile(a.absorption_density, b.absorption_density);
+}
+
+// 选择适用于 atmosphere 的最快 kernel 并调用 function(kernel)：
+// 与预设相同时使用编译期常量的 kernel，密度分布形状已知时使用对应的特化 kernel，否则使用通用 kernel
+template<class Scalar, class Function>
+void DispatchTransmittanceKernel(const AtmosphereParameters &atmosphere, Function function) {
+    if (HasSameTransmittance(atmosphere, kEarthAtmosphere)) {
+        function(PresetTransmittanceKernel<EarthLikeTransmittanceKernel<Scalar>, kEarthAtmosphere>());
+    } else if (EarthLikeTransmittanceKernel<Scalar>::Matches(atmosphere)) {
+        function(EarthLikeTransmittanceKernel<Scalar>::From(atmosphere));
+    } else {
+        function(GenericTransmittanceKernel<Scalar>::From(atmosphere));
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "bake.h"
+
+// 按需计算的透射率 LUT：纹素按 16x16 的 tile 在第一次访问时计算，之后直接读取
+// 只用到 (r, mu) 空间一小部分的使用者（测试、离线工具、地形烘焙，地面附近的相机主要只用到最下面几行）
+// 只为实际用到的 tile 付出积分的开销
+// 与 TextureImage 有相同的 width、height 与 GetTexel(x, y)，可以直接传给 SampleTransmittanceBilinear；
+// 可以在多个线程上同时访问，每个 tile 只计算一次，计算的纹素与 BakeTransmittance 逐位相同
+class LazyTransmittanceImage {
+public:
+    static constexpr int kTileSize = 16;
+
+    const int width;
+    const int height;
+
+    LazyTransmittanceImage(const AtmosphereParameters &atmosphere, const ExtendedDensityProfiles &profiles,
+        int width, int height, const IntegratorSettings &settings = IntegratorSettings()) :
+        width(width), height(height), tiles_x_((width + kTileSize - 1) / kTileSize),
+        tiles_y_((height + kTileSize - 1) / kTileSize),
+        parameterization_(CreateTransmittanceParameterization(atmosphere, width, height)),
+        image_(width, height), tile_flags_(new std::once_flag[static_cast<size_t>(tiles_x_) * tiles_y_]) {
+        DispatchBakeKernel<double>(atmosphere, profiles, settings, [&](const auto &kernel) {
+            compute_texel_ = [kernel, settings](double r, double mu) {
+                return kernel.ComputeTransmittanceToTopAtmosphereBoundary(r, mu, settings);
+            };
+        });
+    }
+
+    LazyTransmittanceImage(const AtmosphereParameters &atmosphere, int width, int height,
+        const IntegratorSettings &settings = IntegratorSettings()) :
+        LazyTransmittanceImage(atmosphere, GetExtendedDensityProfiles(atmosphere), width, height, settings) {}
+
+    // 纹素所在的 tile 尚未计算时先计算整个 tile
+    const float *GetTexel(int x, int y) const {
+        EnsureTile(x / kTileSize, y / kTileSize);
+        return image_.GetTexel(x, y);
+    }
+
+    // 计算所有尚未计算的 tile，返回完整的 LUT
+    const TextureImage &Resolve(int thread_count = 1) const {
+        RunTaskRange(tiles_x_ * tiles_y_, thread_count, [&](int tile) {
+            EnsureTile(tile % tiles_x_, tile / tiles_x_);
+        });
+        return image_;
+    }
+
+    const TransmittanceParameterization &GetParameterization() const {
+        return parameterization_;
+    }
+
+    int GetTileCount() const {
+        return tiles_x_ * tiles_y_;
+    }
+
+    int GetComputedTileCount() const {
+        return computed_tiles_.load(std::memory_order_relaxed);
+    }
+
+private:
+    // call_once 保证同一 tile 的其他访问者等待计算完成，并看到写入的纹素
+    void EnsureTile(int tile_x, int tile_y) const {
+        std::call_once(tile_flags_[static_cast<size_t>(tile_y) * tiles_x_ + tile_x], [&]() {
+            TRACE_SCOPE("lazy_tile");
+            const int x_end = std::min(width, (tile_x + 1) * kTileSize);
+            const int y_end = std::min(height, (tile_y + 1) * kTileSize);
+            for (int y = tile_y * kTileSize; y < y_end; ++y) {
+                for (int x = tile_x * kTileSize; x < x_end; ++x) {
+                    double r;
+                    double mu;
+                    parameterization_.GetRMu(x, y, r, mu);
+                    const Vec3d trans = compute_texel_(r, mu);
+                    float *texel = image_.GetTexel(x, y);
+                    texel[0] = static_cast<float>(trans.x);
+                    texel[1] = static_cast<float>(trans.y);
+                    texel[2] = static_cast<float>(trans.z);
+                }
+            }
+            TRACE_COUNT(Texels, (x_end - tile_x * kTileSize) * (y_end - tile_y * kTileSize));
+            computed_tiles_.fetch_add(1, std::memory_order_relaxed);
+        });
+    }
+
+    int tiles_x_;
+    int tiles_y_;
+    TransmittanceParameterization parameterization_;
+    // kernel 的类型由 DispatchBakeKernel 决定，保存为按 (r, mu) 计算透射率的函数
+    std::function<Vec3d(double, double)> compute_texel_;
+    // 只在对应 tile 的 call_once 中写入
+    mutable TextureImage image_;
+    std::unique_ptr<std::once_flag[]> tile_flags_;
+    mutable std::atomic<int> computed_tiles_{ 0 };
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#include "bake.h"
+
+// 在透射率 LUT 中查找 (r, mu) 的方式
+enum class TransmittanceLookup {
+    // 与烘焙一致：纹素 x 是在 x_mu = (x - 0.5) / (width - 1) 处计算的（见 CreateTransmittanceParameterization）
+    BakedGrid,
+    // 与着色器中的 GetTextureCoordFromUnitRange 一致：x_mu = 0 与 1 落在第一个与最后一个纹素的中心，
+    // 相对于烘焙的位置偏移半个纹素
+    ShaderUv,
+};
+
+inline const char *GetTransmittanceLookupName(TransmittanceLookup lookup) {
+    return lookup == TransmittanceLookup::BakedGrid ? "grid" : "shader";
+}
+
+inline bool ParseTransmittanceLookup(const char *name, TransmittanceLookup &lookup) {
+    if (std::strcmp(name, "grid") == 0) {
+        lookup = TransmittanceLookup::BakedGrid;
+        return true;
+    }
+    if (std::strcmp(name, "shader") == 0) {
+        lookup = TransmittanceLookup::ShaderUv;
+        return true;
+    }
+    return false;
+}
+
+// 双线性采样 TransmittanceParameterization 布局的 image（第 0 层），超出边界时取边缘纹素，与 GPU 的 clamp 采样相同
+// Image 为 TextureImage 或其他有 width、height 与 GetTexel(x, y) 的类型，如 LazyTransmittanceImage
+// (r, mu) 由 parameterization 换算为单位坐标，与烘焙使用同一个参数化，parameterization 的尺寸不需要与 image 相同
+template<class Image>
+std::array<double, 3> SampleTransmittanceBilinear(const Image &image, const TransmittanceParameterization &parameterization,
+    double r, double mu, TransmittanceLookup lookup) {
+    double x_mu;
+    double x_r;
+    parameterization.GetUnitCoordsFromRMu(r, mu, x_mu, x_r);
+    const double offset = lookup == TransmittanceLookup::BakedGrid ? 0.5 : 0.0;
+    const double x = std::clamp(x_mu * (image.width - 1) + offset, 0.0, double(image.width - 1));
+    const double y = std::clamp(x_r * (image.height - 1) + offset, 0.0, double(image.height - 1));
+    const int x0 = std::min(static_cast<int>(x), image.width - 2);
+    const int y0 = std::min(static_cast<int>(y), image.height - 2);
+    const double s = x - x0;
+    const double t = y - y0;
+    std::array<double, 3> result;
+    for (int c = 0; c < 3; ++c) {
+        const double row0 = image.GetTexel(x0, y0)[c] * (1.0 - s) + image.GetTexel(x0 + 1, y0)[c] * s;
+        const double row1 = image.GetTexel(x0, y0 + 1)[c] * (1.0 - s) + image.GetTexel(x0 + 1, y0 + 1)[c] * s;
+        result[c] = row0 * (1.0 - t) + row1 * t;
+    }
+    return result;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "bake.h"
+
+// 由粗到细烘焙的一遍
+struct ProgressiveBakePass {
+    int index;
+    // 这一遍计算的网格：列与行为 stride 的倍数，以及最后一列与最后一行
+    int stride;
+    IntegratorSettings settings;
+    // 这一遍实际计算的纹素数，之前以完整精度计算过的网格点不再计算
+    int computed_texels;
+    double milliseconds;
+    bool final;
+};
+
+// 每一遍完成后调用，image 为完整分辨率的预览：网格点为计算结果，其余纹素由网格点双线性插值
+using ProgressiveBakeCallback = std::function<void(const ProgressiveBakePass &pass, const TextureImage &image)>;
+
+// 预览遍的采样次数为 settings.sample_count / coarsest_stride，但不少于该值
+constexpr int kProgressivePreviewMinSampleCount = 16;
+
+// 间距为 stride 的网格是否包含坐标 i，size 为该方向的分辨率
+inline bool IsOnProgressiveGrid(int i, int size, int stride) {
+    return i % stride == 0 || i == size - 1;
+}
+
+// 用 stride 网格上的纹素双线性插值填充其余纹素；网格包含最后一列与最后一行，因此每个纹素两侧都有网格点
+inline void FillProgressivePreview(TextureImage &image, int stride, int thread_count) {
+    if (stride == 1) {
+        return;
+    }
+    auto bracket = [stride](int i, int size, int &i0, int &i1, float &t) {
+        i0 = i / stride * stride;
+        i1 = std::min(i0 + stride, size - 1);
+        t = i1 > i0 ? static_cast<float>(i - i0) / static_cast<float>(i1 - i0) : 0.0f;
+    };
+    // 先填充网格行上的纹素，再由网格行填充其余行
+    RunTaskRange(image.height, thread_count, [&](int y) {
+        if (!IsOnProgressiveGrid(y, image.height, stride)) {
+            return;
+        }
+        for (int x = 0; x < image.width; ++x) {
+            if (IsOnProgressiveGrid(x, image.width, stride)) {
+                continue;
+            }
+            int x0, x1;
+            float t;
+            bracket(x, image.width, x0, x1, t);
+            const float *left = image.GetTexel(x0, y);
+            const float *right = image.GetTexel(x1, y);
+            float *texel = image.GetTexel(x, y);
+            for (int c = 0; c < 3; ++c) {
+                texel[c] = left[c] + (right[c] - left[c]) * t;
+            }
+        }
+    });
+    RunTaskRange(image.height, thread_count, [&](int y) {
+        if (IsOnProgressiveGrid(y, image.height, stride)) {
+            return;
+        }
+        int y0, y1;
+        float t;
+        bracket(y, image.height, y0, y1, t);
+        for (int x = 0; x < image.width; ++x) {
+            const float *bottom = image.GetTexel(x, y0);
+            const float *top = image.GetTexel(x, y1);
+            float *texel = image.GetTexel(x, y);
+            for (int c = 0; c < 3; ++c) {
+                texel[c] = bottom[c] + (top[c] - bottom[c]) * t;
+            }
+        }
+    });
+}
+
+// 由粗到细烘焙 width x height 的透射率贴图，调整 AtmosphereParameters 时可以立即看到预览：
+// 第一遍在 coarsest_stride 的网格上以较少的采样次数计算，之后每遍将网格的间距减半并以 settings 的完整精度计算，
+// 以完整精度计算过的网格点在更细的网格中直接复用，因此除第一遍的预览外总计算量与 BakeTransmittance 相同
+// 每遍完成后调用 callback；最后一遍的结果与 BakeTransmittance 逐位相同
+// coarsest_stride 需要是 2 的幂，为 1 时只有一遍
+template<class Scalar>
+TextureImage BakeTransmittanceProgressive(const AtmosphereParameters &atmosphere, const ExtendedDensityProfiles &profiles,
+    int width, int height, const IntegratorSettings &settings, int thread_count, const ProgressiveBakeCallback &callback,
+    int coarsest_stride = 8) {
+    TRACE_SCOPE("BakeTransmittanceProgressive");
+    const TransmittanceParameterization parameterization = CreateTransmittanceParameterization(atmosphere, width, height);
+    IntegratorSettings preview_settings = settings;
+    preview_settings.sample_count = std::min(settings.sample_count,
+        std::max(kProgressivePreviewMinSampleCount, settings.sample_count / coarsest_stride));
+    TextureImage transmittance(width, height);
+    // 以完整精度计算过的纹素
+    std::vector<uint8_t> done(static_cast<size_t>(width) * height, 0);
+    DispatchBakeKernel<Scalar>(atmosphere, profiles, settings, [&](const auto &kernel) {
+        int index = 0;
+        for (int stride = coarsest_stride; stride >= 1; stride /= 2, ++index) {
+            TRACE_SCOPE("progressive_pass");
+            const auto begin = std::chrono::steady_clock::now();
+            const bool preview = index == 0 && stride > 1;
+            const IntegratorSettings &pass_settings = preview ? preview_settings : settings;
+            std::vector<int> row_texels(height, 0);
+            RunTaskRange(height, thread_count, [&](int y) {
+                if (!IsOnProgressiveGrid(y, height, stride)) {
+                    return;
+                }
+                for (int x = 0; x < width; ++x) {
+                    const size_t i = static_cast<size_t>(y) * width + x;
+                    if (!IsOnProgressiveGrid(x, width, stride) || done[i]) {
+                        continue;
+                    }
+                    double r;
+                    double mu;
+                    parameterization.GetRMu(x, y, r, mu);
+                    const Vec3<Scalar> trans = kernel.ComputeTransmittanceToTopAtmosphereBoundary(
+                        static_cast<Scalar>(r), static_cast<Scalar>(mu), pass_settings);
+                    float *texel = transmittance.GetTexel(x, y);
+                    texel[0] = static_cast<float>(trans.x);
+                    texel[1] = static_cast<float>(trans.y);
+                    texel[2] = static_cast<float>(trans.z);
+                    done[i] = preview ? 0 : 1;
+                    ++row_texels[y];
+                }
+                TRACE_COUNT(Texels, row_texels[y]);
+            });
+            ProgressiveBakePass pass;
+            pass.index = index;
+            pass.stride = stride;
+            pass.settings = pass_settings;
+            pass.computed_texels = 0;
+            for (int texels : row_texels) {
+                pass.computed_texels += texels;
+            }
+            pass.final = stride == 1;
+            if (!pass.final) {
+                // 网格点之外的纹素在下一遍中会被覆盖，可以直接写入插值
+                FillProgressivePreview(transmittance, stride, thread_count);
+            }
+            pass.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+            if (callback) {
+                callback(pass, transmittance);
+            }
+        }
+    });
+    return transmittance;
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "bake.h"
+#include "parallel/taskGraph.h"
+
+// 扫描的参数，均为消光系数的缩放：透射率为 exp(-sum(extinction * scale * optical_length))，
+// 光学距离只与几何和密度分布有关，所有切片共用
+enum class SweepParameter {
+    RayleighScale,
+    // 气溶胶浓度，即浑浊度
+    MieScale,
+    // 臭氧总量
+    AbsorptionScale,
+};
+
+inline const char *GetSweepParameterName(SweepParameter parameter) {
+    switch (parameter) {
+    case SweepParameter::RayleighScale: return "rayleigh";
+    case SweepParameter::MieScale: return "mie";
+    case SweepParameter::AbsorptionScale: return "absorption";
+    }
+    return "unknown";
+}
+
+inline bool ParseSweepParameter(const char *name, SweepParameter &parameter) {
+    for (SweepParameter candidate : { SweepParameter::RayleighScale, SweepParameter::MieScale,
+        SweepParameter::AbsorptionScale }) {
+        if (std::strcmp(name, GetSweepParameterName(candidate)) == 0) {
+            parameter = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// 参数在 [begin, end] 上等间距取 count 个值
+struct SweepAxis {
+    SweepParameter parameter = SweepParameter::MieScale;
+    double begin = 1.0;
+    double end = 1.0;
+    int count = 1;
+
+    double GetValue(int i) const {
+        return count > 1 ? begin + (end - begin) * double(i) / double(count - 1) : begin;
+    }
+};
+
+// 解析 "<参数>:<begin>:<end>:<count>"，例如 "mie:0.5:4:8"
+inline bool ParseSweepAxis(const char *text, SweepAxis &axis) {
+    const std::string value = text;
+    const size_t first = value.find(':');
+    if (first == std::string::npos || !ParseSweepParameter(value.substr(0, first).c_str(), axis.parameter)) {
+        return false;
+    }
+    char *end = nullptr;
+    axis.begin = std::strtod(value.c_str() + first + 1, &end);
+    if (*end != ':') {
+        return false;
+    }
+    axis.end = std::strtod(end + 1, &end);
+    if (*end != ':') {
+        return false;
+    }
+    axis.count = static_cast<int>(std::strtol(end + 1, &end, 10));
+    return *end == '\0' && axis.count >= 1 && axis.begin >= 0.0 && axis.end >= 0.0;
+}
+
+inline int GetSweepSliceCount(const std::vector<SweepAxis> &axes) {
+    int count = 1;
+    for (const SweepAxis &axis : axes) {
+        count *= axis.count;
+    }
+    return count;
+}
+
+// 切片 slice 上三种粒子消光系数的缩放，第一个轴变化最快，同一参数出现在多个轴上时相乘
+inline void GetSweepScales(const std::vector<SweepAxis> &axes, int slice, double scales[3]) {
+    scales[0] = scales[1] = scales[2] = 1.0;
+    for (const SweepAxis &axis : axes) {
+        scales[static_cast<int>(axis.parameter)] *= axis.GetValue(slice % axis.count);
+        slice /= axis.count;
+    }
+}
+
+// 每个任务处理的行数
+constexpr int kSweepTileRows = 4;
+
+// 在 axes 张成的参数网格上烘焙透射率，只有一个轴时输出 3D 纹理，运行时可以直接在 z 方向上插值，否则输出纹理数组
+// 每个纹素的光学距离只积分一次，每个切片只需一次乘加与 exp；所有缩放均为 1 的切片与 BakeTransmittance 的结果相同
+// 按 kSweepTileRows 行分块，每个切片的块依赖同一行范围的光学距离块，在 TaskGraph 上执行，
+// 某个块的光学距离完成后即可开始它的各个切片，结果与线程数无关
+template<class Scalar>
+TextureImage BakeTransmittanceSweep(const AtmosphereParameters &atmosphere, const ExtendedDensityProfiles &profiles,
+    int width, int height, const std::vector<SweepAxis> &axes, const IntegratorSettings &settings = IntegratorSettings(),
+    int thread_count = 1) {
+    TRACE_SCOPE("BakeTransmittanceSweep");
+    const int slice_count = GetSweepSliceCount(axes);
+    TextureImage transmittance(width, height, slice_count,
+        axes.size() == 1 ? TextureDimension::Texture3D : TextureDimension::Texture2DArray);
+    const TransmittanceParameterization parameterization = CreateTransmittanceParameterization(atmosphere, width, height);
+    DispatchBakeKernel<Scalar>(atmosphere, profiles, settings, [&](const auto &kernel) {
+        std::vector<OpticalLengths<Scalar>> lengths(static_cast<size_t>(width) * height);
+        TaskGraph graph;
+        for (int begin = 0; begin < height; begin += kSweepTileRows) {
+            const int end = std::min(height, begin + kSweepTileRows);
+            const TaskGraph::TaskId lengths_task = graph.AddTask([&, begin, end]() {
+                TRACE_SCOPE("sweep_lengths");
+                for (int y = begin; y < end; ++y) {
+                    for (int x = 0; x < width; ++x) {
+                        double r;
+                        double mu;
+                        parameterization.GetRMu(x, y, r, mu);
+                        lengths[static_cast<size_t>(y) * width + x] = kernel.ComputeOpticalLengthsToTopAtmosphereBoundary(
+                            static_cast<Scalar>(r), static_cast<Scalar>(mu), settings);
+                    }
+                }
+            });
+            for (int z = 0; z < slice_count; ++z) {
+                graph.AddTask([&, begin, end, z]() {
+                    TRACE_SCOPE("sweep_slice");
+                    TRACE_COUNT(Texels, static_cast<size_t>(width) * (end - begin));
+                    double scales[3];
+                    GetSweepScales(axes, z, scales);
+                    for (int y = begin; y < end; ++y) {
+                        for (int x = 0; x < width; ++x) {
+                            const OpticalLengths<Scalar> &length = lengths[static_cast<size_t>(y) * width + x];
+                            const Vec3<Scalar> trans = kernel.ComputeTransmittanceFromOpticalLengths(OpticalLengths<Scalar>{
+                                length.rayleigh * static_cast<Scalar>(scales[0]),
+                                length.mie * static_cast<Scalar>(scales[1]),
+                                length.absorption * static_cast<Scalar>(scales[2]) });
+                            float *texel = transmittance.GetTexel(x, y, z);
+                            texel[0] = static_cast<float>(trans.x);
+                            texel[1] = static_cast<float>(trans.y);
+                            texel[2] = static_cast<float>(trans.z);
+                        }
+                    }
+                }, { lengths_task });
+            }
+        }
+        graph.Run(thread_count);
+    });
+    return transmittance;
+}
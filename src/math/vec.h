@@ -1,14 +1,15 @@
 #pragma once
 
-#include <algorithm>   
+#include <algorithm>
+#include <cmath>
 
 template<typename Type>
 struct Vec2 {
     Vec2() = default;
 
-    explicit Vec2(Type x) : x(x), y(x) {}
+    constexpr explicit Vec2(Type x) : x(x), y(x) {}
 
-    Vec2(Type x, Type y) : x(x), y(y) {}
+    constexpr Vec2(Type x, Type y) : x(x), y(y) {}
 
     Vec2 &operator+=(const Vec2 &b) {
         x += b.x;
@@ -24,7 +25,7 @@ struct Vec2 {
 
     Vec2 &operator-=(const Vec2 &b) {
         x -= b.x;
-        y -= b.x;
+        y -= b.y;
         return *this;
     }
 
@@ -61,9 +62,9 @@ template<typename Type>
 struct Vec3 {
     Vec3() = default;
 
-    explicit Vec3(Type x) : x(x), y(x), z(x) {}
+    constexpr explicit Vec3(Type x) : x(x), y(x), z(x) {}
 
-    Vec3(Type x, Type y, Type z) : x(x), y(y), z(z) {}
+    constexpr Vec3(Type x, Type y, Type z) : x(x), y(y), z(z) {}
 
     Vec3 operator+(const Vec3 &b) const {
         return Vec3(x + b.x, y + b.y, z + b.z);
@@ -103,9 +104,41 @@ template<typename Type>
 struct Vec4 {
     Vec4() = default;
 
-    explicit Vec4(Type x) : x(x), y(x), z(x), w(x) {}
+    constexpr explicit Vec4(Type x) : x(x), y(x), z(x), w(x) {}
 
-    Vec4(Type x, Type y, Type z, Type w) : x(x), y(y), z(z), w(w) {}
+    constexpr Vec4(Type x, Type y, Type z, Type w) : x(x), y(y), z(z), w(w) {}
+
+    Vec4 operator+(const Vec4 &b) const {
+        return Vec4(x + b.x, y + b.y, z + b.z, w + b.w);
+    }
+
+    Vec4 operator-(const Vec4 &b) const {
+        return Vec4(x - b.x, y - b.y, z - b.z, w - b.w);
+    }
+
+    Vec4 operator-() const {
+        return Vec4(-x, -y, -z, -w);
+    }
+
+    Vec4 operator*(double b) const {
+        return Vec4(x * b, y * b, z * b, w * b);
+    }
+
+    Vec4 operator/(double b) const {
+        return Vec4(x / b, y / b, z / b, w / b);
+    }
+
+    Vec4 operator*(const Vec4 &b) const {
+        return Vec4(x * b.x, y * b.y, z * b.z, w * b.w);
+    }
+
+    Vec4 &operator+=(const Vec4 &b) {
+        x += b.x;
+        y += b.y;
+        z += b.z;
+        w += b.w;
+        return *this;
+    }
 
     Type x, y, z, w;
 };
@@ -115,14 +148,24 @@ Type dot(Vec3<Type> a, Vec3<Type> b) {
     return a.x * b.x + a.y * b.y + a.z * b.z;
 }
 
+template<typename Type>
+Type dot(Vec4<Type> a, Vec4<Type> b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+
 template<typename Type>
 Type length(Vec2<Type> a) {
-    return std::sqrtf(a.x * a.x + a.y * a.y);
+    return std::sqrt(a.x * a.x + a.y * a.y);
 }
 
 template<typename Type>
 Type length(Vec3<Type> a) {
-    return std::sqrtf(a.x * a.x + a.y * a.y + a.z * a.z);
+    return std::sqrt(a.x * a.x + a.y * a.y + a.z * a.z);
+}
+
+template<typename Type>
+Type length(Vec4<Type> a) {
+    return std::sqrt(dot(a, a));
 }
 
 template<typename Type>
@@ -135,6 +178,11 @@ Vec3<Type> normalize(Vec3<Type> a) {
     return a / (std::sqrt(a.x * a.x + a.y * a.y + a.z * a.z));
 }
 
+template<typename Type>
+Vec4<Type> normalize(Vec4<Type> a) {
+    return a / length(a);
+}
+
 template<typename Type>
 Vec3<Type> SphericalToVector(Type mu, Type phi) {
     return Vec3<Type>(std::sin(mu) * std::cos(phi),
@@ -161,6 +209,21 @@ Vec3<Type> exp(const Vec3<Type> &vec) {
     return Vec3<Type>{ std::exp(vec.x), std::exp(vec.y) , std::exp(vec.z) };
 }
 
+template<typename Type>
+Vec4<Type> max(const Vec4<Type> &a, const Vec4<Type> &b) {
+    return Vec4<Type>(std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z), std::max(a.w, b.w));
+}
+
+template<typename Type>
+Vec4<Type> min(const Vec4<Type> &a, const Vec4<Type> &b) {
+    return Vec4<Type>(std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z), std::min(a.w, b.w));
+}
+
+template<typename Type>
+Vec4<Type> exp(const Vec4<Type> &vec) {
+    return Vec4<Type>(std::exp(vec.x), std::exp(vec.y), std::exp(vec.z), std::exp(vec.w));
+}
+
 using Vec2f = Vec2<float>;
 using Vec3f = Vec3<float>;
 using Vec4f = Vec4<float>;
@@ -169,3 +232,5 @@ using Vec2d = Vec2<double>;
 using Vec3d = Vec3<double>;
 using Vec4d = Vec4<double>;
 
+// SSE / AVX 特化的 Vec2d、Vec3f、Vec4f、Vec3d、Vec4d
+#include "vecSimd.h"
@@ -0,0 +1,457 @@
+#pragma once
+
+// 由 vec.h 在通用模板之后包含
+// 支持 SSE2 时 Vec2d、Vec3f、Vec4f 使用 128 位寄存器，支持 AVX 时 Vec3d、Vec4d 使用 256 位寄存器，
+// 接口与通用模板相同，调用处不需要修改；Vec3 填充一个分量，与其他分量一起参与按分量的运算
+// Vec2f 只有半个 128 位寄存器，保持通用模板
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATH_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX__)
+#define MATH_AVX 1
+#include <immintrin.h>
+#endif
+
+#if MATH_SSE2
+
+// Cephes expf：exp(x) = 2^n * exp(r)，r = x - n * ln2，exp(r) 使用 6 次多项式，相对误差约 1e-7
+// 小于 -87.3 时返回 0
+inline __m128 SimdExp(__m128 x) {
+    const __m128 min_x = _mm_set1_ps(-87.3365479f);
+    const __m128 underflow = _mm_cmplt_ps(x, min_x);
+    // 保证 n 不超过 127
+    x = _mm_min_ps(_mm_max_ps(x, min_x), _mm_set1_ps(88.0f));
+    // 默认舍入模式下 cvtps 为就近取整
+    const __m128i n_int = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)));
+    const __m128 n = _mm_cvtepi32_ps(n_int);
+    // ln2 拆成两部分，第一部分的尾数只有 9 位，n * 0.693359375 没有舍入误差
+    x = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(0.693359375f)));
+    x = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(-2.12194440e-4f)));
+    __m128 y = _mm_set1_ps(1.9875691500e-4f);
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507e-3f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073e-3f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894e-2f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201e-1f));
+    y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(y, _mm_mul_ps(x, x)), x), _mm_set1_ps(1.0f));
+    // 2^n 直接写入指数位
+    const __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(n_int, _mm_set1_epi32(127)), 23));
+    return _mm_andnot_ps(underflow, _mm_mul_ps(y, scale));
+}
+
+// 前三个分量的水平和，与通用模板的求和顺序相同
+inline float SimdSum3(__m128 v) {
+    const __m128 y = _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1));
+    const __m128 z = _mm_movehl_ps(v, v);
+    return _mm_cvtss_f32(_mm_add_ss(_mm_add_ss(v, y), z));
+}
+
+inline float SimdSum4(__m128 v) {
+    const __m128 w = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+    return SimdSum3(v) + _mm_cvtss_f32(w);
+}
+
+template<>
+struct alignas(16) Vec2<double> {
+    Vec2() = default;
+
+    constexpr explicit Vec2(double x) : x(x), y(x) {}
+
+    constexpr Vec2(double x, double y) : x(x), y(y) {}
+
+    explicit Vec2(__m128d v) {
+        _mm_store_pd(&x, v);
+    }
+
+    __m128d Load() const {
+        return _mm_load_pd(&x);
+    }
+
+    Vec2 &operator+=(const Vec2 &b) {
+        _mm_store_pd(&x, _mm_add_pd(Load(), b.Load()));
+        return *this;
+    }
+
+    Vec2 operator+(const Vec2 &b) const {
+        return Vec2(_mm_add_pd(Load(), b.Load()));
+    }
+
+    Vec2 &operator-=(const Vec2 &b) {
+        _mm_store_pd(&x, _mm_sub_pd(Load(), b.Load()));
+        return *this;
+    }
+
+    Vec2 operator-(const Vec2 &b) const {
+        return Vec2(_mm_sub_pd(Load(), b.Load()));
+    }
+
+    Vec2 operator-() const {
+        return Vec2(_mm_xor_pd(Load(), _mm_set1_pd(-0.0)));
+    }
+
+    Vec2 operator*(double b) const {
+        return Vec2(_mm_mul_pd(Load(), _mm_set1_pd(b)));
+    }
+
+    Vec2 operator/(double b) const {
+        return Vec2(_mm_div_pd(Load(), _mm_set1_pd(b)));
+    }
+
+    Vec2 operator/(Vec2 b) const {
+        return Vec2(_mm_div_pd(Load(), b.Load()));
+    }
+
+    Vec2 operator*(const Vec2 &b) const {
+        return Vec2(_mm_mul_pd(Load(), b.Load()));
+    }
+
+    double x, y;
+};
+
+template<>
+struct alignas(16) Vec3<float> {
+    Vec3() = default;
+
+    constexpr explicit Vec3(float x) : x(x), y(x), z(x), padding(0.0f) {}
+
+    constexpr Vec3(float x, float y, float z) : x(x), y(y), z(z), padding(0.0f) {}
+
+    explicit Vec3(__m128 v) {
+        _mm_store_ps(&x, v);
+    }
+
+    __m128 Load() const {
+        return _mm_load_ps(&x);
+    }
+
+    Vec3 operator+(const Vec3 &b) const {
+        return Vec3(_mm_add_ps(Load(), b.Load()));
+    }
+
+    Vec3 operator-(const Vec3 &b) const {
+        return Vec3(_mm_sub_ps(Load(), b.Load()));
+    }
+
+    Vec3 operator-() const {
+        return Vec3(_mm_xor_ps(Load(), _mm_set1_ps(-0.0f)));
+    }
+
+    Vec3 operator*(double b) const {
+        return Vec3(_mm_mul_ps(Load(), _mm_set1_ps(static_cast<float>(b))));
+    }
+
+    Vec3 operator/(double b) const {
+        return Vec3(_mm_div_ps(Load(), _mm_set1_ps(static_cast<float>(b))));
+    }
+
+    Vec3 operator*(const Vec3 &b) const {
+        return Vec3(_mm_mul_ps(Load(), b.Load()));
+    }
+
+    Vec3 &operator+=(const Vec3 &b) {
+        _mm_store_ps(&x, _mm_add_ps(Load(), b.Load()));
+        return *this;
+    }
+
+    float x, y, z;
+    // 填充到 16 字节，不参与 dot 等水平运算；与其他分量一样，默认构造时不初始化
+    float padding;
+};
+
+template<>
+struct alignas(16) Vec4<float> {
+    Vec4() = default;
+
+    constexpr explicit Vec4(float x) : x(x), y(x), z(x), w(x) {}
+
+    constexpr Vec4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+
+    explicit Vec4(__m128 v) {
+        _mm_store_ps(&x, v);
+    }
+
+    __m128 Load() const {
+        return _mm_load_ps(&x);
+    }
+
+    Vec4 operator+(const Vec4 &b) const {
+        return Vec4(_mm_add_ps(Load(), b.Load()));
+    }
+
+    Vec4 operator-(const Vec4 &b) const {
+        return Vec4(_mm_sub_ps(Load(), b.Load()));
+    }
+
+    Vec4 operator-() const {
+        return Vec4(_mm_xor_ps(Load(), _mm_set1_ps(-0.0f)));
+    }
+
+    Vec4 operator*(double b) const {
+        return Vec4(_mm_mul_ps(Load(), _mm_set1_ps(static_cast<float>(b))));
+    }
+
+    Vec4 operator/(double b) const {
+        return Vec4(_mm_div_ps(Load(), _mm_set1_ps(static_cast<float>(b))));
+    }
+
+    Vec4 operator*(const Vec4 &b) const {
+        return Vec4(_mm_mul_ps(Load(), b.Load()));
+    }
+
+    Vec4 &operator+=(const Vec4 &b) {
+        _mm_store_ps(&x, _mm_add_ps(Load(), b.Load()));
+        return *this;
+    }
+
+    float x, y, z, w;
+};
+
+inline double length(Vec2d a) {
+    const __m128d squared = _mm_mul_pd(a.Load(), a.Load());
+    return std::sqrt(_mm_cvtsd_f64(_mm_add_sd(squared, _mm_unpackhi_pd(squared, squared))));
+}
+
+inline float dot(Vec3f a, Vec3f b) {
+    return SimdSum3(_mm_mul_ps(a.Load(), b.Load()));
+}
+
+inline float dot(Vec4f a, Vec4f b) {
+    return SimdSum4(_mm_mul_ps(a.Load(), b.Load()));
+}
+
+inline float length(Vec3f a) {
+    return std::sqrt(dot(a, a));
+}
+
+inline float length(Vec4f a) {
+    return std::sqrt(dot(a, a));
+}
+
+inline Vec3f normalize(Vec3f a) {
+    return Vec3f(_mm_div_ps(a.Load(), _mm_set1_ps(length(a))));
+}
+
+inline Vec4f normalize(Vec4f a) {
+    return Vec4f(_mm_div_ps(a.Load(), _mm_set1_ps(length(a))));
+}
+
+inline Vec3f max(const Vec3f &a, const Vec3f &b) {
+    return Vec3f(_mm_max_ps(a.Load(), b.Load()));
+}
+
+inline Vec4f max(const Vec4f &a, const Vec4f &b) {
+    return Vec4f(_mm_max_ps(a.Load(), b.Load()));
+}
+
+inline Vec3f min(const Vec3f &a, const Vec3f &b) {
+    return Vec3f(_mm_min_ps(a.Load(), b.Load()));
+}
+
+inline Vec4f min(const Vec4f &a, const Vec4f &b) {
+    return Vec4f(_mm_min_ps(a.Load(), b.Load()));
+}
+
+inline Vec3f exp(const Vec3f &vec) {
+    return Vec3f(SimdExp(vec.Load()));
+}
+
+inline Vec4f exp(const Vec4f &vec) {
+    return Vec4f(SimdExp(vec.Load()));
+}
+
+#endif // MATH_SSE2
+
+#if MATH_AVX
+
+// Cephes exp：exp(x) = 2^n * exp(r)，exp(r) = 1 + 2 r P(r^2) / (Q(r^2) - r P(r^2))，误差在 1 ulp 左右
+// 小于 -708.4 时返回 0
+inline __m256d SimdExp(__m256d x) {
+    const __m256d min_x = _mm256_set1_pd(-708.39641853226408);
+    const __m256d underflow = _mm256_cmp_pd(x, min_x, _CMP_LT_OQ);
+    // 保证 n 不超过 1023
+    x = _mm256_min_pd(_mm256_max_pd(x, min_x), _mm256_set1_pd(709.43613930310391));
+    const __m256d n = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(1.4426950408889634)),
+        _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    x = _mm256_sub_pd(x, _mm256_mul_pd(n, _mm256_set1_pd(6.93145751953125e-1)));
+    x = _mm256_sub_pd(x, _mm256_mul_pd(n, _mm256_set1_pd(1.42860682030941723212e-6)));
+    const __m256d xx = _mm256_mul_pd(x, x);
+    __m256d p = _mm256_set1_pd(1.26177193074810590878e-4);
+    p = _mm256_add_pd(_mm256_mul_pd(p, xx), _mm256_set1_pd(3.02994407707441961300e-2));
+    p = _mm256_add_pd(_mm256_mul_pd(p, xx), _mm256_set1_pd(9.99999999999999999910e-1));
+    p = _mm256_mul_pd(p, x);
+    __m256d q = _mm256_set1_pd(3.00198505138664455042e-6);
+    q = _mm256_add_pd(_mm256_mul_pd(q, xx), _mm256_set1_pd(2.52448340349684104192e-3));
+    q = _mm256_add_pd(_mm256_mul_pd(q, xx), _mm256_set1_pd(2.27265548208155028766e-1));
+    q = _mm256_add_pd(_mm256_mul_pd(q, xx), _mm256_set1_pd(2.00000000000000000009e0));
+    __m256d y = _mm256_div_pd(p, _mm256_sub_pd(q, p));
+    y = _mm256_add_pd(_mm256_add_pd(y, y), _mm256_set1_pd(1.0));
+    // 2^n，AVX 没有 256 位的整数移位，分成两个 128 位完成
+    const __m128i n_int = _mm_add_epi32(_mm256_cvtpd_epi32(n), _mm_set1_epi32(1023));
+    const __m128i scale_low = _mm_slli_epi64(_mm_cvtepi32_epi64(n_int), 52);
+    const __m128i scale_high = _mm_slli_epi64(_mm_cvtepi32_epi64(_mm_srli_si128(n_int, 8)), 52);
+    const __m256d scale = _mm256_castsi256_pd(_mm256_insertf128_si256(_mm256_castsi128_si256(scale_low), scale_high, 1));
+    return _mm256_andnot_pd(underflow, _mm256_mul_pd(y, scale));
+}
+
+// 按 ((x + y) + z) + w 的顺序求和，与通用模板的结果相同
+inline double SimdSum3(__m256d v) {
+    const __m128d xy = _mm256_castpd256_pd128(v);
+    const __m128d zw = _mm256_extractf128_pd(v, 1);
+    return _mm_cvtsd_f64(_mm_add_sd(_mm_add_sd(xy, _mm_unpackhi_pd(xy, xy)), zw));
+}
+
+inline double SimdSum4(__m256d v) {
+    const __m128d zw = _mm256_extractf128_pd(v, 1);
+    return SimdSum3(v) + _mm_cvtsd_f64(_mm_unpackhi_pd(zw, zw));
+}
+
+template<>
+struct alignas(32) Vec3<double> {
+    Vec3() = default;
+
+    constexpr explicit Vec3(double x) : x(x), y(x), z(x), padding(0.0) {}
+
+    constexpr Vec3(double x, double y, double z) : x(x), y(y), z(z), padding(0.0) {}
+
+    explicit Vec3(__m256d v) {
+        _mm256_store_pd(&x, v);
+    }
+
+    __m256d Load() const {
+        return _mm256_load_pd(&x);
+    }
+
+    Vec3 operator+(const Vec3 &b) const {
+        return Vec3(_mm256_add_pd(Load(), b.Load()));
+    }
+
+    Vec3 operator-(const Vec3 &b) const {
+        return Vec3(_mm256_sub_pd(Load(), b.Load()));
+    }
+
+    Vec3 operator-() const {
+        return Vec3(_mm256_xor_pd(Load(), _mm256_set1_pd(-0.0)));
+    }
+
+    Vec3 operator*(double b) const {
+        return Vec3(_mm256_mul_pd(Load(), _mm256_set1_pd(b)));
+    }
+
+    Vec3 operator/(double b) const {
+        return Vec3(_mm256_div_pd(Load(), _mm256_set1_pd(b)));
+    }
+
+    Vec3 operator*(const Vec3 &b) const {
+        return Vec3(_mm256_mul_pd(Load(), b.Load()));
+    }
+
+    Vec3 &operator+=(const Vec3 &b) {
+        _mm256_store_pd(&x, _mm256_add_pd(Load(), b.Load()));
+        return *this;
+    }
+
+    double x, y, z;
+    // 填充到 32 字节，不参与 dot 等水平运算；与其他分量一样，默认构造时不初始化
+    double padding;
+};
+
+template<>
+struct alignas(32) Vec4<double> {
+    Vec4() = default;
+
+    constexpr explicit Vec4(double x) : x(x), y(x), z(x), w(x) {}
+
+    constexpr Vec4(double x, double y, double z, double w) : x(x), y(y), z(z), w(w) {}
+
+    explicit Vec4(__m256d v) {
+        _mm256_store_pd(&x, v);
+    }
+
+    __m256d Load() const {
+        return _mm256_load_pd(&x);
+    }
+
+    Vec4 operator+(const Vec4 &b) const {
+        return Vec4(_mm256_add_pd(Load(), b.Load()));
+    }
+
+    Vec4 operator-(const Vec4 &b) const {
+        return Vec4(_mm256_sub_pd(Load(), b.Load()));
+    }
+
+    Vec4 operator-() const {
+        return Vec4(_mm256_xor_pd(Load(), _mm256_set1_pd(-0.0)));
+    }
+
+    Vec4 operator*(double b) const {
+        return Vec4(_mm256_mul_pd(Load(), _mm256_set1_pd(b)));
+    }
+
+    Vec4 operator/(double b) const {
+        return Vec4(_mm256_div_pd(Load(), _mm256_set1_pd(b)));
+    }
+
+    Vec4 operator*(const Vec4 &b) const {
+        return Vec4(_mm256_mul_pd(Load(), b.Load()));
+    }
+
+    Vec4 &operator+=(const Vec4 &b) {
+        _mm256_store_pd(&x, _mm256_add_pd(Load(), b.Load()));
+        return *this;
+    }
+
+    double x, y, z, w;
+};
+
+inline double dot(Vec3d a, Vec3d b) {
+    return SimdSum3(_mm256_mul_pd(a.Load(), b.Load()));
+}
+
+inline double dot(Vec4d a, Vec4d b) {
+    return SimdSum4(_mm256_mul_pd(a.Load(), b.Load()));
+}
+
+inline double length(Vec3d a) {
+    return std::sqrt(dot(a, a));
+}
+
+inline double length(Vec4d a) {
+    return std::sqrt(dot(a, a));
+}
+
+inline Vec3d normalize(Vec3d a) {
+    return Vec3d(_mm256_div_pd(a.Load(), _mm256_set1_pd(length(a))));
+}
+
+inline Vec4d normalize(Vec4d a) {
+    return Vec4d(_mm256_div_pd(a.Load(), _mm256_set1_pd(length(a))));
+}
+
+inline Vec3d max(const Vec3d &a, const Vec3d &b) {
+    return Vec3d(_mm256_max_pd(a.Load(), b.Load()));
+}
+
+inline Vec4d max(const Vec4d &a, const Vec4d &b) {
+    return Vec4d(_mm256_max_pd(a.Load(), b.Load()));
+}
+
+inline Vec3d min(const Vec3d &a, const Vec3d &b) {
+    return Vec3d(_mm256_min_pd(a.Load(), b.Load()));
+}
+
+inline Vec4d min(const Vec4d &a, const Vec4d &b) {
+    return Vec4d(_mm256_min_pd(a.Load(), b.Load()));
+}
+
+inline Vec3d exp(const Vec3d &vec) {
+    return Vec3d(SimdExp(vec.Load()));
+}
+
+inline Vec4d exp(const Vec4d &vec) {
+    return Vec4d(SimdExp(vec.Load()));
+}
+
+#endif // MATH_AVX
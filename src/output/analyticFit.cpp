@@ -0,0 +1,483 @@
+#include "analyticFit.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "errorHistogram.h"
+#include "parallel/taskGraph.h"
+
+namespace {
+
+// 透射率为 0 的纹素取 exp(-69)，保证光学深度有限
+constexpr float kMinTransmittance = 1e-30f;
+
+// 第 0 列与第 0 行的单位坐标小于 0，在参数化的定义域之外（顶部几行的第 0 列得到的是地下的射线），
+// 不参与拟合与误差统计
+constexpr int kFirstSample = 1;
+
+// 与 CreateTransmittanceParameterization 中的 unit_range 相同
+double GetUnitRange(int i, int texture_size) {
+    const double u = double(i) / double(texture_size);
+    return (u - 0.5 / double(texture_size)) / (1.0 - 1.0 / double(texture_size));
+}
+
+void GetChebyshev(double x, int degree, double *values) {
+    values[0] = 1.0;
+    if (degree > 0) {
+        values[1] = x;
+    }
+    for (int k = 2; k <= degree; ++k) {
+        values[k] = 2.0 * x * values[k - 1] - values[k - 2];
+    }
+}
+
+// 在 points 上以 degree 次 Chebyshev 多项式做最小二乘拟合的算子 (A^T A)^-1 A^T，(degree + 1) x points.size()
+// 网格上张量积的最小二乘解可以分解为两个方向上的一维算子
+std::vector<double> GetLeastSquaresOperator(const std::vector<double> &points, int degree) {
+    const int n = degree + 1;
+    const int m = static_cast<int>(points.size());
+    std::vector<double> a(static_cast<size_t>(m) * n);
+    for (int i = 0; i < m; ++i) {
+        GetChebyshev(points[i], degree, a.data() + static_cast<size_t>(i) * n);
+    }
+    // 增广矩阵 [A^T A | A^T]，带部分主元的 Gauss-Jordan 消元
+    const int columns = n + m;
+    std::vector<double> system(static_cast<size_t>(n) * columns, 0.0);
+    for (int row = 0; row < n; ++row) {
+        double *line = system.data() + static_cast<size_t>(row) * columns;
+        for (int i = 0; i < m; ++i) {
+            const double a_i = a[static_cast<size_t>(i) * n + row];
+            for (int col = 0; col < n; ++col) {
+                line[col] += a_i * a[static_cast<size_t>(i) * n + col];
+            }
+            line[n + i] = a_i;
+        }
+    }
+    for (int col = 0; col < n; ++col) {
+        int pivot = col;
+        for (int row = col + 1; row < n; ++row) {
+            if (std::abs(system[static_cast<size_t>(row) * columns + col]) > std::abs(system[static_cast<size_t>(pivot) * columns + col])) {
+                pivot = row;
+            }
+        }
+        if (pivot != col) {
+            std::swap_ranges(system.begin() + static_cast<size_t>(col) * columns, system.begin() + static_cast<size_t>(col + 1) * columns,
+                system.begin() + static_cast<size_t>(pivot) * columns);
+        }
+        double *pivot_line = system.data() + static_cast<size_t>(col) * columns;
+        const double scale = 1.0 / pivot_line[col];
+        for (int k = 0; k < columns; ++k) {
+            pivot_line[k] *= scale;
+        }
+        for (int row = 0; row < n; ++row) {
+            double *line = system.data() + static_cast<size_t>(row) * columns;
+            const double factor = line[col];
+            if (row == col || factor == 0.0) {
+                continue;
+            }
+            for (int k = 0; k < columns; ++k) {
+                line[k] -= factor * pivot_line[k];
+            }
+        }
+    }
+    std::vector<double> result(static_cast<size_t>(n) * m);
+    for (int row = 0; row < n; ++row) {
+        std::copy_n(system.begin() + static_cast<size_t>(row) * columns + n, m, result.begin() + static_cast<size_t>(row) * m);
+    }
+    return result;
+}
+
+// 一个方向上的一段子区间
+struct AxisSpan {
+    // 参与拟合的样本下标，包括两侧各一个相邻样本，使子区间的边界处接近连续
+    std::vector<int> samples;
+    // samples 在子区间内的坐标，子区间映射到 [-1, 1]
+    std::vector<double> t;
+    // 求值时落在该子区间内的样本，用于统计误差
+    int owned_begin = 0;
+    int owned_end = 0;
+};
+
+// 把 [begin, end] 等分为 count 段，样本 i 的单位坐标为 GetUnitRange(i, texture_size)，选择子区间的方式与 EvaluateAnalyticFit 相同
+std::vector<AxisSpan> SplitAxis(int texture_size, double begin, double end, int count) {
+    auto band = [&](int i) {
+        return (GetUnitRange(i, texture_size) - begin) / (end - begin) * count;
+    };
+    std::vector<AxisSpan> spans(count);
+    for (int k = 0; k < count; ++k) {
+        AxisSpan &span = spans[k];
+        span.owned_begin = texture_size;
+        for (int i = kFirstSample; i < texture_size; ++i) {
+            if (std::clamp(static_cast<int>(std::floor(band(i))), 0, count - 1) == k) {
+                span.owned_begin = std::min(span.owned_begin, i);
+                span.owned_end = i + 1;
+            }
+        }
+        for (int i = std::max(span.owned_begin - 1, kFirstSample); i < std::min(span.owned_end + 1, texture_size); ++i) {
+            span.samples.push_back(i);
+            span.t.push_back(2.0 * (band(i) - k) - 1.0);
+        }
+    }
+    return spans;
+}
+
+class Fitter {
+public:
+    explicit Fitter(const TextureImage &image) : image_(image) {
+        depths_.resize(image.texels.size());
+        for (size_t i = 0; i < image.texels.size(); ++i) {
+            depths_[i] = -std::log(std::max(image.texels[i], kMinTransmittance));
+        }
+    }
+
+    // 子区间内 channel 通道的 Chebyshev 系数，网格上张量积的最小二乘解等于先在 mu 方向上投影每一行，再在 r 方向上投影
+    std::vector<double> Fit(const AxisSpan &mu, const AxisSpan &r, int channel, int degree_mu, int degree_r) const {
+        const std::vector<double> p_mu = GetLeastSquaresOperator(mu.t, degree_mu);
+        const std::vector<double> p_r = GetLeastSquaresOperator(r.t, degree_r);
+        const int columns = static_cast<int>(mu.samples.size());
+        const int rows = static_cast<int>(r.samples.size());
+        std::vector<double> projected(static_cast<size_t>(rows) * (degree_mu + 1), 0.0);
+        for (int i = 0; i < rows; ++i) {
+            for (int k = 0; k <= degree_mu; ++k) {
+                double sum = 0.0;
+                for (int x = 0; x < columns; ++x) {
+                    sum += p_mu[static_cast<size_t>(k) * columns + x] * GetDepth(mu.samples[x], r.samples[i], channel);
+                }
+                projected[static_cast<size_t>(i) * (degree_mu + 1) + k] = sum;
+            }
+        }
+        std::vector<double> coefficients(static_cast<size_t>(degree_r + 1) * (degree_mu + 1), 0.0);
+        for (int j = 0; j <= degree_r; ++j) {
+            for (int i = 0; i < rows; ++i) {
+                const double weight = p_r[static_cast<size_t>(j) * rows + i];
+                for (int k = 0; k <= degree_mu; ++k) {
+                    coefficients[static_cast<size_t>(j) * (degree_mu + 1) + k] += weight * projected[static_cast<size_t>(i) * (degree_mu + 1) + k];
+                }
+            }
+        }
+        return coefficients;
+    }
+
+    // 拟合结果在子区间内相对于 LUT 的最大相对误差
+    double MeasureError(const AxisSpan &mu, const AxisSpan &r, int channel, int degree_mu, int degree_r,
+        const std::vector<double> &coefficients) const {
+        std::vector<double> basis_mu(static_cast<size_t>(mu.samples.size()) * (degree_mu + 1));
+        for (size_t x = 0; x < mu.samples.size(); ++x) {
+            GetChebyshev(mu.t[x], degree_mu, basis_mu.data() + x * (degree_mu + 1));
+        }
+        std::vector<double> basis_r(degree_r + 1);
+        std::vector<double> row_coefficients(degree_mu + 1);
+        double max_error = 0.0;
+        for (size_t i = 0; i < r.samples.size(); ++i) {
+            const int y = r.samples[i];
+            if (y < r.owned_begin || y >= r.owned_end) {
+                continue;
+            }
+            GetChebyshev(r.t[i], degree_r, basis_r.data());
+            std::fill(row_coefficients.begin(), row_coefficients.end(), 0.0);
+            for (int j = 0; j <= degree_r; ++j) {
+                for (int k = 0; k <= degree_mu; ++k) {
+                    row_coefficients[k] += basis_r[j] * coefficients[static_cast<size_t>(j) * (degree_mu + 1) + k];
+                }
+            }
+            for (size_t k = 0; k < mu.samples.size(); ++k) {
+                const int x = mu.samples[k];
+                const float transmittance = image_.GetTexel(x, y)[channel];
+                if (x < mu.owned_begin || x >= mu.owned_end || transmittance == 0.0f) {
+                    continue;
+                }
+                double depth = 0.0;
+                for (int d = 0; d <= degree_mu; ++d) {
+                    depth += row_coefficients[d] * basis_mu[k * (degree_mu + 1) + d];
+                }
+                const double error = std::abs(std::exp(-std::max(depth, 0.0)) - transmittance) / transmittance;
+                max_error = std::max(max_error, error);
+            }
+        }
+        return max_error;
+    }
+
+private:
+    float GetDepth(int x, int y, int channel) const {
+        return depths_[(static_cast<size_t>(y) * image_.width + x) * 3 + channel];
+    }
+
+    const TextureImage &image_;
+    std::vector<float> depths_;
+};
+
+std::string Literal(double value) {
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+    std::string result = buffer;
+    if (result.find_first_of(".eEn") == std::string::npos) {
+        result += ".0";
+    }
+    return result;
+}
+
+std::string IntArray(const char *name, const std::vector<int> &values, ShaderLanguage language) {
+    std::string list;
+    for (size_t i = 0; i < values.size(); ++i) {
+        list += (i == 0 ? "" : ", ") + std::to_string(values[i]);
+    }
+    const std::string count = std::to_string(values.size());
+    switch (language) {
+    case ShaderLanguage::GLSL: return "const int " + std::string(name) + "[" + count + "] = int[](" + list + ");\n";
+    case ShaderLanguage::HLSL: return "static const int " + std::string(name) + "[" + count + "] = { " + list + " };\n";
+    case ShaderLanguage::Cpp: return "inline constexpr int " + std::string(name) + "[" + count + "] = { " + list + " };\n";
+    }
+    return "";
+}
+
+} // namespace
+
+AnalyticTransmittanceFit FitTransmittance(const AtmosphereParameters &atmosphere, const TextureImage &image,
+    const AnalyticFitSettings &settings) {
+    AnalyticTransmittanceFit fit;
+    fit.bottom_radius = atmosphere.bottom_radius;
+    fit.top_radius = atmosphere.top_radius;
+    fit.mu_begin = GetUnitRange(kFirstSample, image.width);
+    fit.mu_end = GetUnitRange(image.width - 1, image.width);
+    fit.r_begin = GetUnitRange(kFirstSample, image.height);
+    fit.r_end = GetUnitRange(image.height - 1, image.height);
+    const Fitter fitter(image);
+
+    for (int subdomain_count = 1; ; subdomain_count *= 2) {
+        const std::vector<AxisSpan> mu_spans = SplitAxis(image.width, fit.mu_begin, fit.mu_end, subdomain_count);
+        const std::vector<AxisSpan> r_spans = SplitAxis(image.height, fit.r_begin, fit.r_end, subdomain_count);
+        const int cell_count = subdomain_count * subdomain_count;
+        auto max_degree_mu = [&](int cell) {
+            return std::min(settings.max_degree, static_cast<int>(mu_spans[cell % subdomain_count].samples.size()) / 2);
+        };
+        auto max_degree_r = [&](int cell) {
+            return std::min(settings.max_degree, static_cast<int>(r_spans[cell / subdomain_count].samples.size()) / 2);
+        };
+        // 每个 (子区间, 通道) 独立搜索满足误差要求的最低次数，0 表示在次数上限内达不到
+        std::vector<int> degrees(cell_count * 3, 0);
+        RunTaskRange(cell_count * 3, settings.thread_count, [&](int task) {
+            const int cell = task / 3;
+            const int channel = task % 3;
+            const AxisSpan &mu = mu_spans[cell % subdomain_count];
+            const AxisSpan &r = r_spans[cell / subdomain_count];
+            for (int degree = 1; degree <= std::max(max_degree_mu(cell), max_degree_r(cell)); ++degree) {
+                const int degree_mu = std::min(degree, max_degree_mu(cell));
+                const int degree_r = std::min(degree, max_degree_r(cell));
+                const std::vector<double> coefficients = fitter.Fit(mu, r, channel, degree_mu, degree_r);
+                if (fitter.MeasureError(mu, r, channel, degree_mu, degree_r, coefficients) <= settings.max_relative_error) {
+                    degrees[task] = degree;
+                    return;
+                }
+            }
+        });
+        const bool converged = std::find(degrees.begin(), degrees.end(), 0) == degrees.end();
+        if (!converged && subdomain_count * 2 <= settings.max_subdomain_count) {
+            continue;
+        }
+        // 三个通道使用相同的次数，便于在同一个向量中求值
+        fit.subdomain_count = subdomain_count;
+        fit.subdomains.resize(cell_count);
+        RunTaskRange(cell_count, settings.thread_count, [&](int cell) {
+            int degree = 0;
+            for (int channel = 0; channel < 3; ++channel) {
+                degree = std::max(degree, degrees[cell * 3 + channel] > 0 ? degrees[cell * 3 + channel] : settings.max_degree);
+            }
+            AnalyticFitSubdomain &subdomain = fit.subdomains[cell];
+            subdomain.degree_mu = std::min(degree, max_degree_mu(cell));
+            subdomain.degree_r = std::min(degree, max_degree_r(cell));
+            subdomain.coefficients.resize(static_cast<size_t>(subdomain.degree_r + 1) * (subdomain.degree_mu + 1));
+            for (int channel = 0; channel < 3; ++channel) {
+                const std::vector<double> coefficients = fitter.Fit(mu_spans[cell % subdomain_count],
+                    r_spans[cell / subdomain_count], channel, subdomain.degree_mu, subdomain.degree_r);
+                for (size_t k = 0; k < coefficients.size(); ++k) {
+                    subdomain.coefficients[k][channel] = coefficients[k];
+                }
+            }
+        });
+        break;
+    }
+
+    std::vector<float> source;
+    std::vector<float> fitted;
+    for (int y = kFirstSample; y < image.height; ++y) {
+        for (int x = kFirstSample; x < image.width; ++x) {
+            const std::array<double, 3> depth = EvaluateAnalyticFit(fit, GetUnitRange(x, image.width), GetUnitRange(y, image.height));
+            for (int c = 0; c < 3; ++c) {
+                source.push_back(image.GetTexel(x, y)[c]);
+                fitted.push_back(static_cast<float>(std::exp(-std::max(depth[c], 0.0))));
+            }
+        }
+    }
+    const ErrorHistogram histogram = ComputeErrorHistogram(source.data(), fitted.data(), fitted.size());
+    fit.max_relative_error = histogram.max_relative_error;
+    fit.mean_relative_error = histogram.mean_relative_error;
+    return fit;
+}
+
+std::array<double, 3> EvaluateAnalyticFit(const AnalyticTransmittanceFit &fit, double x_mu, double x_r) {
+    const int count = fit.subdomain_count;
+    const double band_mu = (x_mu - fit.mu_begin) / (fit.mu_end - fit.mu_begin) * count;
+    const double band_r = (x_r - fit.r_begin) / (fit.r_end - fit.r_begin) * count;
+    const int index_mu = std::clamp(static_cast<int>(std::floor(band_mu)), 0, count - 1);
+    const int index_r = std::clamp(static_cast<int>(std::floor(band_r)), 0, count - 1);
+    const double s = std::clamp(2.0 * (band_mu - index_mu) - 1.0, -1.0, 1.0);
+    const double t = std::clamp(2.0 * (band_r - index_r) - 1.0, -1.0, 1.0);
+    const AnalyticFitSubdomain &subdomain = fit.subdomains[index_r * count + index_mu];
+    std::vector<double> basis_mu(subdomain.degree_mu + 1);
+    std::vector<double> basis_r(subdomain.degree_r + 1);
+    GetChebyshev(s, subdomain.degree_mu, basis_mu.data());
+    GetChebyshev(t, subdomain.degree_r, basis_r.data());
+    std::array<double, 3> depth = { 0.0, 0.0, 0.0 };
+    for (int j = 0; j <= subdomain.degree_r; ++j) {
+        for (int k = 0; k <= subdomain.degree_mu; ++k) {
+            const std::array<double, 3> &c = subdomain.coefficients[static_cast<size_t>(j) * (subdomain.degree_mu + 1) + k];
+            for (int channel = 0; channel < 3; ++channel) {
+                depth[channel] += c[channel] * basis_r[j] * basis_mu[k];
+            }
+        }
+    }
+    return depth;
+}
+
+std::string GenerateAnalyticFitShader(const AnalyticTransmittanceFit &fit, ShaderLanguage language) {
+    const bool cpp = language == ShaderLanguage::Cpp;
+    const bool glsl = language == ShaderLanguage::GLSL;
+    const std::string constant = cpp ? "inline constexpr " : glsl ? "const " : "static const ";
+    const std::string vec3 = glsl ? "vec3" : "float3";
+    const int subdomain_count = fit.subdomain_count;
+
+    std::vector<int> degree_mu;
+    std::vector<int> degree_r;
+    std::vector<int> offsets;
+    std::vector<std::array<double, 3>> coefficients;
+    for (const AnalyticFitSubdomain &subdomain : fit.subdomains) {
+        degree_mu.push_back(subdomain.degree_mu);
+        degree_r.push_back(subdomain.degree_r);
+        offsets.push_back(static_cast<int>(coefficients.size()));
+        coefficients.insert(coefficients.end(), subdomain.coefficients.begin(), subdomain.coefficients.end());
+    }
+
+    std::string code;
+    code += "// Generated by Transmittance --fit, do not edit.\n";
+    char line[128];
+    std::snprintf(line, sizeof(line), "// Relative error against the LUT: max %.3g, mean %.3g\n",
+        fit.max_relative_error, fit.mean_relative_error);
+    code += line;
+    if (cpp) {
+        code += "#pragma once\n\n#include <algorithm>\n#include <cmath>\n\n#include \"math/vec.h\"\n\n";
+        code += "#if !MATH_SSE2\n#error \"The fitted transmittance needs SSE2\"\n#endif\n\n";
+        code += "namespace fitted {\n";
+    }
+    code += "\n";
+
+    const double horizon = std::sqrt(fit.top_radius * fit.top_radius - fit.bottom_radius * fit.bottom_radius);
+    code += constant + "float kFitTopRadius = " + Literal(fit.top_radius) + ";\n";
+    code += constant + "float kFitBottomRadius = " + Literal(fit.bottom_radius) + ";\n";
+    code += constant + "float kFitHorizonDistance = " + Literal(horizon) + ";\n";
+    // x_mu 与 x_r 映射到 [0, 子区间数]
+    code += constant + "float kFitMuBegin = " + Literal(fit.mu_begin) + ";\n";
+    code += constant + "float kFitMuScale = " + Literal(subdomain_count / (fit.mu_end - fit.mu_begin)) + ";\n";
+    code += constant + "float kFitRBegin = " + Literal(fit.r_begin) + ";\n";
+    code += constant + "float kFitRScale = " + Literal(subdomain_count / (fit.r_end - fit.r_begin)) + ";\n";
+    code += constant + "int kFitSubdomainCount = " + std::to_string(subdomain_count) + ";\n";
+    code += IntArray("kFitDegreeMu", degree_mu, language);
+    code += IntArray("kFitDegreeR", degree_r, language);
+    code += IntArray("kFitOffset", offsets, language);
+
+    // 系数，C++ 中填充到 4 个分量以便直接载入 SSE 寄存器
+    const std::string count = std::to_string(coefficients.size());
+    if (cpp) {
+        code += "alignas(16) inline constexpr float kFitCoefficients[" + count + "][4] = {\n";
+    } else if (glsl) {
+        code += "const vec3 kFitCoefficients[" + count + "] = vec3[](\n";
+    } else {
+        code += "static const float3 kFitCoefficients[" + count + "] = {\n";
+    }
+    for (size_t i = 0; i < coefficients.size(); ++i) {
+        const std::array<double, 3> &c = coefficients[i];
+        const std::string values = Literal(c[0]) + ", " + Literal(c[1]) + ", " + Literal(c[2]);
+        code += "    " + (cpp ? "{ " + values + ", 0.0f }" : vec3 + "(" + values + ")") +
+            (i + 1 < coefficients.size() ? ",\n" : "\n");
+    }
+    code += glsl ? ");\n\n" : "};\n\n";
+
+    // 与 GetTransmittanceTextureUvFromRMu 相同，但不换算到纹素中心
+    // 平方差写成和与差的乘积，float 下 r * r - kBottomRadius^2 在地表附近会丢失大部分有效位
+    const std::string std_prefix = cpp ? "std::" : "";
+    const std::string zero = cpp ? "0.0f" : "0.0";
+    const std::string one = cpp ? "1.0f" : "1.0";
+    const std::string two = cpp ? "2.0f" : "2.0";
+    const std::string coordinates =
+        "    float rho = " + std_prefix + "sqrt(" + std_prefix + "max((r - kFitBottomRadius) * (r + kFitBottomRadius), " + zero + "));\n"
+        "    float d = " + std_prefix + "max(-r * mu + " + std_prefix + "sqrt(" + std_prefix +
+            "max((kFitTopRadius - r) * (kFitTopRadius + r) + r * mu * r * mu, " + zero + ")), " + zero + ");\n"
+        "    float d_min = kFitTopRadius - r;\n"
+        "    float d_max = rho + kFitHorizonDistance;\n"
+        "    float x_mu = (d - d_min) / (d_max - d_min);\n"
+        "    float x_r = rho / kFitHorizonDistance;\n"
+        "    float band_mu = (x_mu - kFitMuBegin) * kFitMuScale;\n"
+        "    float band_r = (x_r - kFitRBegin) * kFitRScale;\n"
+        "    int index_mu = " + std_prefix + "clamp(int(" + std_prefix + "floor(band_mu)), 0, kFitSubdomainCount - 1);\n"
+        "    int index_r = " + std_prefix + "clamp(int(" + std_prefix + "floor(band_r)), 0, kFitSubdomainCount - 1);\n"
+        "    float s = " + std_prefix + "clamp(" + two + " * (band_mu - float(index_mu)) - " + one + ", -" + one + ", " + one + ");\n"
+        "    float t = " + std_prefix + "clamp(" + two + " * (band_r - float(index_r)) - " + one + ", -" + one + ", " + one + ");\n"
+        "    int index = index_r * kFitSubdomainCount + index_mu;\n"
+        "    int width = kFitDegreeMu[index] + 1;\n";
+
+    if (cpp) {
+        code += "// Clenshaw recurrence of coefficient row 'row' at s, three channels in one register\n";
+        code += "inline __m128 EvaluateFitRow(int row, int degree, __m128 s) {\n";
+        code += "    __m128 two_s = _mm_add_ps(s, s);\n";
+        code += "    __m128 b1 = _mm_setzero_ps();\n";
+        code += "    __m128 b2 = _mm_setzero_ps();\n";
+        code += "    for (int k = degree; k >= 1; --k) {\n";
+        code += "        __m128 b0 = _mm_add_ps(_mm_load_ps(kFitCoefficients[row + k]), _mm_sub_ps(_mm_mul_ps(two_s, b1), b2));\n";
+        code += "        b2 = b1;\n";
+        code += "        b1 = b0;\n";
+        code += "    }\n";
+        code += "    return _mm_add_ps(_mm_load_ps(kFitCoefficients[row]), _mm_sub_ps(_mm_mul_ps(s, b1), b2));\n";
+        code += "}\n\n";
+        code += "inline Vec3f GetTransmittanceToTopAtmosphereBoundaryFit(float r, float mu) {\n";
+        code += coordinates;
+        code += "    __m128 s4 = _mm_set1_ps(s);\n";
+        code += "    __m128 two_t = _mm_set1_ps(2.0f * t);\n";
+        code += "    __m128 b1 = _mm_setzero_ps();\n";
+        code += "    __m128 b2 = _mm_setzero_ps();\n";
+        code += "    for (int j = kFitDegreeR[index]; j >= 1; --j) {\n";
+        code += "        __m128 b0 = _mm_add_ps(EvaluateFitRow(kFitOffset[index] + j * width, width - 1, s4), _mm_sub_ps(_mm_mul_ps(two_t, b1), b2));\n";
+        code += "        b2 = b1;\n";
+        code += "        b1 = b0;\n";
+        code += "    }\n";
+        code += "    __m128 depth = _mm_add_ps(EvaluateFitRow(kFitOffset[index], width - 1, s4), _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(t), b1), b2));\n";
+        code += "    return Vec3f(SimdExp(_mm_sub_ps(_mm_setzero_ps(), _mm_max_ps(depth, _mm_setzero_ps()))));\n";
+        code += "}\n\n} // namespace fitted\n";
+        return code;
+    }
+
+    // HLSL 没有只接受一个标量的向量构造函数
+    const std::string vec3_zero = glsl ? "vec3(0.0)" : "(float3)0";
+    code += vec3 + " EvaluateFitRow(int row, int degree, float s) {\n";
+    code += "    " + vec3 + " b1 = " + vec3_zero + ";\n";
+    code += "    " + vec3 + " b2 = " + vec3_zero + ";\n";
+    code += "    for (int k = degree; k >= 1; --k) {\n";
+    code += "        " + vec3 + " b0 = kFitCoefficients[row + k] + 2.0 * s * b1 - b2;\n";
+    code += "        b2 = b1;\n";
+    code += "        b1 = b0;\n";
+    code += "    }\n";
+    code += "    return kFitCoefficients[row] + s * b1 - b2;\n";
+    code += "}\n\n";
+    code += vec3 + " GetTransmittanceToTopAtmosphereBoundaryFit(float r, float mu) {\n";
+    code += coordinates;
+    code += "    " + vec3 + " b1 = " + vec3_zero + ";\n";
+    code += "    " + vec3 + " b2 = " + vec3_zero + ";\n";
+    code += "    for (int j = kFitDegreeR[index]; j >= 1; --j) {\n";
+    code += "        " + vec3 + " b0 = EvaluateFitRow(kFitOffset[index] + j * width, width - 1, s) + 2.0 * t * b1 - b2;\n";
+    code += "        b2 = b1;\n";
+    code += "        b1 = b0;\n";
+    code += "    }\n";
+    code += "    " + vec3 + " depth = EvaluateFitRow(kFitOffset[index], width - 1, s) + t * b1 - b2;\n";
+    code += "    return exp(-max(depth, " + vec3_zero + "));\n";
+    code += "}\n";
+    return code;
+}
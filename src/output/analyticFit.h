@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "atmosphereParameters/definitions.h"
+#include "atmosphereParameters/shaderGenerator.h"
+#include "texture.h"
+
+struct AnalyticFitSettings {
+    // 透射率相对于 LUT 的最大相对误差
+    double max_relative_error = 1e-3;
+    // 每个方向上多项式的最高次数，同时不超过子区间内样本数的一半，避免样本之间的振荡
+    int max_degree = 24;
+    // x_mu 与 x_r 方向上最多等分的子区间数
+    int max_subdomain_count = 8;
+    // 0 表示使用硬件线程数
+    int thread_count = 0;
+};
+
+// 一个子区间，x_mu 与 x_r 映射到 [-1, 1] 后使用 Chebyshev 多项式的张量积拟合光学深度
+struct AnalyticFitSubdomain {
+    int degree_mu = 0;
+    int degree_r = 0;
+    // (degree_r + 1) x (degree_mu + 1) 个 RGB 系数，mu 方向连续排列
+    std::vector<std::array<double, 3>> coefficients;
+};
+
+// 透射率贴图的解析近似：在透射率纹理的单位坐标 (x_mu, x_r) 上拟合 -ln(T)，
+// 参数化已经把地平线附近的变化拉平，光学深度在其上是光滑的，低次多项式即可
+struct AnalyticTransmittanceFit {
+    double bottom_radius = 0.0;
+    double top_radius = 0.0;
+    // 样本覆盖的 x_mu 与 x_r 范围，范围外取边界上的值
+    double mu_begin = 0.0;
+    double mu_end = 1.0;
+    double r_begin = 0.0;
+    double r_end = 1.0;
+    // 两个方向上的等分数，subdomains 按 x_r 的下标 * subdomain_count + x_mu 的下标排列
+    int subdomain_count = 1;
+    std::vector<AnalyticFitSubdomain> subdomains;
+    // 在所有纹素上相对于 LUT 的误差
+    double max_relative_error = 0.0;
+    double mean_relative_error = 0.0;
+};
+
+// 拟合 TransmittanceParameterization 布局的 image，从一个子区间开始，
+// 任意通道在 max_degree 内达不到误差要求时把两个方向上的等分数加倍；各子区间与通道的次数搜索在多个线程上并行
+// 高处射向地平线的射线切过臭氧层的折点，光学深度在这里不光滑，需要更多的子区间
+AnalyticTransmittanceFit FitTransmittance(const AtmosphereParameters &atmosphere, const TextureImage &image,
+    const AnalyticFitSettings &settings = AnalyticFitSettings());
+
+// 在单位坐标 (x_mu, x_r) 处的 RGB 光学深度
+std::array<double, 3> EvaluateAnalyticFit(const AnalyticTransmittanceFit &fit, double x_mu, double x_r);
+
+// 生成 GetTransmittanceToTopAtmosphereBoundaryFit(r, mu)，由 (r, mu) 计算单位坐标后使用 Clenshaw 递推求值
+// C++ 版本使用 SSE，三个通道在同一个寄存器中递推
+std::string GenerateAnalyticFitShader(const AnalyticTransmittanceFit &fit, ShaderLanguage language);
@@ -0,0 +1,489 @@
+#include "bc6h.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "parallel/taskGraph.h"
+#include "pixelFormat.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define BC6H_USE_SSE2 1
+#endif
+
+namespace {
+
+constexpr int kWeights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+// 无符号半精度的最大有限值
+constexpr int kMaxHalf = 0x7BFF;
+
+// 单分区的 mode：mode 11 直接存储两个端点，mode 12 ~ 14 第二个端点以差值存储
+struct ModeInfo {
+    uint32_t mode_bits;
+    int endpoint_bits;
+    int delta_bits;
+    bool transformed;
+};
+
+constexpr ModeInfo kModes[4] = {
+    { 0x03, 10, 10, false },
+    { 0x07, 11, 9, true },
+    { 0x0B, 12, 8, true },
+    { 0x0F, 16, 4, true },
+};
+
+class BitWriter {
+public:
+    explicit BitWriter(uint8_t *block) : block_(block) {
+        std::memset(block_, 0, 16);
+    }
+
+    void Write(uint32_t value, int count) {
+        for (int i = 0; i < count; ++i, ++position_) {
+            block_[position_ >> 3] |= static_cast<uint8_t>(((value >> i) & 1u) << (position_ & 7));
+        }
+    }
+
+private:
+    uint8_t *block_;
+    int position_ = 0;
+};
+
+class BitReader {
+public:
+    explicit BitReader(const uint8_t *block) : block_(block) {}
+
+    uint32_t Read(int count) {
+        uint32_t value = 0;
+        for (int i = 0; i < count; ++i, ++position_) {
+            value |= static_cast<uint32_t>((block_[position_ >> 3] >> (position_ & 7)) & 1u) << i;
+        }
+        return value;
+    }
+
+private:
+    const uint8_t *block_;
+    int position_ = 0;
+};
+
+int Unquantize(int component, int bits) {
+    if (bits >= 15) {
+        return component;
+    }
+    if (component == 0) {
+        return 0;
+    }
+    if (component == (1 << bits) - 1) {
+        return 0xFFFF;
+    }
+    return ((component << 16) + 0x8000) >> bits;
+}
+
+// 找到反量化后最接近 value 的量化值，value 位于反量化后的 [0, 0xFFFF] 空间
+int Quantize(float value, int bits) {
+    const int max_component = (1 << bits) - 1;
+    if (bits >= 15) {
+        return std::clamp(static_cast<int>(value + 0.5f), 0, max_component);
+    }
+    const int c = std::clamp(static_cast<int>(value * static_cast<float>(1 << bits) / 65536.0f), 0, max_component);
+    const int next = std::min(c + 1, max_component);
+    return std::abs(Unquantize(next, bits) - value) < std::abs(Unquantize(c, bits) - value) ? next : c;
+}
+
+int FinishUnquantize(int value) {
+    return (value * 31) >> 6;
+}
+
+int Interpolate(int a, int b, int weight) {
+    return (a * (64 - weight) + b * weight + 32) >> 6;
+}
+
+// 16 个像素，以无符号半精度的位模式存储，在该空间中误差近似为相对误差
+struct Block {
+    float half[16][3];
+};
+
+struct Candidate {
+    int endpoints[2][3];
+    int indices[16];
+    float error;
+};
+
+// 由量化端点生成 16 个调色板颜色（半精度位模式）
+void BuildPalette(const ModeInfo &mode, const int endpoints[2][3], float palette[3][16]) {
+    for (int c = 0; c < 3; ++c) {
+        const int a = Unquantize(endpoints[0][c], mode.endpoint_bits);
+        const int b = Unquantize(endpoints[1][c], mode.endpoint_bits);
+        for (int i = 0; i < 16; ++i) {
+            palette[c][i] = static_cast<float>(FinishUnquantize(Interpolate(a, b, kWeights[i])));
+        }
+    }
+}
+
+// 为每个像素选择误差最小的索引，锚点像素（第 0 个）只能使用前 8 个索引
+float SelectIndices(const Block &block, const float palette[3][16], int indices[16]) {
+    float total = 0.0f;
+    for (int p = 0; p < 16; ++p) {
+        const int index_count = p == 0 ? 8 : 16;
+#ifdef BC6H_USE_SSE2
+        const __m128 r = _mm_set1_ps(block.half[p][0]);
+        const __m128 g = _mm_set1_ps(block.half[p][1]);
+        const __m128 b = _mm_set1_ps(block.half[p][2]);
+        __m128 best_error = _mm_set1_ps(std::numeric_limits<float>::max());
+        __m128 best_index = _mm_setzero_ps();
+        for (int i = 0; i < index_count; i += 4) {
+            const __m128 dr = _mm_sub_ps(_mm_loadu_ps(&palette[0][i]), r);
+            const __m128 dg = _mm_sub_ps(_mm_loadu_ps(&palette[1][i]), g);
+            const __m128 db = _mm_sub_ps(_mm_loadu_ps(&palette[2][i]), b);
+            const __m128 error = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+            const __m128 index = _mm_setr_ps(float(i), float(i + 1), float(i + 2), float(i + 3));
+            const __m128 less = _mm_cmplt_ps(error, best_error);
+            best_error = _mm_min_ps(error, best_error);
+            best_index = _mm_or_ps(_mm_and_ps(less, index), _mm_andnot_ps(less, best_index));
+        }
+        alignas(16) float errors[4];
+        alignas(16) float lane_indices[4];
+        _mm_store_ps(errors, best_error);
+        _mm_store_ps(lane_indices, best_index);
+        int lane = 0;
+        for (int i = 1; i < 4; ++i) {
+            if (errors[i] < errors[lane] || (errors[i] == errors[lane] && lane_indices[i] < lane_indices[lane])) {
+                lane = i;
+            }
+        }
+        indices[p] = static_cast<int>(lane_indices[lane]);
+        total += errors[lane];
+#else
+        float best = std::numeric_limits<float>::max();
+        for (int i = 0; i < index_count; ++i) {
+            const float dr = palette[0][i] - block.half[p][0];
+            const float dg = palette[1][i] - block.half[p][1];
+            const float db = palette[2][i] - block.half[p][2];
+            const float error = dr * dr + dg * dg + db * db;
+            if (error < best) {
+                best = error;
+                indices[p] = i;
+            }
+        }
+        total += best;
+#endif
+    }
+    return total;
+}
+
+// 将端点量化到 mode 的精度，差值超出范围时截断第二个端点
+void QuantizeEndpoints(const ModeInfo &mode, const float endpoints[2][3], int quantized[2][3]) {
+    const int mask = (1 << mode.endpoint_bits) - 1;
+    for (int c = 0; c < 3; ++c) {
+        // 半精度位模式到反量化空间
+        const float a = endpoints[0][c] * 64.0f / 31.0f;
+        const float b = endpoints[1][c] * 64.0f / 31.0f;
+        quantized[0][c] = Quantize(a, mode.endpoint_bits);
+        quantized[1][c] = Quantize(b, mode.endpoint_bits);
+        if (mode.transformed) {
+            const int limit = 1 << (mode.delta_bits - 1);
+            const int delta = std::clamp(quantized[1][c] - quantized[0][c], -limit, limit - 1);
+            quantized[1][c] = (quantized[0][c] + delta) & mask;
+        }
+    }
+}
+
+float EvaluateEndpoints(const Block &block, const ModeInfo &mode, const int quantized[2][3], int indices[16]) {
+    float palette[3][16];
+    BuildPalette(mode, quantized, palette);
+    return SelectIndices(block, palette, indices);
+}
+
+// 固定索引，按最小二乘重新求解端点
+bool RefineEndpoints(const Block &block, const int indices[16], float endpoints[2][3]) {
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[3] = {}, bx[3] = {};
+    for (int p = 0; p < 16; ++p) {
+        const float t = kWeights[indices[p]] / 64.0f;
+        aa += (1.0f - t) * (1.0f - t);
+        ab += (1.0f - t) * t;
+        bb += t * t;
+        for (int c = 0; c < 3; ++c) {
+            ax[c] += (1.0f - t) * block.half[p][c];
+            bx[c] += t * block.half[p][c];
+        }
+    }
+    const float det = aa * bb - ab * ab;
+    if (std::abs(det) < 1e-6f) {
+        return false;
+    }
+    for (int c = 0; c < 3; ++c) {
+        endpoints[0][c] = std::clamp((ax[c] * bb - bx[c] * ab) / det, 0.0f, float(kMaxHalf));
+        endpoints[1][c] = std::clamp((bx[c] * aa - ax[c] * ab) / det, 0.0f, float(kMaxHalf));
+    }
+    return true;
+}
+
+// 主成分方向上的包围盒作为初始端点，第 0 个像素靠近第一个端点
+void InitialEndpoints(const Block &block, float endpoints[2][3]) {
+    float mean[3] = {};
+    for (int p = 0; p < 16; ++p) {
+        for (int c = 0; c < 3; ++c) {
+            mean[c] += block.half[p][c] / 16.0f;
+        }
+    }
+    float covariance[3][3] = {};
+    for (int p = 0; p < 16; ++p) {
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                covariance[i][j] += (block.half[p][i] - mean[i]) * (block.half[p][j] - mean[j]);
+            }
+        }
+    }
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (int iteration = 0; iteration < 8; ++iteration) {
+        float next[3];
+        for (int i = 0; i < 3; ++i) {
+            next[i] = covariance[i][0] * axis[0] + covariance[i][1] * axis[1] + covariance[i][2] * axis[2];
+        }
+        const float norm = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+        if (norm < 1e-12f) {
+            break;
+        }
+        for (int i = 0; i < 3; ++i) {
+            axis[i] = next[i] / norm;
+        }
+    }
+    float t_min = std::numeric_limits<float>::max();
+    float t_max = -std::numeric_limits<float>::max();
+    float t_anchor = 0.0f;
+    for (int p = 0; p < 16; ++p) {
+        const float t = (block.half[p][0] - mean[0]) * axis[0] + (block.half[p][1] - mean[1]) * axis[1] + (block.half[p][2] - mean[2]) * axis[2];
+        t_min = std::min(t_min, t);
+        t_max = std::max(t_max, t);
+        if (p == 0) {
+            t_anchor = t;
+        }
+    }
+    if (t_anchor - t_min > t_max - t_anchor) {
+        std::swap(t_min, t_max);
+    }
+    for (int c = 0; c < 3; ++c) {
+        endpoints[0][c] = std::clamp(mean[c] + t_min * axis[c], 0.0f, float(kMaxHalf));
+        endpoints[1][c] = std::clamp(mean[c] + t_max * axis[c], 0.0f, float(kMaxHalf));
+    }
+}
+
+Candidate EncodeMode(const Block &block, const ModeInfo &mode, BC6HQuality quality) {
+    float endpoints[2][3];
+    InitialEndpoints(block, endpoints);
+    Candidate best;
+    QuantizeEndpoints(mode, endpoints, best.endpoints);
+    best.error = EvaluateEndpoints(block, mode, best.endpoints, best.indices);
+
+    const int refinements = quality == BC6HQuality::Fast ? 0 : (quality == BC6HQuality::Normal ? 1 : 3);
+    for (int iteration = 0; iteration < refinements; ++iteration) {
+        if (!RefineEndpoints(block, best.indices, endpoints)) {
+            break;
+        }
+        Candidate candidate;
+        QuantizeEndpoints(mode, endpoints, candidate.endpoints);
+        candidate.error = EvaluateEndpoints(block, mode, candidate.endpoints, candidate.indices);
+        if (candidate.error >= best.error) {
+            break;
+        }
+        best = candidate;
+    }
+
+    if (quality == BC6HQuality::High) {
+        // 逐分量在量化端点的 +-1 范围内做坐标下降
+        const int mask = (1 << mode.endpoint_bits) - 1;
+        const int limit = 1 << (mode.delta_bits - 1);
+        bool improved = true;
+        for (int pass = 0; pass < 4 && improved; ++pass) {
+            improved = false;
+            for (int e = 0; e < 2; ++e) {
+                for (int c = 0; c < 3; ++c) {
+                    for (int step : { -1, 1 }) {
+                        Candidate candidate = best;
+                        const int value = candidate.endpoints[e][c] + step;
+                        if (value < 0 || value > mask) {
+                            continue;
+                        }
+                        candidate.endpoints[e][c] = value;
+                        if (mode.transformed) {
+                            const int delta = candidate.endpoints[1][c] - candidate.endpoints[0][c];
+                            if (delta < -limit || delta >= limit) {
+                                continue;
+                            }
+                        }
+                        candidate.error = EvaluateEndpoints(block, mode, candidate.endpoints, candidate.indices);
+                        if (candidate.error < best.error) {
+                            best = candidate;
+                            improved = true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return best;
+}
+
+void PackBlock(const ModeInfo &mode, const Candidate &candidate, uint8_t *output) {
+    BitWriter writer(output);
+    writer.Write(mode.mode_bits, 5);
+    for (int c = 0; c < 3; ++c) {
+        writer.Write(static_cast<uint32_t>(candidate.endpoints[0][c]) & 0x3FFu, 10);
+    }
+    for (int c = 0; c < 3; ++c) {
+        const int second = mode.transformed ?
+            candidate.endpoints[1][c] - candidate.endpoints[0][c] :
+            candidate.endpoints[1][c];
+        writer.Write(static_cast<uint32_t>(second) & ((1u << mode.delta_bits) - 1u), mode.delta_bits);
+        // 第一个端点超出 10 位的高位按逆序存放
+        for (int bit = mode.endpoint_bits - 1; bit >= 10; --bit) {
+            writer.Write(static_cast<uint32_t>(candidate.endpoints[0][c] >> bit) & 1u, 1);
+        }
+    }
+    writer.Write(static_cast<uint32_t>(candidate.indices[0]), 3);
+    for (int p = 1; p < 16; ++p) {
+        writer.Write(static_cast<uint32_t>(candidate.indices[p]), 4);
+    }
+}
+
+void LoadBlock(const float *rgb, int width, int height, int block_x, int block_y, Block &block) {
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 4; ++x) {
+            const int px = std::min(block_x * 4 + x, width - 1);
+            const int py = std::min(block_y * 4 + y, height - 1);
+            const float *texel = rgb + (static_cast<size_t>(py) * width + px) * 3;
+            for (int c = 0; c < 3; ++c) {
+                const uint16_t half = FloatToHalf(std::max(texel[c], 0.0f));
+                block.half[y * 4 + x][c] = static_cast<float>(std::min<int>(half, kMaxHalf));
+            }
+        }
+    }
+}
+
+void CompressBlock(const Block &block, BC6HQuality quality, uint8_t *output) {
+    const int mode_count = quality == BC6HQuality::Fast ? 1 : 4;
+    int best_mode = 0;
+    Candidate best = EncodeMode(block, kModes[0], quality);
+    for (int m = 1; m < mode_count; ++m) {
+        const Candidate candidate = EncodeMode(block, kModes[m], quality);
+        if (candidate.error < best.error) {
+            best = candidate;
+            best_mode = m;
+        }
+    }
+    PackBlock(kModes[best_mode], best, output);
+}
+
+} // namespace
+
+const char *GetBC6HQualityName(BC6HQuality quality) {
+    switch (quality) {
+    case BC6HQuality::Fast: return "fast";
+    case BC6HQuality::Normal: return "normal";
+    case BC6HQuality::High: return "high";
+    }
+    return "unknown";
+}
+
+bool ParseBC6HQuality(const char *name, BC6HQuality &quality) {
+    for (BC6HQuality candidate : { BC6HQuality::Fast, BC6HQuality::Normal, BC6HQuality::High }) {
+        if (std::strcmp(name, GetBC6HQualityName(candidate)) == 0) {
+            quality = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<uint8_t> CompressBC6H(const float *rgb, int width, int height, BC6HQuality quality, int thread_count) {
+    const int blocks_x = (width + 3) / 4;
+    const int blocks_y = (height + 3) / 4;
+    std::vector<uint8_t> blocks(static_cast<size_t>(blocks_x) * blocks_y * 16);
+    // 每个线程处理一行块
+    RunTaskRange(blocks_y, thread_count, [&](int by) {
+        Block block;
+        for (int bx = 0; bx < blocks_x; ++bx) {
+            LoadBlock(rgb, width, height, bx, by, block);
+            CompressBlock(block, quality, blocks.data() + (static_cast<size_t>(by) * blocks_x + bx) * 16);
+        }
+    });
+    return blocks;
+}
+
+void DecompressBC6H(const uint8_t *blocks, int width, int height, float *rgb) {
+    const int blocks_x = (width + 3) / 4;
+    const int blocks_y = (height + 3) / 4;
+    for (int by = 0; by < blocks_y; ++by) {
+        for (int bx = 0; bx < blocks_x; ++bx) {
+            BitReader reader(blocks + (static_cast<size_t>(by) * blocks_x + bx) * 16);
+            const uint32_t mode_bits = reader.Read(5);
+            const ModeInfo *mode = nullptr;
+            for (const ModeInfo &candidate : kModes) {
+                if (candidate.mode_bits == mode_bits) {
+                    mode = &candidate;
+                }
+            }
+            int endpoints[2][3] = {};
+            int indices[16] = {};
+            if (mode != nullptr) {
+                for (int c = 0; c < 3; ++c) {
+                    endpoints[0][c] = static_cast<int>(reader.Read(10));
+                }
+                for (int c = 0; c < 3; ++c) {
+                    int second = static_cast<int>(reader.Read(mode->delta_bits));
+                    for (int bit = mode->endpoint_bits - 1; bit >= 10; --bit) {
+                        endpoints[0][c] |= static_cast<int>(reader.Read(1)) << bit;
+                    }
+                    if (mode->transformed) {
+                        // 符号扩展差值
+                        if (second & (1 << (mode->delta_bits - 1))) {
+                            second -= 1 << mode->delta_bits;
+                        }
+                        second = (endpoints[0][c] + second) & ((1 << mode->endpoint_bits) - 1);
+                    }
+                    endpoints[1][c] = second;
+                }
+                indices[0] = static_cast<int>(reader.Read(3));
+                for (int p = 1; p < 16; ++p) {
+                    indices[p] = static_cast<int>(reader.Read(4));
+                }
+            }
+            float palette[3][16] = {};
+            if (mode != nullptr) {
+                BuildPalette(*mode, endpoints, palette);
+            }
+            for (int p = 0; p < 16; ++p) {
+                const int x = bx * 4 + p % 4;
+                const int y = by * 4 + p / 4;
+                if (x >= width || y >= height) {
+                    continue;
+                }
+                float *texel = rgb + (static_cast<size_t>(y) * width + x) * 3;
+                for (int c = 0; c < 3; ++c) {
+                    texel[c] = HalfToFloat(static_cast<uint16_t>(palette[c][indices[p]]));
+                }
+            }
+        }
+    }
+}
+
+BC6HErrorReport MeasureBC6HError(const float *source, const float *decoded, size_t texel_count) {
+    constexpr double kMinRelativeDenominator = 1.0 / 16384.0;
+    BC6HErrorReport report;
+    double peak = 0.0;
+    double squared_error = 0.0;
+    for (size_t i = 0; i < texel_count * 3; ++i) {
+        const double error = static_cast<double>(decoded[i]) - static_cast<double>(source[i]);
+        peak = std::max(peak, static_cast<double>(source[i]));
+        squared_error += error * error;
+        report.max_relative_error = std::max(report.max_relative_error,
+            std::abs(error) / std::max(static_cast<double>(source[i]), kMinRelativeDenominator));
+    }
+    const double mse = texel_count > 0 ? squared_error / static_cast<double>(texel_count * 3) : 0.0;
+    report.rmse = std::sqrt(mse);
+    report.psnr = mse > 0.0 ? 10.0 * std::log10(peak * peak / mse) : std::numeric_limits<double>::infinity();
+    return report;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// BC6H 压缩质量，只使用单分区的 mode 11 ~ 14
+enum class BC6HQuality {
+    // 只使用 mode 11，端点取主成分方向上的包围盒
+    Fast,
+    // 尝试所有单分区 mode，并做一次最小二乘端点优化
+    Normal,
+    // 多次最小二乘优化，并在量化后的端点附近搜索
+    High,
+};
+
+const char *GetBC6HQualityName(BC6HQuality quality);
+bool ParseBC6HQuality(const char *name, BC6HQuality &quality);
+
+// BC6H 解码结果相对于原始 float 数据的误差
+struct BC6HErrorReport {
+    // 以原始数据的最大值作为峰值
+    double psnr = 0.0;
+    double rmse = 0.0;
+    // 分母不小于半精度最小规格化数 2^-14，避免接近 0 的透射率主导统计
+    double max_relative_error = 0.0;
+};
+
+// 将 width x height 的 RGB float 图像压缩为 BC6H_UF16，结果为按行排列的 16 字节块
+// 不足 4 的边缘块重复边缘像素，thread_count 为 0 时使用硬件线程数
+std::vector<uint8_t> CompressBC6H(const float *rgb, int width, int height, BC6HQuality quality, int thread_count = 0);
+
+// 解码 CompressBC6H 的结果，用于误差统计
+void DecompressBC6H(const uint8_t *blocks, int width, int height, float *rgb);
+
+BC6HErrorReport MeasureBC6HError(const float *source, const float *decoded, size_t texel_count);
@@ -0,0 +1,101 @@
+#include "embeddedHeader.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+// 每个数组包含的行数，拆分成多个较小的数组可以明显缩短编译时间
+constexpr int kRowsPerChunk = 16;
+constexpr int kValuesPerLine = 12;
+
+std::string HexFloat(double value) {
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%a", value);
+    return buffer;
+}
+
+std::string FormatVec3(const Vec3d &v) {
+    return "Vec3d(" + HexFloat(v.x) + ", " + HexFloat(v.y) + ", " + HexFloat(v.z) + ")";
+}
+
+std::string FormatDensityProfile(const DensityProfile &profile) {
+    std::string result = "DensityProfile{\n";
+    for (int i = 0; i < 2; ++i) {
+        const DensityProfileLayer &layer = profile.layers[i];
+        result += "        DensityProfileLayer{ " + HexFloat(layer.width) + ", " + HexFloat(layer.exp_term) + ", " +
+            HexFloat(layer.exp_scale) + ", " + HexFloat(layer.linear_term) + ", " + HexFloat(layer.constant_term) + " }";
+        result += i == 0 ? ",\n" : "\n";
+    }
+    return result + "    }";
+}
+
+} // namespace
+
+std::string FormatAtmosphereParametersLiteral(const AtmosphereParameters &atmosphere) {
+    return "AtmosphereParameters{\n    " +
+        FormatVec3(atmosphere.solar_irradiance) + ",\n    " +
+        HexFloat(atmosphere.sun_angular_radius) + ",\n    " +
+        HexFloat(atmosphere.bottom_radius) + ",\n    " +
+        HexFloat(atmosphere.top_radius) + ",\n    " +
+        FormatDensityProfile(atmosphere.rayleigh_density) + ",\n    " +
+        FormatVec3(atmosphere.rayleigh_scattering) + ",\n    " +
+        FormatDensityProfile(atmosphere.mie_density) + ",\n    " +
+        FormatVec3(atmosphere.mie_scattering) + ",\n    " +
+        FormatVec3(atmosphere.mie_extinction) + ",\n    " +
+        HexFloat(atmosphere.mie_phase_function_g) + ",\n    " +
+        FormatDensityProfile(atmosphere.absorption_density) + ",\n    " +
+        FormatVec3(atmosphere.absorption_extinction) + ",\n    " +
+        FormatVec3(atmosphere.ground_albedo) + ",\n    " +
+        HexFloat(atmosphere.mu_s_min) + " }";
+}
+
+bool WriteEmbeddedHeader(const std::string &path, const std::string &name,
+    const AtmosphereParameters &atmosphere, const TextureImage &image) {
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "Failed to open " << path << std::endl;
+        return false;
+    }
+    const int rows = image.height * image.depth;
+    const int chunk_count = (rows + kRowsPerChunk - 1) / kRowsPerChunk;
+    const std::string k = "k" + name;
+
+    file << "// Generated by Transmittance --format header, do not edit.\n"
+        << "#pragma once\n\n"
+        << "#include \"atmosphereParameters/definitions.h\"\n\n"
+        << "inline constexpr int " << k << "Width = " << image.width << ";\n"
+        << "inline constexpr int " << k << "Height = " << image.height << ";\n"
+        << "inline constexpr int " << k << "Depth = " << image.depth << ";\n"
+        << "inline constexpr int " << k << "RowsPerChunk = " << kRowsPerChunk << ";\n\n"
+        << "// The parameters the data below was baked with.\n"
+        << "inline constexpr AtmosphereParameters " << k << "Atmosphere = "
+        << FormatAtmosphereParametersLiteral(atmosphere) << ";\n\n";
+
+    // 以十六进制浮点数写出，保证与烘焙结果逐位一致，且解析速度快于十进制
+    for (int chunk = 0; chunk < chunk_count; ++chunk) {
+        const int first_row = chunk * kRowsPerChunk;
+        const int last_row = std::min(rows, first_row + kRowsPerChunk);
+        const size_t begin = static_cast<size_t>(first_row) * image.width * 3;
+        const size_t end = static_cast<size_t>(last_row) * image.width * 3;
+        file << "alignas(64) inline constexpr float " << k << "Chunk" << chunk << "[" << end - begin << "] = {";
+        for (size_t i = begin; i < end; ++i) {
+            file << ((i - begin) % kValuesPerLine == 0 ? "\n    " : " ") << HexFloat(image.texels[i]) << "f,";
+        }
+        file << "\n};\n\n";
+    }
+
+    file << "inline constexpr const float *" << k << "Chunks[" << chunk_count << "] = {";
+    for (int chunk = 0; chunk < chunk_count; ++chunk) {
+        file << (chunk % 8 == 0 ? "\n    " : " ") << k << "Chunk" << chunk << ",";
+    }
+    file << "\n};\n\n"
+        << "// RGB value of texel (x, y, z), usable in constant expressions.\n"
+        << "constexpr const float *" << name << "Texel(int x, int y, int z = 0) {\n"
+        << "    return " << k << "Chunks[(z * " << k << "Height + y) / " << k << "RowsPerChunk] +\n"
+        << "        ((z * " << k << "Height + y) % " << k << "RowsPerChunk * " << k << "Width + x) * 3;\n"
+        << "}\n";
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string>
+
+#include "atmosphereParameters/definitions.h"
+#include "texture.h"
+
+// 将 AtmosphereParameters 格式化为 C++ 字面量，数值以十六进制浮点数精确表示
+std::string FormatAtmosphereParametersLiteral(const AtmosphereParameters &atmosphere);
+
+// 写出 constexpr 的 C++ 头文件，包含烘焙数据与烘焙时使用的 AtmosphereParameters，
+// 运行时直接包含即可使用，不需要文件 IO。name 用作生成的标识符前缀，例如 "Transmittance"
+bool WriteEmbeddedHeader(const std::string &path, const std::string &name,
+    const AtmosphereParameters &atmosphere, const TextureImage &image);
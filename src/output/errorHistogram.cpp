@@ -0,0 +1,62 @@
+#include "errorHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+ErrorHistogram ComputeErrorHistogram(const float *source, const float *decoded, size_t value_count) {
+    ErrorHistogram histogram;
+    double sum = 0.0;
+    for (size_t i = 0; i < value_count; ++i) {
+        if (source[i] == 0.0f) {
+            continue;
+        }
+        const double error = std::abs(static_cast<double>(decoded[i]) - source[i]) / std::abs(static_cast<double>(source[i]));
+        // 第 0 个区间的上界为 1e-6，之后每个区间增加一个数量级
+        const int bin = error < 1e-6 ? 0 : std::min(ErrorHistogram::kBinCount - 1, static_cast<int>(std::floor(std::log10(error))) + 7);
+        ++histogram.counts[bin];
+        ++histogram.sample_count;
+        sum += error;
+        histogram.max_relative_error = std::max(histogram.max_relative_error, error);
+    }
+    histogram.mean_relative_error = histogram.sample_count > 0 ? sum / static_cast<double>(histogram.sample_count) : 0.0;
+    return histogram;
+}
+
+ErrorHistogram ComputeFormatErrorHistogram(const TextureImage &image, PixelFormat format, BC6HQuality quality) {
+    std::vector<float> decoded(image.texels.size());
+    const size_t slice_texels = static_cast<size_t>(image.width) * image.height;
+    for (int z = 0; z < image.depth; ++z) {
+        float *decoded_slice = decoded.data() + z * slice_texels * 3;
+        if (format == PixelFormat::BC6H) {
+            const std::vector<uint8_t> blocks = CompressBC6H(image.GetTexel(0, 0, z), image.width, image.height, quality);
+            DecompressBC6H(blocks.data(), image.width, image.height, decoded_slice);
+        } else {
+            std::vector<uint8_t> encoded;
+            EncodeTexels(image.GetTexel(0, 0, z), slice_texels, format, encoded);
+            DecodeTexels(encoded.data(), slice_texels, format, decoded_slice);
+        }
+    }
+    ErrorHistogram histogram = ComputeErrorHistogram(image.texels.data(), decoded.data(), image.texels.size());
+    histogram.format = format;
+    return histogram;
+}
+
+void PrintErrorHistograms(std::ostream &stream, const std::vector<ErrorHistogram> &histograms) {
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-20s %9s %9s %9s %9s %9s %9s %9s %12s %12s\n",
+        "format", "<1e-6", "<1e-5", "<1e-4", "<1e-3", "<1e-2", "<1e-1", ">=1e-1", "mean", "max");
+    stream << line;
+    for (const ErrorHistogram &histogram : histograms) {
+        std::snprintf(line, sizeof(line), "%-20s", histogram.label != nullptr ? histogram.label : GetPixelFormatName(histogram.format));
+        stream << line;
+        for (size_t count : histogram.counts) {
+            // 以百分比输出每个区间
+            const double percent = histogram.sample_count > 0 ? 100.0 * count / histogram.sample_count : 0.0;
+            std::snprintf(line, sizeof(line), " %8.3f%%", percent);
+            stream << line;
+        }
+        std::snprintf(line, sizeof(line), " %12.4e %12.4e\n", histogram.mean_relative_error, histogram.max_relative_error);
+        stream << line;
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+#include "bc6h.h"
+#include "pixelFormat.h"
+#include "texture.h"
+
+// 按数量级统计的相对误差直方图，原始值为 0 的分量不计入
+struct ErrorHistogram {
+    // [0, 1e-6), [1e-6, 1e-5), ..., [1e-2, 1e-1), [1e-1, +inf)
+    static constexpr int kBinCount = 7;
+
+    PixelFormat format = PixelFormat::RGBA32F;
+    // 不为空时代替格式名输出
+    const char *label = nullptr;
+    size_t counts[kBinCount] = {};
+    size_t sample_count = 0;
+    double max_relative_error = 0.0;
+    double mean_relative_error = 0.0;
+};
+
+ErrorHistogram ComputeErrorHistogram(const float *source, const float *decoded, size_t value_count);
+
+// 将整张纹理编码为 format 后再解码，统计相对于原始 float 数据的误差
+ErrorHistogram ComputeFormatErrorHistogram(const TextureImage &image, PixelFormat format,
+    BC6HQuality quality = BC6HQuality::Normal);
+
+void PrintErrorHistograms(std::ostream &stream, const std::vector<ErrorHistogram> &histograms);
@@ -0,0 +1,299 @@
+#include "lowRank.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+#include "errorHistogram.h"
+#include "math/vec.h"
+#include "parallel/taskGraph.h"
+
+namespace {
+
+// 透射率为 0 的纹素（地下的射线）取 exp(-69)，保证光学深度有限
+constexpr float kMinTransmittance = 1e-30f;
+// 每个线程任务处理的 float 数
+constexpr size_t kChunkSize = 4096;
+// 小于最大特征值这一倍数的特征值视为数值噪声
+constexpr double kEigenvalueEpsilon = 1e-12;
+
+// 对称矩阵 a（n x n，按行存储）的循环 Jacobi 特征分解，特征值写入 a 的对角线，特征向量为 vectors 的列
+void JacobiEigen(std::vector<double> &a, int n, std::vector<double> &vectors) {
+    vectors.assign(static_cast<size_t>(n) * n, 0.0);
+    for (int i = 0; i < n; ++i) {
+        vectors[static_cast<size_t>(i) * n + i] = 1.0;
+    }
+    auto at = [&](std::vector<double> &m, int i, int j) -> double & {
+        return m[static_cast<size_t>(i) * n + j];
+    };
+    double norm = 0.0;
+    for (double value : a) {
+        norm += value * value;
+    }
+    constexpr int kMaxSweepCount = 64;
+    for (int sweep = 0; sweep < kMaxSweepCount; ++sweep) {
+        double off_diagonal = 0.0;
+        for (int i = 0; i < n; ++i) {
+            for (int j = i + 1; j < n; ++j) {
+                off_diagonal += 2.0 * at(a, i, j) * at(a, i, j);
+            }
+        }
+        if (off_diagonal <= 1e-28 * norm) {
+            break;
+        }
+        for (int p = 0; p < n; ++p) {
+            for (int q = p + 1; q < n; ++q) {
+                const double apq = at(a, p, q);
+                if (apq == 0.0) {
+                    continue;
+                }
+                // 使 a[p][q] 为 0 的旋转，t 取绝对值较小的根
+                const double theta = (at(a, q, q) - at(a, p, p)) / (2.0 * apq);
+                const double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+                const double c = 1.0 / std::sqrt(t * t + 1.0);
+                const double s = t * c;
+                for (int k = 0; k < n; ++k) {
+                    const double akp = at(a, k, p);
+                    const double akq = at(a, k, q);
+                    at(a, k, p) = c * akp - s * akq;
+                    at(a, k, q) = s * akp + c * akq;
+                }
+                for (int k = 0; k < n; ++k) {
+                    const double apk = at(a, p, k);
+                    const double aqk = at(a, q, k);
+                    at(a, p, k) = c * apk - s * aqk;
+                    at(a, q, k) = s * apk + c * aqk;
+                }
+                for (int k = 0; k < n; ++k) {
+                    const double vkp = at(vectors, k, p);
+                    const double vkq = at(vectors, k, q);
+                    at(vectors, k, p) = c * vkp - s * vkq;
+                    at(vectors, k, q) = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+}
+
+// 所有变体重建后相对于 family 的最大相对误差
+double MeasureMaxError(const LowRankTexture &texture, const TextureImage &family, int thread_count) {
+    std::vector<double> errors(texture.variant_count, 0.0);
+    RunTaskRange(texture.variant_count, thread_count, [&](int variant) {
+        std::vector<float> rgb(texture.GetValueCount());
+        ReconstructLowRank(texture, texture.coefficients.data() + static_cast<size_t>(variant) * texture.rank, rgb.data());
+        errors[variant] = ComputeErrorHistogram(family.GetTexel(0, 0, variant), rgb.data(), rgb.size()).max_relative_error;
+    });
+    return *std::max_element(errors.begin(), errors.end());
+}
+
+} // namespace
+
+LowRankTexture CompressLowRank(const TextureImage &family, double max_relative_error, int max_rank, int thread_count) {
+    LowRankTexture texture;
+    texture.width = family.width;
+    texture.height = family.height;
+    texture.variant_count = family.depth;
+    const int m = family.depth;
+    const size_t n = texture.GetValueCount();
+    const int chunk_count = static_cast<int>((n + kChunkSize - 1) / kChunkSize);
+
+    std::vector<float> depths(static_cast<size_t>(m) * n);
+    RunTaskRange(m, thread_count, [&](int variant) {
+        const float *source = family.GetTexel(0, 0, variant);
+        float *depth = depths.data() + static_cast<size_t>(variant) * n;
+        for (size_t i = 0; i < n; ++i) {
+            depth[i] = -std::log(std::max(source[i], kMinTransmittance));
+        }
+    });
+    texture.mean.resize(n);
+    RunTaskRange(chunk_count, thread_count, [&](int chunk) {
+        const size_t end = std::min(n, (chunk + 1) * kChunkSize);
+        for (size_t i = chunk * kChunkSize; i < end; ++i) {
+            double sum = 0.0;
+            for (int variant = 0; variant < m; ++variant) {
+                sum += depths[static_cast<size_t>(variant) * n + i];
+            }
+            texture.mean[i] = static_cast<float>(sum / m);
+        }
+    });
+    // 变体数远小于纹素数，分解 m x m 的 Gram 矩阵代替 n x n 的协方差矩阵
+    RunTaskRange(m, thread_count, [&](int variant) {
+        float *depth = depths.data() + static_cast<size_t>(variant) * n;
+        for (size_t i = 0; i < n; ++i) {
+            depth[i] -= texture.mean[i];
+        }
+    });
+    std::vector<double> gram(static_cast<size_t>(m) * m);
+    RunTaskRange(m, thread_count, [&](int i) {
+        const float *a = depths.data() + static_cast<size_t>(i) * n;
+        for (int j = i; j < m; ++j) {
+            const float *b = depths.data() + static_cast<size_t>(j) * n;
+            double sum = 0.0;
+            for (size_t k = 0; k < n; ++k) {
+                sum += static_cast<double>(a[k]) * b[k];
+            }
+            gram[static_cast<size_t>(i) * m + j] = sum;
+            gram[static_cast<size_t>(j) * m + i] = sum;
+        }
+    });
+    std::vector<double> vectors;
+    JacobiEigen(gram, m, vectors);
+    std::vector<int> order(m);
+    for (int i = 0; i < m; ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        return gram[static_cast<size_t>(a) * m + a] > gram[static_cast<size_t>(b) * m + b];
+    });
+    const double largest = m > 0 ? gram[static_cast<size_t>(order[0]) * m + order[0]] : 0.0;
+    int component_count = 0;
+    while (component_count < m && gram[static_cast<size_t>(order[component_count]) * m + order[component_count]] >
+        largest * kEigenvalueEpsilon) {
+        ++component_count;
+    }
+    if (max_rank > 0) {
+        component_count = std::min(component_count, max_rank);
+    }
+
+    // 主成分 basis_k = sum_j e_k[j] * X_j / sigma_k，系数为 X_j 在 basis_k 上的投影 sigma_k * e_k[j]
+    std::vector<float> basis(static_cast<size_t>(component_count) * n);
+    std::vector<double> sigmas(component_count);
+    for (int k = 0; k < component_count; ++k) {
+        sigmas[k] = std::sqrt(gram[static_cast<size_t>(order[k]) * m + order[k]]);
+    }
+    RunTaskRange(chunk_count, thread_count, [&](int chunk) {
+        const size_t end = std::min(n, (chunk + 1) * kChunkSize);
+        for (int k = 0; k < component_count; ++k) {
+            float *component = basis.data() + static_cast<size_t>(k) * n;
+            for (size_t i = chunk * kChunkSize; i < end; ++i) {
+                double sum = 0.0;
+                for (int variant = 0; variant < m; ++variant) {
+                    sum += vectors[static_cast<size_t>(variant) * m + order[k]] * depths[static_cast<size_t>(variant) * n + i];
+                }
+                component[i] = static_cast<float>(sum / sigmas[k]);
+            }
+        }
+    });
+
+    // 从低到高尝试各个 rank，通常在变化的参数个数附近停止
+    for (int rank = 0; rank <= component_count; ++rank) {
+        texture.rank = rank;
+        texture.basis.assign(basis.begin(), basis.begin() + static_cast<size_t>(rank) * n);
+        texture.coefficients.resize(static_cast<size_t>(m) * rank);
+        for (int variant = 0; variant < m; ++variant) {
+            for (int k = 0; k < rank; ++k) {
+                texture.coefficients[static_cast<size_t>(variant) * rank + k] =
+                    static_cast<float>(sigmas[k] * vectors[static_cast<size_t>(variant) * m + order[k]]);
+            }
+        }
+        if (MeasureMaxError(texture, family, thread_count) <= max_relative_error) {
+            break;
+        }
+    }
+    return texture;
+}
+
+std::vector<float> BlendLowRankCoefficients(const LowRankTexture &texture, const std::vector<float> &weights) {
+    std::vector<float> coefficients(texture.rank, 0.0f);
+    for (int variant = 0; variant < texture.variant_count; ++variant) {
+        for (int k = 0; k < texture.rank; ++k) {
+            coefficients[k] += weights[variant] * texture.coefficients[static_cast<size_t>(variant) * texture.rank + k];
+        }
+    }
+    return coefficients;
+}
+
+void ReconstructLowRank(const LowRankTexture &texture, const float *coefficients, float *rgb) {
+    const size_t n = texture.GetValueCount();
+    const float *mean = texture.mean.data();
+    const float *basis = texture.basis.data();
+    size_t i = 0;
+#if MATH_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4) {
+        __m128 depth = _mm_loadu_ps(mean + i);
+        for (int k = 0; k < texture.rank; ++k) {
+            depth = _mm_add_ps(depth, _mm_mul_ps(_mm_set1_ps(coefficients[k]), _mm_loadu_ps(basis + k * n + i)));
+        }
+        // 截断后的光学深度可能略小于 0
+        _mm_storeu_ps(rgb + i, SimdExp(_mm_sub_ps(zero, _mm_max_ps(depth, zero))));
+    }
+#endif
+    for (; i < n; ++i) {
+        float depth = mean[i];
+        for (int k = 0; k < texture.rank; ++k) {
+            depth += coefficients[k] * basis[k * n + i];
+        }
+        rgb[i] = std::exp(-std::max(depth, 0.0f));
+    }
+}
+
+TextureImage ReconstructLowRankVariant(const LowRankTexture &texture, int variant) {
+    TextureImage image(texture.width, texture.height);
+    ReconstructLowRank(texture, texture.coefficients.data() + static_cast<size_t>(variant) * texture.rank,
+        image.texels.data());
+    return image;
+}
+
+bool WriteLowRankTexture(const std::string &path, const LowRankTexture &texture) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to open " << path << std::endl;
+        return false;
+    }
+    const int32_t header[4] = { texture.width, texture.height, texture.variant_count, texture.rank };
+    file.write("LRT1", 4);
+    file.write(reinterpret_cast<const char *>(header), sizeof(header));
+    for (const std::vector<float> *values : { &texture.mean, &texture.basis, &texture.coefficients }) {
+        file.write(reinterpret_cast<const char *>(values->data()), values->size() * sizeof(float));
+    }
+    return static_cast<bool>(file);
+}
+
+bool ReadLowRankTexture(const std::string &path, LowRankTexture &texture) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[4];
+    int32_t header[4];
+    if (!file.read(magic, 4) || std::memcmp(magic, "LRT1", 4) != 0 ||
+        !file.read(reinterpret_cast<char *>(header), sizeof(header))) {
+        std::cerr << path << " is not a low-rank LUT" << std::endl;
+        return false;
+    }
+    LowRankTexture result;
+    result.width = header[0];
+    result.height = header[1];
+    result.variant_count = header[2];
+    result.rank = header[3];
+    if (result.width <= 0 || result.height <= 0 || result.variant_count <= 0 || result.rank < 0 ||
+        result.rank > result.variant_count) {
+        std::cerr << path << " has an invalid header" << std::endl;
+        return false;
+    }
+    // 先按文件长度检查，避免损坏的头部导致分配过大的内存
+    const std::streamoff data_begin = file.tellg();
+    file.seekg(0, std::ios::end);
+    const uint64_t available = static_cast<uint64_t>(file.tellg() - data_begin);
+    file.seekg(data_begin);
+    const uint64_t value_count = static_cast<uint64_t>(result.width) * static_cast<uint64_t>(result.height) * 3;
+    const uint64_t float_count = value_count * (1 + static_cast<uint64_t>(result.rank)) +
+        static_cast<uint64_t>(result.variant_count) * result.rank;
+    if (available / sizeof(float) < float_count) {
+        std::cerr << path << " is truncated" << std::endl;
+        return false;
+    }
+    result.mean.resize(result.GetValueCount());
+    result.basis.resize(result.GetValueCount() * result.rank);
+    result.coefficients.resize(static_cast<size_t>(result.variant_count) * result.rank);
+    for (std::vector<float> *values : { &result.mean, &result.basis, &result.coefficients }) {
+        if (!file.read(reinterpret_cast<char *>(values->data()), values->size() * sizeof(float))) {
+            std::cerr << path << " is truncated" << std::endl;
+            return false;
+        }
+    }
+    texture = std::move(result);
+    return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "texture.h"
+
+// 一组参数化相同的透射率 LUT（例如 BakeTransmittanceSweep 的结果）的低秩近似
+// 在光学深度 -ln(T) 上做主成分分析：消光系数缩放时光学深度是线性变化的，这类变体只需要很少的主成分，
+// 系数线性插值即是参数的线性插值
+struct LowRankTexture {
+    int width = 0;
+    int height = 0;
+    int variant_count = 0;
+    int rank = 0;
+    // 各变体光学深度的均值，width * height * 3 个 float
+    std::vector<float> mean;
+    // rank 个主成分，排列方式与 mean 相同
+    std::vector<float> basis;
+    // 各变体在主成分上的系数，variant_count * rank 个
+    std::vector<float> coefficients;
+
+    size_t GetValueCount() const {
+        return static_cast<size_t>(width) * height * 3;
+    }
+
+    // 存储的 float 数
+    size_t GetStorageSize() const {
+        return mean.size() + basis.size() + coefficients.size();
+    }
+};
+
+// family 的每个切片为一个变体，选取最小的 rank 使所有变体重建后的透射率相对误差不超过 max_relative_error
+// max_rank 为 0 时不限制，Gram 矩阵与主成分的计算在 thread_count 个线程上进行，为 0 时使用硬件线程数
+LowRankTexture CompressLowRank(const TextureImage &family, double max_relative_error, int max_rank = 0,
+    int thread_count = 0);
+
+// 按 weights（variant_count 个）混合各变体的系数，结果为 rank 个
+std::vector<float> BlendLowRankCoefficients(const LowRankTexture &texture, const std::vector<float> &weights);
+
+// 由 rank 个系数重建 width x height 的 RGB 透射率，光学深度的线性组合与 exp 在同一遍 SIMD 循环中完成
+void ReconstructLowRank(const LowRankTexture &texture, const float *coefficients, float *rgb);
+
+TextureImage ReconstructLowRankVariant(const LowRankTexture &texture, int variant);
+
+// 二进制格式：magic "LRT1"，width、height、variant_count、rank 四个 int32，之后依次为 mean、basis 与 coefficients
+bool WriteLowRankTexture(const std::string &path, const LowRankTexture &texture);
+bool ReadLowRankTexture(const std::string &path, LowRankTexture &texture);
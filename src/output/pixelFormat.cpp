@@ -0,0 +1,275 @@
+#include "pixelFormat.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+uint32_t FloatBits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+float BitsToFloat(uint32_t bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+template<class T>
+void AppendBytes(std::vector<uint8_t> &out, T value) {
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template<class T>
+T ReadBytes(const uint8_t *data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+} // namespace
+
+int GetBytesPerTexel(PixelFormat format) {
+    switch (format) {
+    case PixelFormat::RGBA16F: return 8;
+    case PixelFormat::RGBA32F: return 16;
+    case PixelFormat::B10G11R11F: return 4;
+    case PixelFormat::E5B9G9R9: return 4;
+    case PixelFormat::BC6H: return 16;
+    case PixelFormat::RGBA16Log: return 8;
+    }
+    return 0;
+}
+
+bool IsBlockCompressed(PixelFormat format) {
+    return format == PixelFormat::BC6H;
+}
+
+const char *GetPixelFormatName(PixelFormat format) {
+    switch (format) {
+    case PixelFormat::RGBA16F: return "rgba16f";
+    case PixelFormat::RGBA32F: return "rgba32f";
+    case PixelFormat::B10G11R11F: return "b10g11r11f";
+    case PixelFormat::E5B9G9R9: return "e5b9g9r9";
+    case PixelFormat::BC6H: return "bc6h";
+    case PixelFormat::RGBA16Log: return "rgba16log";
+    }
+    return "unknown";
+}
+
+bool ParsePixelFormat(const char *name, PixelFormat &format) {
+    for (PixelFormat candidate : { PixelFormat::RGBA16F, PixelFormat::RGBA32F, PixelFormat::B10G11R11F, PixelFormat::E5B9G9R9,
+        PixelFormat::BC6H, PixelFormat::RGBA16Log }) {
+        if (std::strcmp(name, GetPixelFormatName(candidate)) == 0) {
+            format = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint16_t FloatToHalf(float value) {
+    const uint32_t bits = FloatBits(value);
+    const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+    const uint32_t abs_bits = bits & 0x7FFFFFFFu;
+    // NaN 与 Inf
+    if (abs_bits >= 0x7F800000u) {
+        return sign | (abs_bits > 0x7F800000u ? 0x7E00u : 0x7C00u);
+    }
+    // 上溢为 Inf
+    if (abs_bits >= 0x477FF000u) {
+        return sign | 0x7C00u;
+    }
+    // 非规格化数，按就近舍入
+    if (abs_bits < 0x38800000u) {
+        const float abs_value = BitsToFloat(abs_bits);
+        return sign | static_cast<uint16_t>(std::nearbyint(abs_value * 16777216.0f));
+    }
+    // 规格化数，就近偶数舍入，进位会自然地进入指数位
+    uint32_t half = ((abs_bits >> 13) - (112u << 10));
+    const uint32_t remainder = abs_bits & 0x1FFFu;
+    if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u))) {
+        ++half;
+    }
+    return sign | static_cast<uint16_t>(half);
+}
+
+float HalfToFloat(uint16_t half) {
+    const uint32_t sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+    const uint32_t exponent = (half >> 10) & 0x1Fu;
+    const uint32_t mantissa = half & 0x3FFu;
+    if (exponent == 0) {
+        const float value = static_cast<float>(mantissa) / 16777216.0f;
+        return sign ? -value : value;
+    }
+    if (exponent == 31) {
+        return BitsToFloat(sign | 0x7F800000u | (mantissa << 13));
+    }
+    return BitsToFloat(sign | ((exponent + 112u) << 23) | (mantissa << 13));
+}
+
+uint32_t FloatToUnsignedSmallFloat(float value, int mantissa_bits) {
+    // 负数与 NaN 均写为 0
+    if (!(value > 0.0f)) {
+        return 0;
+    }
+    const uint32_t max_code = (30u << mantissa_bits) | ((1u << mantissa_bits) - 1u);
+    const uint32_t bits = FloatBits(value);
+    const int exponent = static_cast<int>((bits >> 23) & 0xFFu) - 127 + 15;
+    if (exponent <= 0) {
+        // 非规格化数，舍入后恰好等于 1 << mantissa_bits 时即为最小的规格化数
+        return static_cast<uint32_t>(std::nearbyint(std::ldexp(value, 14 + mantissa_bits)));
+    }
+    if (exponent >= 31) {
+        return max_code;
+    }
+    const int shift = 23 - mantissa_bits;
+    uint32_t code = (static_cast<uint32_t>(exponent) << mantissa_bits) | ((bits & 0x7FFFFFu) >> shift);
+    const uint32_t remainder = bits & ((1u << shift) - 1u);
+    const uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (code & 1u))) {
+        ++code;
+    }
+    return std::min(code, max_code);
+}
+
+float UnsignedSmallFloatToFloat(uint32_t bits, int mantissa_bits) {
+    const uint32_t exponent = bits >> mantissa_bits;
+    const uint32_t mantissa = bits & ((1u << mantissa_bits) - 1u);
+    if (exponent == 0) {
+        return std::ldexp(static_cast<float>(mantissa), -14 - mantissa_bits);
+    }
+    return std::ldexp(1.0f + std::ldexp(static_cast<float>(mantissa), -mantissa_bits), static_cast<int>(exponent) - 15);
+}
+
+uint32_t PackB10G11R11(const float *rgb) {
+    return FloatToUnsignedSmallFloat(rgb[0], 6) |
+        (FloatToUnsignedSmallFloat(rgb[1], 6) << 11) |
+        (FloatToUnsignedSmallFloat(rgb[2], 5) << 22);
+}
+
+void UnpackB10G11R11(uint32_t packed, float *rgb) {
+    rgb[0] = UnsignedSmallFloatToFloat(packed & 0x7FFu, 6);
+    rgb[1] = UnsignedSmallFloatToFloat((packed >> 11) & 0x7FFu, 6);
+    rgb[2] = UnsignedSmallFloatToFloat(packed >> 22, 5);
+}
+
+// 参考 EXT_texture_shared_exponent 中的编码方法
+uint32_t PackE5B9G9R9(const float *rgb) {
+    constexpr int kMantissaBits = 9;
+    constexpr int kExponentBias = 15;
+    constexpr float kSharedExpMax = 511.0f / 512.0f * 65536.0f;
+    float c[3];
+    for (int i = 0; i < 3; ++i) {
+        c[i] = rgb[i] > 0.0f ? std::min(rgb[i], kSharedExpMax) : 0.0f;
+    }
+    const float max_c = std::max(c[0], std::max(c[1], c[2]));
+    if (max_c <= 0.0f) {
+        return 0;
+    }
+    int shared_exp = std::max(-kExponentBias - 1, static_cast<int>(std::floor(std::log2(max_c)))) + 1 + kExponentBias;
+    const float max_s = std::floor(std::ldexp(max_c, kExponentBias + kMantissaBits - shared_exp) + 0.5f);
+    if (max_s >= 512.0f) {
+        ++shared_exp;
+    }
+    uint32_t packed = static_cast<uint32_t>(shared_exp) << 27;
+    for (int i = 0; i < 3; ++i) {
+        const float s = std::floor(std::ldexp(c[i], kExponentBias + kMantissaBits - shared_exp) + 0.5f);
+        packed |= std::min(static_cast<uint32_t>(s), 511u) << (9 * i);
+    }
+    return packed;
+}
+
+void UnpackE5B9G9R9(uint32_t packed, float *rgb) {
+    const int shared_exp = static_cast<int>(packed >> 27);
+    for (int i = 0; i < 3; ++i) {
+        rgb[i] = std::ldexp(static_cast<float>((packed >> (9 * i)) & 0x1FFu), shared_exp - 15 - 9);
+    }
+}
+
+uint16_t EncodeLogUnorm16(float value) {
+    if (!(value > 0.0f)) {
+        return 0xFFFF;
+    }
+    const float u = -std::log2(std::min(value, 1.0f)) / kLogEncodingMaxExponent;
+    return static_cast<uint16_t>(std::nearbyint(std::min(u, 1.0f) * 65535.0f));
+}
+
+float DecodeLogUnorm16(uint16_t encoded) {
+    return std::exp2(-static_cast<float>(encoded) / 65535.0f * kLogEncodingMaxExponent);
+}
+
+void EncodeTexels(const float *rgb, size_t count, PixelFormat format, std::vector<uint8_t> &out) {
+    assert(!IsBlockCompressed(format));
+    out.reserve(out.size() + count * GetBytesPerTexel(format));
+    for (size_t i = 0; i < count; ++i) {
+        const float *texel = rgb + i * 3;
+        switch (format) {
+        case PixelFormat::RGBA16F:
+            AppendBytes(out, FloatToHalf(texel[0]));
+            AppendBytes(out, FloatToHalf(texel[1]));
+            AppendBytes(out, FloatToHalf(texel[2]));
+            AppendBytes(out, FloatToHalf(1.0f));
+            break;
+        case PixelFormat::RGBA32F:
+            AppendBytes(out, texel[0]);
+            AppendBytes(out, texel[1]);
+            AppendBytes(out, texel[2]);
+            AppendBytes(out, 1.0f);
+            break;
+        case PixelFormat::B10G11R11F:
+            AppendBytes(out, PackB10G11R11(texel));
+            break;
+        case PixelFormat::E5B9G9R9:
+            AppendBytes(out, PackE5B9G9R9(texel));
+            break;
+        case PixelFormat::BC6H:
+            break;
+        case PixelFormat::RGBA16Log:
+            AppendBytes(out, EncodeLogUnorm16(texel[0]));
+            AppendBytes(out, EncodeLogUnorm16(texel[1]));
+            AppendBytes(out, EncodeLogUnorm16(texel[2]));
+            AppendBytes<uint16_t>(out, 0xFFFF);
+            break;
+        }
+    }
+}
+
+void DecodeTexels(const uint8_t *data, size_t count, PixelFormat format, float *rgb) {
+    assert(!IsBlockCompressed(format));
+    const int stride = GetBytesPerTexel(format);
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t *texel = data + i * stride;
+        float *result = rgb + i * 3;
+        switch (format) {
+        case PixelFormat::RGBA16F:
+            for (int c = 0; c < 3; ++c) {
+                result[c] = HalfToFloat(ReadBytes<uint16_t>(texel + c * 2));
+            }
+            break;
+        case PixelFormat::RGBA32F:
+            for (int c = 0; c < 3; ++c) {
+                result[c] = ReadBytes<float>(texel + c * 4);
+            }
+            break;
+        case PixelFormat::B10G11R11F:
+            UnpackB10G11R11(ReadBytes<uint32_t>(texel), result);
+            break;
+        case PixelFormat::E5B9G9R9:
+            UnpackE5B9G9R9(ReadBytes<uint32_t>(texel), result);
+            break;
+        case PixelFormat::BC6H:
+            break;
+        case PixelFormat::RGBA16Log:
+            for (int c = 0; c < 3; ++c) {
+                result[c] = DecodeLogUnorm16(ReadBytes<uint16_t>(texel + c * 2));
+            }
+            break;
+        }
+    }
+}
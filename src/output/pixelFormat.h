@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 输出纹理的像素格式，均可以直接上传到 GPU，不需要运行时在 CPU 端转换
+enum class PixelFormat {
+    RGBA16F,
+    RGBA32F,
+    // 对应 VK_FORMAT_B10G11R11_UFLOAT_PACK32 / DXGI_FORMAT_R11G11B10_FLOAT
+    B10G11R11F,
+    // 对应 VK_FORMAT_E5B9G9R9_UFLOAT_PACK32 / DXGI_FORMAT_R9G9B9E5_SHAREDEXP
+    E5B9G9R9,
+    // 对应 VK_FORMAT_BC6H_UFLOAT_BLOCK / DXGI_FORMAT_BC6H_UF16，4x4 像素一个 16 字节的块
+    BC6H,
+    // 对数编码的 R16G16B16A16_UNORM，u = -log2(T) / kLogEncodingMaxExponent，
+    // 在着色器中以 exp2(-u * kLogEncodingMaxExponent) 解码，低透射率处仍保持相对精度
+    RGBA16Log,
+};
+
+// 对数编码能表示的最小值为 2^-kLogEncodingMaxExponent，更小的值截断
+constexpr float kLogEncodingMaxExponent = 64.0f;
+
+// 每个像素所占的字节数，块压缩格式为每个块的字节数
+int GetBytesPerTexel(PixelFormat format);
+bool IsBlockCompressed(PixelFormat format);
+const char *GetPixelFormatName(PixelFormat format);
+bool ParsePixelFormat(const char *name, PixelFormat &format);
+
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t half);
+
+// 无符号的 11 位（6 位尾数）与 10 位（5 位尾数）小浮点数，指数偏移均为 15
+uint32_t FloatToUnsignedSmallFloat(float value, int mantissa_bits);
+float UnsignedSmallFloatToFloat(uint32_t bits, int mantissa_bits);
+
+uint32_t PackB10G11R11(const float *rgb);
+void UnpackB10G11R11(uint32_t packed, float *rgb);
+
+uint32_t PackE5B9G9R9(const float *rgb);
+void UnpackE5B9G9R9(uint32_t packed, float *rgb);
+
+uint16_t EncodeLogUnorm16(float value);
+float DecodeLogUnorm16(uint16_t encoded);
+
+// 将 count 个 RGB float 像素编码为指定格式，RGBA 格式的 alpha 固定为 1，不支持块压缩格式
+void EncodeTexels(const float *rgb, size_t count, PixelFormat format, std::vector<uint8_t> &out);
+// 将编码后的像素解码回 RGB float，用于误差统计
+void DecodeTexels(const uint8_t *data, size_t count, PixelFormat format, float *rgb);
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// 纹理在 GPU 上的维度
+enum class TextureDimension {
+    Texture2D,
+    Texture2DArray,
+    Texture3D,
+};
+
+// 以 RGB float 存储的烘焙结果，按 x、y、z（或数组层）的顺序排列
+struct TextureImage {
+    int width = 0;
+    int height = 0;
+    // 3D 纹理的深度，或纹理数组的层数
+    int depth = 1;
+    TextureDimension dimension = TextureDimension::Texture2D;
+    std::vector<float> texels;
+
+    TextureImage() = default;
+
+    TextureImage(int width, int height, int depth = 1, TextureDimension dimension = TextureDimension::Texture2D) :
+        width(width), height(height), depth(depth), dimension(dimension),
+        texels(static_cast<size_t>(width) * height * depth * 3, 0.0f) {}
+
+    size_t GetTexelCount() const {
+        return static_cast<size_t>(width) * height * depth;
+    }
+
+    float *GetTexel(int x, int y, int z = 0) {
+        return texels.data() + ((static_cast<size_t>(z) * height + y) * width + x) * 3;
+    }
+
+    const float *GetTexel(int x, int y, int z = 0) const {
+        return texels.data() + ((static_cast<size_t>(z) * height + y) * width + x) * 3;
+    }
+};
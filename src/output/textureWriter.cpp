@@ -0,0 +1,346 @@
+#include "textureWriter.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+// 各像素格式在 Vulkan 与 DXGI 中对应的枚举值及 KTX2 所需的信息
+struct FormatInfo {
+    uint32_t vk_format;
+    uint32_t dxgi_format;
+    // KTX2 的 typeSize，即字节序转换的单位
+    uint32_t type_size;
+};
+
+FormatInfo GetFormatInfo(PixelFormat format) {
+    switch (format) {
+    case PixelFormat::RGBA16F: return { 97, 10, 2 };
+    case PixelFormat::RGBA32F: return { 109, 2, 4 };
+    case PixelFormat::B10G11R11F: return { 122, 26, 4 };
+    case PixelFormat::E5B9G9R9: return { 123, 67, 4 };
+    case PixelFormat::BC6H: return { 143, 95, 1 };
+    case PixelFormat::RGBA16Log: return { 91, 11, 2 };
+    }
+    return { 0, 0, 1 };
+}
+
+template<class T>
+void Append(std::vector<uint8_t> &out, T value) {
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template<class T>
+void Overwrite(std::vector<uint8_t> &out, size_t offset, T value) {
+    std::memcpy(out.data() + offset, &value, sizeof(T));
+}
+
+void PadTo(std::vector<uint8_t> &out, size_t alignment) {
+    while (out.size() % alignment != 0) {
+        out.push_back(0);
+    }
+}
+
+// 编码 3D 纹理的一个切片或纹理数组的一层
+std::vector<uint8_t> EncodeSlice(const TextureImage &image, int z, PixelFormat format, BC6HQuality quality) {
+    if (format == PixelFormat::BC6H) {
+        return CompressBC6H(image.GetTexel(0, 0, z), image.width, image.height, quality);
+    }
+    std::vector<uint8_t> bytes;
+    EncodeTexels(image.GetTexel(0, 0, z), static_cast<size_t>(image.width) * image.height, format, bytes);
+    return bytes;
+}
+
+std::vector<uint8_t> EncodeLevel(const TextureImage &image, PixelFormat format, BC6HQuality quality) {
+    std::vector<uint8_t> bytes;
+    for (int z = 0; z < image.depth; ++z) {
+        const std::vector<uint8_t> slice = EncodeSlice(image, z, format, quality);
+        bytes.insert(bytes.end(), slice.begin(), slice.end());
+    }
+    return bytes;
+}
+
+// Khronos Data Format 中的一个 sample
+struct DfdSample {
+    uint16_t bit_offset;
+    uint8_t bit_length;
+    uint8_t channel_type;
+    uint32_t lower;
+    uint32_t upper;
+};
+
+// 生成 KTX2 必需的 Basic Data Format Descriptor
+std::vector<uint8_t> BuildDataFormatDescriptor(PixelFormat format) {
+    constexpr uint8_t kChannelAlpha = 15;
+    constexpr uint8_t kQualifierFloat = 0x80;
+    constexpr uint8_t kQualifierSigned = 0x40;
+    constexpr uint8_t kQualifierExponent = 0x20;
+    constexpr uint32_t kFloatMinusOne = 0xBF800000u;
+    constexpr uint32_t kFloatOne = 0x3F800000u;
+    constexpr uint8_t kColorModelRGBSDA = 1;
+    constexpr uint8_t kColorModelBC6H = 131;
+
+    std::vector<DfdSample> samples;
+    const uint8_t signed_float = kQualifierFloat | kQualifierSigned;
+    switch (format) {
+    case PixelFormat::RGBA16F:
+    case PixelFormat::RGBA32F: {
+        const uint16_t bits = format == PixelFormat::RGBA16F ? 16 : 32;
+        const uint8_t channels[4] = { 0, 1, 2, kChannelAlpha };
+        for (int i = 0; i < 4; ++i) {
+            samples.push_back({ static_cast<uint16_t>(bits * i), static_cast<uint8_t>(bits - 1),
+                static_cast<uint8_t>(channels[i] | signed_float), kFloatMinusOne, kFloatOne });
+        }
+        break;
+    }
+    case PixelFormat::B10G11R11F:
+        samples.push_back({ 0, 10, kQualifierFloat | 0, 0, kFloatOne });
+        samples.push_back({ 11, 10, kQualifierFloat | 1, 0, kFloatOne });
+        samples.push_back({ 22, 9, kQualifierFloat | 2, 0, kFloatOne });
+        break;
+    case PixelFormat::E5B9G9R9:
+        for (uint8_t channel = 0; channel < 3; ++channel) {
+            // 尾数的 upper 为 1.0 对应的编码，指数的 lower/upper 为偏移与最大值
+            samples.push_back({ static_cast<uint16_t>(9 * channel), 8, channel, 0, 8448 });
+            samples.push_back({ 27, 4, static_cast<uint8_t>(channel | kQualifierExponent), 15, 31 });
+        }
+        break;
+    case PixelFormat::RGBA16Log: {
+        const uint8_t channels[4] = { 0, 1, 2, kChannelAlpha };
+        for (int i = 0; i < 4; ++i) {
+            samples.push_back({ static_cast<uint16_t>(16 * i), 15, channels[i], 0, 0xFFFF });
+        }
+        break;
+    }
+    case PixelFormat::BC6H:
+        // 整个 128 位的块作为一个 sample
+        samples.push_back({ 0, 127, kQualifierFloat, 0, kFloatOne });
+        break;
+    }
+    const bool block_compressed = IsBlockCompressed(format);
+
+    const uint16_t block_size = static_cast<uint16_t>(24 + 16 * samples.size());
+    std::vector<uint8_t> dfd;
+    Append<uint32_t>(dfd, 4u + block_size);
+    // vendorId = KHRONOS, descriptorType = BASICFORMAT
+    Append<uint32_t>(dfd, 0);
+    // versionNumber = KDF 1.3
+    Append<uint16_t>(dfd, 2);
+    Append<uint16_t>(dfd, block_size);
+    // colorModel, colorPrimaries = BT709, transferFunction = LINEAR, flags = ALPHA_STRAIGHT
+    Append<uint8_t>(dfd, block_compressed ? kColorModelBC6H : kColorModelRGBSDA);
+    Append<uint8_t>(dfd, 1);
+    Append<uint8_t>(dfd, 1);
+    Append<uint8_t>(dfd, 0);
+    // texelBlockDimension0..3，存储的是尺寸减 1
+    Append<uint8_t>(dfd, block_compressed ? 3 : 0);
+    Append<uint8_t>(dfd, block_compressed ? 3 : 0);
+    Append<uint8_t>(dfd, 0);
+    Append<uint8_t>(dfd, 0);
+    // bytesPlane0..7
+    Append<uint8_t>(dfd, static_cast<uint8_t>(GetBytesPerTexel(format)));
+    for (int i = 0; i < 7; ++i) {
+        Append<uint8_t>(dfd, 0);
+    }
+    for (const DfdSample &sample : samples) {
+        Append<uint16_t>(dfd, sample.bit_offset);
+        Append<uint8_t>(dfd, sample.bit_length);
+        Append<uint8_t>(dfd, sample.channel_type);
+        Append<uint32_t>(dfd, 0);
+        Append<uint32_t>(dfd, sample.lower);
+        Append<uint32_t>(dfd, sample.upper);
+    }
+    return dfd;
+}
+
+void AppendKeyValue(std::vector<uint8_t> &kvd, const std::string &key, const std::string &value) {
+    Append<uint32_t>(kvd, static_cast<uint32_t>(key.size() + value.size() + 2));
+    kvd.insert(kvd.end(), key.begin(), key.end());
+    kvd.push_back(0);
+    kvd.insert(kvd.end(), value.begin(), value.end());
+    kvd.push_back(0);
+    PadTo(kvd, 4);
+}
+
+bool WriteFile(const std::string &path, const std::vector<uint8_t> &bytes) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to open " << path << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(file);
+}
+
+} // namespace
+
+std::vector<TextureImage> GenerateMipChain(const TextureImage &image, int level_count) {
+    std::vector<TextureImage> mips{ image };
+    const bool downsample_z = image.dimension == TextureDimension::Texture3D;
+    while (level_count <= 0 || static_cast<int>(mips.size()) < level_count) {
+        const TextureImage &src = mips.back();
+        if (src.width == 1 && src.height == 1 && (!downsample_z || src.depth == 1)) {
+            break;
+        }
+        TextureImage dst(std::max(src.width / 2, 1), std::max(src.height / 2, 1),
+            downsample_z ? std::max(src.depth / 2, 1) : src.depth, src.dimension);
+        for (int z = 0; z < dst.depth; ++z) {
+            // 奇数尺寸时最后一个像素与自身取平均
+            const int z0 = downsample_z ? std::min(2 * z, src.depth - 1) : z;
+            const int z1 = downsample_z ? std::min(2 * z + 1, src.depth - 1) : z;
+            for (int y = 0; y < dst.height; ++y) {
+                const int y0 = std::min(2 * y, src.height - 1);
+                const int y1 = std::min(2 * y + 1, src.height - 1);
+                for (int x = 0; x < dst.width; ++x) {
+                    const int x0 = std::min(2 * x, src.width - 1);
+                    const int x1 = std::min(2 * x + 1, src.width - 1);
+                    float *result = dst.GetTexel(x, y, z);
+                    for (int c = 0; c < 3; ++c) {
+                        result[c] = 0.125f * (
+                            src.GetTexel(x0, y0, z0)[c] + src.GetTexel(x1, y0, z0)[c] +
+                            src.GetTexel(x0, y1, z0)[c] + src.GetTexel(x1, y1, z0)[c] +
+                            src.GetTexel(x0, y0, z1)[c] + src.GetTexel(x1, y0, z1)[c] +
+                            src.GetTexel(x0, y1, z1)[c] + src.GetTexel(x1, y1, z1)[c]);
+                    }
+                }
+            }
+        }
+        mips.push_back(std::move(dst));
+    }
+    return mips;
+}
+
+bool WriteKTX2(const std::string &path, const std::vector<TextureImage> &mips, PixelFormat format, BC6HQuality quality) {
+    assert(!mips.empty());
+    const TextureImage &base = mips.front();
+    const FormatInfo info = GetFormatInfo(format);
+    const uint32_t level_count = static_cast<uint32_t>(mips.size());
+
+    std::vector<uint8_t> file;
+    const uint8_t identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+    file.insert(file.end(), identifier, identifier + 12);
+    Append<uint32_t>(file, info.vk_format);
+    Append<uint32_t>(file, info.type_size);
+    Append<uint32_t>(file, static_cast<uint32_t>(base.width));
+    Append<uint32_t>(file, static_cast<uint32_t>(base.height));
+    Append<uint32_t>(file, base.dimension == TextureDimension::Texture3D ? static_cast<uint32_t>(base.depth) : 0u);
+    Append<uint32_t>(file, base.dimension == TextureDimension::Texture2DArray ? static_cast<uint32_t>(base.depth) : 0u);
+    // faceCount
+    Append<uint32_t>(file, 1);
+    Append<uint32_t>(file, level_count);
+    // supercompressionScheme
+    Append<uint32_t>(file, 0);
+
+    // dfd、kvd 与 sgd 的索引，在写入后回填
+    const size_t index_offset = file.size();
+    for (int i = 0; i < 4; ++i) {
+        Append<uint32_t>(file, 0);
+    }
+    Append<uint64_t>(file, 0);
+    Append<uint64_t>(file, 0);
+
+    const size_t level_index_offset = file.size();
+    for (uint32_t i = 0; i < level_count * 3; ++i) {
+        Append<uint64_t>(file, 0);
+    }
+
+    const std::vector<uint8_t> dfd = BuildDataFormatDescriptor(format);
+    Overwrite<uint32_t>(file, index_offset, static_cast<uint32_t>(file.size()));
+    Overwrite<uint32_t>(file, index_offset + 4, static_cast<uint32_t>(dfd.size()));
+    file.insert(file.end(), dfd.begin(), dfd.end());
+
+    std::vector<uint8_t> kvd;
+    AppendKeyValue(kvd, "KTXwriter", "PrecomputedAtmosphereTexture");
+    if (format == PixelFormat::RGBA16Log) {
+        AppendKeyValue(kvd, "PATLogEncodingMaxExponent", std::to_string(kLogEncodingMaxExponent));
+    }
+    Overwrite<uint32_t>(file, index_offset + 8, static_cast<uint32_t>(file.size()));
+    Overwrite<uint32_t>(file, index_offset + 12, static_cast<uint32_t>(kvd.size()));
+    file.insert(file.end(), kvd.begin(), kvd.end());
+
+    // mip 数据按从小到大的顺序存放，每级对齐到 lcm(texel size, 4)
+    const size_t alignment = std::max<size_t>(GetBytesPerTexel(format), 4);
+    for (int level = static_cast<int>(level_count) - 1; level >= 0; --level) {
+        PadTo(file, alignment);
+        const std::vector<uint8_t> bytes = EncodeLevel(mips[level], format, quality);
+        const size_t entry = level_index_offset + static_cast<size_t>(level) * 24;
+        Overwrite<uint64_t>(file, entry, static_cast<uint64_t>(file.size()));
+        Overwrite<uint64_t>(file, entry + 8, static_cast<uint64_t>(bytes.size()));
+        Overwrite<uint64_t>(file, entry + 16, static_cast<uint64_t>(bytes.size()));
+        file.insert(file.end(), bytes.begin(), bytes.end());
+    }
+    return WriteFile(path, file);
+}
+
+bool WriteDDS(const std::string &path, const std::vector<TextureImage> &mips, PixelFormat format, BC6HQuality quality) {
+    assert(!mips.empty());
+    const TextureImage &base = mips.front();
+    const FormatInfo info = GetFormatInfo(format);
+    const bool is_volume = base.dimension == TextureDimension::Texture3D;
+    const uint32_t mip_count = static_cast<uint32_t>(mips.size());
+
+    constexpr uint32_t DDSD_CAPS = 0x1, DDSD_HEIGHT = 0x2, DDSD_WIDTH = 0x4, DDSD_PITCH = 0x8;
+    constexpr uint32_t DDSD_PIXELFORMAT = 0x1000, DDSD_MIPMAPCOUNT = 0x20000, DDSD_LINEARSIZE = 0x80000, DDSD_DEPTH = 0x800000;
+    constexpr uint32_t DDSCAPS_COMPLEX = 0x8, DDSCAPS_TEXTURE = 0x1000, DDSCAPS_MIPMAP = 0x400000;
+    constexpr uint32_t DDSCAPS2_VOLUME = 0x200000;
+    constexpr uint32_t DDPF_FOURCC = 0x4;
+
+    std::vector<uint8_t> file;
+    Append<uint32_t>(file, 0x20534444u); // "DDS "
+    // DDS_HEADER
+    Append<uint32_t>(file, 124);
+    // 块压缩格式记录第 0 级一个切片的字节数，其他格式记录行跨度
+    const bool block_compressed = IsBlockCompressed(format);
+    const uint32_t pitch_or_linear_size = block_compressed ?
+        static_cast<uint32_t>(((base.width + 3) / 4) * ((base.height + 3) / 4) * GetBytesPerTexel(format)) :
+        static_cast<uint32_t>(base.width * GetBytesPerTexel(format));
+    Append<uint32_t>(file, DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT |
+        (block_compressed ? DDSD_LINEARSIZE : DDSD_PITCH) | (is_volume ? DDSD_DEPTH : 0));
+    Append<uint32_t>(file, static_cast<uint32_t>(base.height));
+    Append<uint32_t>(file, static_cast<uint32_t>(base.width));
+    Append<uint32_t>(file, pitch_or_linear_size);
+    Append<uint32_t>(file, is_volume ? static_cast<uint32_t>(base.depth) : 0u);
+    Append<uint32_t>(file, mip_count);
+    for (int i = 0; i < 11; ++i) {
+        Append<uint32_t>(file, 0);
+    }
+    // DDS_PIXELFORMAT，实际格式由 DX10 扩展头描述
+    Append<uint32_t>(file, 32);
+    Append<uint32_t>(file, DDPF_FOURCC);
+    Append<uint32_t>(file, 0x30315844u); // "DX10"
+    for (int i = 0; i < 5; ++i) {
+        Append<uint32_t>(file, 0);
+    }
+    Append<uint32_t>(file, DDSCAPS_TEXTURE | (mip_count > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0) | (is_volume ? DDSCAPS_COMPLEX : 0));
+    Append<uint32_t>(file, is_volume ? DDSCAPS2_VOLUME : 0u);
+    for (int i = 0; i < 3; ++i) {
+        Append<uint32_t>(file, 0);
+    }
+    // DDS_HEADER_DXT10，resourceDimension 3 为 TEXTURE2D，4 为 TEXTURE3D
+    Append<uint32_t>(file, info.dxgi_format);
+    Append<uint32_t>(file, is_volume ? 4u : 3u);
+    Append<uint32_t>(file, 0);
+    Append<uint32_t>(file, is_volume ? 1u : static_cast<uint32_t>(base.depth));
+    Append<uint32_t>(file, 0);
+
+    // 3D 纹理按 mip 依次存放所有切片，纹理数组按层依次存放所有 mip
+    if (is_volume) {
+        for (const TextureImage &mip : mips) {
+            const std::vector<uint8_t> bytes = EncodeLevel(mip, format, quality);
+            file.insert(file.end(), bytes.begin(), bytes.end());
+        }
+    } else {
+        for (int layer = 0; layer < base.depth; ++layer) {
+            for (const TextureImage &mip : mips) {
+                const std::vector<uint8_t> bytes = EncodeSlice(mip, layer, format, quality);
+                file.insert(file.end(), bytes.begin(), bytes.end());
+            }
+        }
+    }
+    return WriteFile(path, file);
+}
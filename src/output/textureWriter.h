@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "bc6h.h"
+#include "pixelFormat.h"
+#include "texture.h"
+
+// 生成 mip 链，第 0 级为原图，level_count 为 0 时生成完整的 mip 链
+// 2D 与纹理数组只在 x、y 方向上降采样，3D 纹理同时在 z 方向上降采样
+std::vector<TextureImage> GenerateMipChain(const TextureImage &image, int level_count);
+
+// 写出 KTX2 文件（无超压缩），mips 为 GenerateMipChain 的结果，quality 只对 BC6H 有效
+bool WriteKTX2(const std::string &path, const std::vector<TextureImage> &mips, PixelFormat format,
+    BC6HQuality quality = BC6HQuality::Normal);
+
+// 写出带有 DX10 扩展头的 DDS 文件
+bool WriteDDS(const std::string &path, const std::vector<TextureImage> &mips, PixelFormat format,
+    BC6HQuality quality = BC6HQuality::Normal);
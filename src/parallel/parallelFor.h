@@ -0,0 +1,34 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// 实际使用的线程数，thread_count 小于等于 0 时使用硬件线程数
+inline int ResolveThreadCount(int thread_count) {
+    if (thread_count > 0) {
+        return thread_count;
+    }
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+// 在多个线程上对 [0, count) 中的每个下标调用 function，下标按原子计数动态分配
+template<class Function>
+void ParallelFor(int count, int thread_count, Function function) {
+    thread_count = std::min(ResolveThreadCount(thread_count), std::max(count, 1));
+    std::atomic<int> next{ 0 };
+    auto worker = [&]() {
+        for (int i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+            function(i);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 1; i < thread_count; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
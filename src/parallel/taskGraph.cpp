@@ -0,0 +1,152 @@
+#include "taskGraph.h"
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "parallelFor.h"
+
+namespace {
+
+// 每个线程的任务队列，任务数量与 tile 数同量级，使用互斥锁即可
+struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<TaskGraph::TaskId> tasks;
+
+    void Push(TaskGraph::TaskId task) {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(task);
+    }
+
+    // 所有者从尾部取出最近放入的任务
+    bool Pop(TaskGraph::TaskId &task) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tasks.empty()) {
+            return false;
+        }
+        task = tasks.back();
+        tasks.pop_back();
+        return true;
+    }
+
+    // 其他线程从头部窃取最早放入的任务
+    bool Steal(TaskGraph::TaskId &task) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tasks.empty()) {
+            return false;
+        }
+        task = tasks.front();
+        tasks.pop_front();
+        return true;
+    }
+};
+
+} // namespace
+
+TaskGraph::TaskId TaskGraph::AddTask(std::function<void()> function, const std::vector<TaskId> &dependencies) {
+    const TaskId id = static_cast<TaskId>(tasks_.size());
+    for (TaskId dependency : dependencies) {
+        assert(dependency >= 0 && dependency < id);
+        tasks_[dependency].dependents.push_back(id);
+    }
+    tasks_.push_back(Task{ std::move(function), static_cast<int>(dependencies.size()), {} });
+    return id;
+}
+
+void TaskGraph::Run(int thread_count) {
+    const int task_count = GetTaskCount();
+    if (task_count == 0) {
+        return;
+    }
+    thread_count = std::min(ResolveThreadCount(thread_count), task_count);
+    std::unique_ptr<std::atomic<int>[]> remaining(new std::atomic<int>[task_count]);
+    std::vector<WorkerQueue> queues(thread_count);
+    int next_queue = 0;
+    for (TaskId id = 0; id < task_count; ++id) {
+        remaining[id].store(tasks_[id].dependency_count);
+        // 没有依赖的任务轮流分配给各线程
+        if (tasks_[id].dependency_count == 0) {
+            queues[next_queue].Push(id);
+            next_queue = (next_queue + 1) % thread_count;
+        }
+    }
+    std::atomic<int> unfinished{ task_count };
+    // 任务抛出异常后不再开始新的任务，第一个异常在调用线程上重新抛出
+    std::atomic<bool> cancelled{ false };
+    std::exception_ptr exception;
+    // 空闲的线程在 wake 上等待；放入任务、全部完成或取消时在 wake_mutex 下增加 wake_epoch 并通知
+    // 等待前先读取 wake_epoch 再查找任务，查找之后放入的任务一定会改变 wake_epoch，不会漏掉唤醒
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    std::atomic<uint64_t> wake_epoch{ 0 };
+    auto notify = [&](bool all) {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            wake_epoch.fetch_add(1, std::memory_order_release);
+        }
+        if (all) {
+            wake.notify_all();
+        } else {
+            wake.notify_one();
+        }
+    };
+    auto running = [&]() {
+        return unfinished.load(std::memory_order_acquire) > 0 && !cancelled.load(std::memory_order_acquire);
+    };
+    auto worker = [&](int index) {
+        while (running()) {
+            const uint64_t epoch = wake_epoch.load(std::memory_order_acquire);
+            TaskId task = -1;
+            bool found = queues[index].Pop(task);
+            for (int i = 1; !found && i < thread_count; ++i) {
+                found = queues[(index + i) % thread_count].Steal(task);
+            }
+            if (!found) {
+                std::unique_lock<std::mutex> lock(wake_mutex);
+                wake.wait(lock, [&]() {
+                    return wake_epoch.load(std::memory_order_acquire) != epoch || !running();
+                });
+                continue;
+            }
+            try {
+                tasks_[task].function();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(wake_mutex);
+                if (!cancelled.load(std::memory_order_relaxed)) {
+                    exception = std::current_exception();
+                    cancelled.store(true, std::memory_order_release);
+                }
+            }
+            if (cancelled.load(std::memory_order_acquire)) {
+                notify(true);
+                break;
+            }
+            for (TaskId dependent : tasks_[task].dependents) {
+                if (remaining[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    queues[index].Push(dependent);
+                    notify(false);
+                }
+            }
+            if (unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                notify(true);
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 1; i < thread_count; ++i) {
+        threads.emplace_back(worker, i);
+    }
+    worker(0);
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+}
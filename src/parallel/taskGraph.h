@@ -0,0 +1,45 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+// 带依赖的任务图，在多个线程上以工作窃取的方式执行：
+// 每个线程从自己队列的尾部取任务，队列为空时从其他线程队列的头部窃取；
+// 任务完成后，依赖全部完成的后继任务放入完成它的线程的队列，因此后继任务通常在读取的数据仍在缓存中时开始，
+// 不同阶段之间不需要等待整个阶段结束
+// 任务只写自己的输出、只读依赖的输出时，结果与线程数及执行顺序无关
+class TaskGraph {
+public:
+    using TaskId = int;
+
+    // dependencies 只能是之前添加的任务，因此任务图总是无环的
+    TaskId AddTask(std::function<void()> function, const std::vector<TaskId> &dependencies = {});
+
+    // 在 thread_count 个线程上执行所有任务并等待完成，thread_count 小于等于 0 时使用硬件线程数
+    // 空闲的线程阻塞等待新的任务；某个任务抛出异常时其余未开始的任务被取消，异常在所有线程结束后由 Run 抛出
+    void Run(int thread_count);
+
+    int GetTaskCount() const {
+        return static_cast<int>(tasks_.size());
+    }
+
+private:
+    struct Task {
+        std::function<void()> function;
+        int dependency_count;
+        std::vector<TaskId> dependents;
+    };
+
+    std::vector<Task> tasks_;
+};
+
+// 把 [0, count) 的每个下标作为一个没有依赖的任务在 TaskGraph 上执行，用于阶段内没有依赖的烘焙与压缩，
+// 与 sweep 使用同一个调度器，任务抛出的异常由调用线程抛出
+template<class Function>
+void RunTaskRange(int count, int thread_count, const Function &function) {
+    TaskGraph graph;
+    for (int i = 0; i < count; ++i) {
+        graph.AddTask([&function, i]() { function(i); });
+    }
+    graph.Run(thread_count);
+}
@@ -0,0 +1,198 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace trace_detail {
+
+std::atomic<bool> g_enabled{ false };
+std::atomic<bool> g_counting{ false };
+
+} // namespace trace_detail
+
+namespace {
+
+constexpr int kCounterCount = static_cast<int>(TraceCounter::Count);
+
+struct TraceEvent {
+    const char *name;
+    double begin;
+    double end;
+    // 区间开始与结束时该线程的计数
+    uint64_t begin_counts[kCounterCount];
+    uint64_t end_counts[kCounterCount];
+};
+
+// 每个线程只写自己的状态，WriteTrace 在所有线程结束后读取
+struct ThreadState {
+    int tid = 0;
+    uint64_t counts[kCounterCount] = {};
+    std::vector<TraceEvent> events;
+    // 尚未结束的区间，在 events 中的下标
+    std::vector<size_t> open_events;
+};
+
+std::mutex g_mutex;
+// 线程结束后状态仍然保留到 WriteTrace
+std::vector<std::unique_ptr<ThreadState>> g_threads;
+std::chrono::steady_clock::time_point g_start;
+thread_local ThreadState *t_state = nullptr;
+
+double Now() {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - g_start).count();
+}
+
+ThreadState &GetThreadState() {
+    if (!t_state) {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_threads.push_back(std::make_unique<ThreadState>());
+        t_state = g_threads.back().get();
+        t_state->tid = static_cast<int>(g_threads.size()) - 1;
+    }
+    return *t_state;
+}
+
+void WriteCounts(std::ostream &stream, const uint64_t *counts, const uint64_t *base) {
+    bool first = true;
+    for (int i = 0; i < kCounterCount; ++i) {
+        const uint64_t value = counts[i] - (base ? base[i] : 0);
+        if (base && value == 0) {
+            continue;
+        }
+        stream << (first ? "" : ", ") << "\"" << GetTraceCounterName(static_cast<TraceCounter>(i)) << "\": " << value;
+        first = false;
+    }
+}
+
+} // namespace
+
+const char *GetTraceCounterName(TraceCounter counter) {
+    switch (counter) {
+    case TraceCounter::Samples: return "samples";
+    case TraceCounter::ExpCalls: return "exp_calls";
+    case TraceCounter::Texels: return "texels";
+    case TraceCounter::BytesWritten: return "bytes_written";
+    default: return "unknown";
+    }
+}
+
+namespace trace_detail {
+
+void AddCount(TraceCounter counter, uint64_t value) {
+    GetThreadState().counts[static_cast<int>(counter)] += value;
+}
+
+void BeginScope(const char *name) {
+    ThreadState &state = GetThreadState();
+    TraceEvent event;
+    event.name = name;
+    event.begin = Now();
+    event.end = event.begin;
+    std::copy(state.counts, state.counts + kCounterCount, event.begin_counts);
+    std::copy(state.counts, state.counts + kCounterCount, event.end_counts);
+    state.open_events.push_back(state.events.size());
+    state.events.push_back(event);
+}
+
+void EndScope() {
+    ThreadState &state = GetThreadState();
+    if (state.open_events.empty()) {
+        return;
+    }
+    TraceEvent &event = state.events[state.open_events.back()];
+    state.open_events.pop_back();
+    event.end = Now();
+    std::copy(state.counts, state.counts + kCounterCount, event.end_counts);
+}
+
+} // namespace trace_detail
+
+void StartTrace() {
+    g_start = std::chrono::steady_clock::now();
+    GetThreadState();
+    trace_detail::g_counting.store(true);
+    trace_detail::g_enabled.store(true);
+}
+
+void StartTraceCounters() {
+    trace_detail::g_counting.store(true);
+}
+
+uint64_t GetTraceCount(TraceCounter counter) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    uint64_t sum = 0;
+    for (const auto &state : g_threads) {
+        sum += state->counts[static_cast<int>(counter)];
+    }
+    return sum;
+}
+
+uint64_t GetThreadTraceCount(TraceCounter counter) {
+    return GetThreadState().counts[static_cast<int>(counter)];
+}
+
+bool WriteTrace(const std::string &path) {
+    trace_detail::g_enabled.store(false);
+    trace_detail::g_counting.store(false);
+    std::lock_guard<std::mutex> lock(g_mutex);
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "Failed to open " << path << std::endl;
+        return false;
+    }
+    char number[64];
+    auto format_time = [&](double microseconds) {
+        std::snprintf(number, sizeof(number), "%.3f", microseconds);
+        return number;
+    };
+    file << "{ \"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    for (const auto &state : g_threads) {
+        file << "  { \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << state->tid
+            << ", \"args\": { \"name\": \"" << (state->tid == 0 ? "main" : "worker " + std::to_string(state->tid)) << "\" } },\n";
+        file << "  { \"name\": \"thread_sort_index\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << state->tid
+            << ", \"args\": { \"sort_index\": " << state->tid << " } },\n";
+    }
+    // 各线程在区间结束时的计数，按时间合并为所有线程的计数之和
+    struct CounterSample {
+        double time;
+        int thread;
+        const uint64_t *counts;
+    };
+    std::vector<CounterSample> samples;
+    for (size_t i = 0; i < g_threads.size(); ++i) {
+        for (const TraceEvent &event : g_threads[i]->events) {
+            file << "  { \"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << g_threads[i]->tid
+                << ", \"ts\": " << format_time(event.begin);
+            file << ", \"dur\": " << format_time(event.end - event.begin) << ", \"args\": { ";
+            WriteCounts(file, event.end_counts, event.begin_counts);
+            file << " } },\n";
+            samples.push_back(CounterSample{ event.end, static_cast<int>(i), event.end_counts });
+        }
+    }
+    std::sort(samples.begin(), samples.end(), [](const CounterSample &a, const CounterSample &b) {
+        return a.time < b.time;
+    });
+    std::vector<const uint64_t *> latest(g_threads.size(), nullptr);
+    for (const CounterSample &sample : samples) {
+        latest[sample.thread] = sample.counts;
+        uint64_t totals[kCounterCount] = {};
+        for (const uint64_t *counts : latest) {
+            for (int i = 0; counts && i < kCounterCount; ++i) {
+                totals[i] += counts[i];
+            }
+        }
+        file << "  { \"name\": \"counters\", \"ph\": \"C\", \"pid\": 1, \"ts\": " << format_time(sample.time) << ", \"args\": { ";
+        WriteCounts(file, totals, nullptr);
+        file << " } },\n";
+    }
+    // 最后一个事件之后不能有逗号
+    file << "  { \"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": { \"name\": \"Transmittance\" } }\n";
+    file << "] }\n";
+    return static_cast<bool>(file);
+}
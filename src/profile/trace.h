@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// 烘焙各阶段的计时与计数，结果写为 Chrome trace_event 格式的 JSON，可以在 chrome://tracing 或 Perfetto 中打开
+// 未调用 StartTrace 时每个计时区间与计数只有一次原子变量的读取；定义 TRANSMITTANCE_TRACE 为 0 时完全去掉
+#ifndef TRANSMITTANCE_TRACE
+#define TRANSMITTANCE_TRACE 1
+#endif
+
+enum class TraceCounter {
+    // 积分的采样点数
+    Samples,
+    // 密度分布在各采样点求值时的 exp、对数线性积分的 expm1 与由光学距离得到透射率的 exp
+    ExpCalls,
+    Texels,
+    BytesWritten,
+    Count
+};
+
+const char *GetTraceCounterName(TraceCounter counter);
+
+namespace trace_detail {
+
+extern std::atomic<bool> g_enabled;
+extern std::atomic<bool> g_counting;
+
+void AddCount(TraceCounter counter, uint64_t value);
+void BeginScope(const char *name);
+void EndScope();
+
+} // namespace trace_detail
+
+inline bool IsTraceEnabled() {
+    return trace_detail::g_enabled.load(std::memory_order_relaxed);
+}
+
+inline bool IsTraceCounting() {
+    return trace_detail::g_counting.load(std::memory_order_relaxed);
+}
+
+inline void AddTraceCount(TraceCounter counter, uint64_t value) {
+    if (IsTraceCounting()) {
+        trace_detail::AddCount(counter, value);
+    }
+}
+
+// 在当前线程的轨道上记录一个区间，name 必须是字符串常量
+class TraceScope {
+public:
+    explicit TraceScope(const char *name) : active_(IsTraceEnabled()) {
+        if (active_) {
+            trace_detail::BeginScope(name);
+        }
+    }
+
+    ~TraceScope() {
+        if (active_) {
+            trace_detail::EndScope();
+        }
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    bool active_;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+#if TRANSMITTANCE_TRACE
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#define TRACE_COUNT(counter, value) AddTraceCount(TraceCounter::counter, static_cast<uint64_t>(value))
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_COUNT(counter, value) ((void)0)
+#endif
+
+// 开始记录，调用线程的轨道命名为 main，之后创建的线程各自一条轨道
+void StartTrace();
+
+// 停止记录并写出 JSON：每个区间为一个完整事件，参数中包含区间内该线程的计数；
+// 所有线程的计数之和作为计数器轨道，在每个区间结束时更新
+bool WriteTrace(const std::string &path);
+
+// 只统计计数而不记录区间，例如在 BakeTransmittanceWithKernel 中统计每个纹素的采样数
+void StartTraceCounters();
+
+// 所有线程的计数之和
+uint64_t GetTraceCount(TraceCounter counter);
+
+// 调用线程的计数
+uint64_t GetThreadTraceCount(TraceCounter counter);
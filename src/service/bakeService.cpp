@@ -0,0 +1,166 @@
+#include "bakeService.h"
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+#include "functions/bake.h"
+
+namespace {
+
+void AppendValue(std::string &key, double value) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%a,", value);
+    key += text;
+}
+
+void AppendValue(std::string &key, const Vec3d &value) {
+    AppendValue(key, value.x);
+    AppendValue(key, value.y);
+    AppendValue(key, value.z);
+}
+
+void AppendProfile(std::string &key, const ExtendedDensityProfile &profile) {
+    key += "layers:";
+    for (const DensityProfileLayer &layer : profile.layers) {
+        for (double value : { layer.width, layer.exp_term, layer.exp_scale, layer.linear_term, layer.constant_term }) {
+            AppendValue(key, value);
+        }
+    }
+    key += "table:";
+    for (size_t i = 0; i < profile.table.altitudes.size(); ++i) {
+        AppendValue(key, profile.table.altitudes[i]);
+        AppendValue(key, profile.table.densities[i]);
+    }
+    key += ";";
+}
+
+} // namespace
+
+std::string GetBakeServiceKey(const BakeServiceInputs &inputs) {
+    const AtmosphereParameters &atmosphere = inputs.atmosphere;
+    std::string key = std::to_string(inputs.width) + "x" + std::to_string(inputs.height) + ";" +
+        GetIntegrationModeName(inputs.settings.mode) + "/" + std::to_string(inputs.settings.sample_count) +
+        (inputs.settings.density_table ? "/table" : "") + (inputs.float_kernel ? "/float;" : "/double;");
+    // 透射率只与半径、消光系数与密度分布有关，其余参数不影响烘焙结果
+    AppendValue(key, atmosphere.bottom_radius);
+    AppendValue(key, atmosphere.top_radius);
+    AppendValue(key, atmosphere.rayleigh_scattering);
+    AppendValue(key, atmosphere.mie_extinction);
+    AppendValue(key, atmosphere.absorption_extinction);
+    key += ";";
+    AppendProfile(key, inputs.profiles.rayleigh);
+    AppendProfile(key, inputs.profiles.mie);
+    AppendProfile(key, inputs.profiles.absorption);
+    return key;
+}
+
+const char *GetBakeServiceSourceName(BakeServiceSource source) {
+    switch (source) {
+    case BakeServiceSource::Baked:
+        return "baked";
+    case BakeServiceSource::Coalesced:
+        return "coalesced";
+    default:
+        return "cached";
+    }
+}
+
+std::shared_ptr<const CachedTransmittance> BakeService::Get(const BakeServiceInputs &inputs, BakeServiceSource &source) {
+    const std::string key = GetBakeServiceKey(inputs);
+    std::promise<std::shared_ptr<const CachedTransmittance>> promise;
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++stats_.requests;
+    const auto cached = cache_.find(key);
+    if (cached != cache_.end()) {
+        lru_.splice(lru_.begin(), lru_, cached->second);
+        ++stats_.cache_hits;
+        source = BakeServiceSource::Cached;
+        return *cached->second;
+    }
+    const auto baking = in_flight_.find(key);
+    if (baking != in_flight_.end()) {
+        const std::shared_future<std::shared_ptr<const CachedTransmittance>> future = baking->second;
+        ++stats_.coalesced;
+        source = BakeServiceSource::Coalesced;
+        // 在锁外等待，其他请求不受影响
+        lock.unlock();
+        return future.get();
+    }
+    in_flight_.emplace(key, promise.get_future().share());
+    ++stats_.bakes;
+    lock.unlock();
+
+    source = BakeServiceSource::Baked;
+    std::shared_ptr<CachedTransmittance> lut;
+    try {
+        lut = std::make_shared<CachedTransmittance>();
+        lut->key = key;
+        lut->image = inputs.float_kernel ?
+            BakeTransmittance<float>(inputs.atmosphere, inputs.profiles, inputs.width, inputs.height, inputs.settings,
+                thread_count_) :
+            BakeTransmittance<double>(inputs.atmosphere, inputs.profiles, inputs.width, inputs.height, inputs.settings,
+                thread_count_);
+    } catch (...) {
+        // 之后相同的请求重新烘焙，正在等待的请求得到同一异常
+        lock.lock();
+        in_flight_.erase(key);
+        lock.unlock();
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+    lock.lock();
+    in_flight_.erase(key);
+    lru_.push_front(lut);
+    cache_[key] = lru_.begin();
+    cached_bytes_ += lut->GetMemorySize();
+    EvictLocked(lut.get());
+    lock.unlock();
+    promise.set_value(lut);
+    return lut;
+}
+
+bool BakeService::GetSharedMemory(const std::shared_ptr<const CachedTransmittance> &lut, std::string &name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 共享内存只在持有 mutex_ 时创建，lut 的其余部分不再改变
+    CachedTransmittance &entry = const_cast<CachedTransmittance &>(*lut);
+    if (!entry.shared_memory) {
+        auto region = std::make_unique<SharedMemoryRegion>();
+        const size_t size = entry.image.texels.size() * sizeof(float);
+        if (!region->Create(GetSharedMemoryName("transmittance", next_shared_memory_id_++), size)) {
+            return false;
+        }
+        std::memcpy(region->GetData(), entry.image.texels.data(), size);
+        entry.shared_memory = std::move(region);
+        // 已被淘汰的结果不再计入
+        const auto cached = cache_.find(entry.key);
+        if (cached != cache_.end() && cached->second->get() == &entry) {
+            cached_bytes_ += size;
+            EvictLocked(&entry);
+        }
+    }
+    name = entry.shared_memory->GetName();
+    return true;
+}
+
+BakeServiceStats BakeService::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    BakeServiceStats stats = stats_;
+    stats.cached_luts = lru_.size();
+    stats.cached_bytes = cached_bytes_;
+    return stats;
+}
+
+void BakeService::EvictLocked(const CachedTransmittance *keep) {
+    auto oldest = lru_.end();
+    while (cached_bytes_ > max_bytes_ && oldest != lru_.begin()) {
+        --oldest;
+        if (oldest->get() == keep) {
+            continue;
+        }
+        cached_bytes_ -= (*oldest)->GetMemorySize();
+        cache_.erase((*oldest)->key);
+        oldest = lru_.erase(oldest);
+        ++stats_.evictions;
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "atmosphereParameters/densityProfile.h"
+#include "functions/integrator.h"
+#include "output/texture.h"
+#include "sharedMemory.h"
+
+// 决定烘焙结果的输入；输出格式等只影响写出的选项不在其中，不同输出格式的请求共用同一次烘焙
+struct BakeServiceInputs {
+    AtmosphereParameters atmosphere;
+    ExtendedDensityProfiles profiles;
+    int width;
+    int height;
+    IntegratorSettings settings;
+    bool float_kernel = false;
+};
+
+// 由所有输入逐位确定的键，浮点数以十六进制写出，相同的键一定得到相同的烘焙结果
+std::string GetBakeServiceKey(const BakeServiceInputs &inputs);
+
+// 请求的结果来自哪里
+enum class BakeServiceSource {
+    // 由这个请求烘焙
+    Baked,
+    // 等待了同时进行的相同请求的烘焙
+    Coalesced,
+    Cached,
+};
+
+const char *GetBakeServiceSourceName(BakeServiceSource source);
+
+struct CachedTransmittance {
+    std::string key;
+    TextureImage image;
+    // 第一次以共享内存返回时创建，见 BakeService::GetSharedMemory
+    std::unique_ptr<SharedMemoryRegion> shared_memory;
+
+    size_t GetMemorySize() const {
+        return image.texels.size() * sizeof(float) + (shared_memory ? shared_memory->GetSize() : 0);
+    }
+};
+
+struct BakeServiceStats {
+    uint64_t requests = 0;
+    uint64_t bakes = 0;
+    uint64_t coalesced = 0;
+    uint64_t cache_hits = 0;
+    uint64_t evictions = 0;
+    size_t cached_luts = 0;
+    size_t cached_bytes = 0;
+};
+
+// 多个工具共用的烘焙服务：相同输入的并发请求合并为一次烘焙，结果保存在按内存大小限制的 LRU 中
+// 所有成员函数都可以在多个线程上同时调用；被淘汰的结果在最后一个持有者释放时才销毁
+class BakeService {
+public:
+    BakeService(size_t max_bytes, int thread_count) : max_bytes_(max_bytes), thread_count_(thread_count) {}
+
+    // 返回 inputs 的烘焙结果，必要时烘焙或等待正在进行的相同烘焙
+    // 烘焙抛出异常（例如内存不足）时不缓存结果，异常会抛给这次烘焙的请求者以及所有等待它的请求
+    std::shared_ptr<const CachedTransmittance> Get(const BakeServiceInputs &inputs, BakeServiceSource &source);
+
+    // 将结果复制到共享内存（每个结果只复制一次）并返回其名字，内容为按行排列的 RGB float，与 TextureImage 相同
+    // 结果被淘汰后名字随之删除，客户端应在收到名字后立即映射
+    bool GetSharedMemory(const std::shared_ptr<const CachedTransmittance> &lut, std::string &name);
+
+    BakeServiceStats GetStats() const;
+
+private:
+    using LruList = std::list<std::shared_ptr<CachedTransmittance>>;
+
+    // 需要持有 mutex_，从最久未使用的开始淘汰直到不超过 max_bytes_，keep 总是保留
+    void EvictLocked(const CachedTransmittance *keep);
+
+    const size_t max_bytes_;
+    const int thread_count_;
+    mutable std::mutex mutex_;
+    // 最近使用的在前
+    LruList lru_;
+    std::unordered_map<std::string, LruList::iterator> cache_;
+    std::unordered_map<std::string, std::shared_future<std::shared_ptr<const CachedTransmittance>>> in_flight_;
+    size_t cached_bytes_ = 0;
+    uint64_t next_shared_memory_id_ = 0;
+    BakeServiceStats stats_;
+};
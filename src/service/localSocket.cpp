@@ -0,0 +1,187 @@
+#include "localSocket.h"
+
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <afunix.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr SocketHandle kInvalidSocket = static_cast<SocketHandle>(-1);
+
+// 客户端提前断开时不产生 SIGPIPE
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+void CloseSocket(SocketHandle socket) {
+#ifdef _WIN32
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+}
+
+#ifdef _WIN32
+// 进程内只需初始化一次 Winsock
+bool InitializeSockets() {
+    static const bool initialized = []() {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    return initialized;
+}
+#else
+bool InitializeSockets() {
+    return true;
+}
+#endif
+
+bool MakeAddress(const std::string &path, sockaddr_un &address) {
+    address = {};
+    if (!InitializeSockets() || path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+} // namespace
+
+LocalConnection::~LocalConnection() {
+    if (IsValid()) {
+        CloseSocket(socket_);
+    }
+}
+
+LocalConnection::LocalConnection(LocalConnection &&other) noexcept :
+    socket_(std::exchange(other.socket_, kInvalidSocket)), buffer_(std::move(other.buffer_)) {}
+
+LocalConnection &LocalConnection::operator=(LocalConnection &&other) noexcept {
+    if (this != &other) {
+        if (IsValid()) {
+            CloseSocket(socket_);
+        }
+        socket_ = std::exchange(other.socket_, kInvalidSocket);
+        buffer_ = std::move(other.buffer_);
+    }
+    return *this;
+}
+
+bool LocalConnection::IsValid() const {
+    return socket_ != kInvalidSocket;
+}
+
+bool LocalConnection::ReadLine(std::string &line) {
+    for (;;) {
+        const size_t end = buffer_.find('\n');
+        if (end != std::string::npos) {
+            line = buffer_.substr(0, end);
+            buffer_.erase(0, end + 1);
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            return true;
+        }
+        char chunk[1024];
+        const int received = static_cast<int>(recv(socket_, chunk, sizeof(chunk), 0));
+        if (received <= 0) {
+            return false;
+        }
+        buffer_.append(chunk, received);
+    }
+}
+
+bool LocalConnection::Write(const std::string &text) {
+    size_t sent = 0;
+    while (sent < text.size()) {
+        const int result = static_cast<int>(send(socket_, text.data() + sent, static_cast<int>(text.size() - sent), kSendFlags));
+        if (result <= 0) {
+            return false;
+        }
+        sent += result;
+    }
+    return true;
+}
+
+void LocalConnection::Shutdown() {
+    if (!IsValid()) {
+        return;
+    }
+#ifdef _WIN32
+    shutdown(socket_, SD_BOTH);
+#else
+    shutdown(socket_, SHUT_RDWR);
+#endif
+}
+
+LocalConnection ConnectLocalSocket(const std::string &path) {
+    sockaddr_un address;
+    if (!MakeAddress(path, address)) {
+        return LocalConnection();
+    }
+    const SocketHandle socket_handle = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (socket_handle == kInvalidSocket) {
+        return LocalConnection();
+    }
+    if (connect(socket_handle, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+        CloseSocket(socket_handle);
+        return LocalConnection();
+    }
+    return LocalConnection(socket_handle);
+}
+
+LocalSocketServer::~LocalSocketServer() {
+    Close();
+}
+
+bool LocalSocketServer::Listen(const std::string &path) {
+    sockaddr_un address;
+    if (!MakeAddress(path, address)) {
+        return false;
+    }
+    std::remove(path.c_str());
+    const SocketHandle socket_handle = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (socket_handle == kInvalidSocket) {
+        return false;
+    }
+    if (bind(socket_handle, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+        listen(socket_handle, SOMAXCONN) != 0) {
+        CloseSocket(socket_handle);
+        return false;
+    }
+    socket_ = socket_handle;
+    path_ = path;
+    return true;
+}
+
+LocalConnection LocalSocketServer::Accept() {
+    if (socket_ == kInvalidSocket) {
+        return LocalConnection();
+    }
+    const SocketHandle connection = accept(socket_, nullptr, nullptr);
+    return connection == kInvalidSocket ? LocalConnection() : LocalConnection(connection);
+}
+
+void LocalSocketServer::Close() {
+    if (socket_ == kInvalidSocket) {
+        return;
+    }
+    CloseSocket(socket_);
+    socket_ = kInvalidSocket;
+    std::remove(path_.c_str());
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Unix domain socket 上按行收发文本的连接与监听端，Windows 10 起同样支持 AF_UNIX
+#ifdef _WIN32
+using SocketHandle = uintptr_t;
+#else
+using SocketHandle = int;
+#endif
+
+class LocalConnection {
+public:
+    LocalConnection() = default;
+    explicit LocalConnection(SocketHandle socket) : socket_(socket) {}
+    ~LocalConnection();
+
+    LocalConnection(LocalConnection &&other) noexcept;
+    LocalConnection &operator=(LocalConnection &&other) noexcept;
+    LocalConnection(const LocalConnection &) = delete;
+    LocalConnection &operator=(const LocalConnection &) = delete;
+
+    bool IsValid() const;
+
+    // 读取一行，不含结尾的 \n（与 \r），连接关闭前没有读到 \n 时返回 false
+    bool ReadLine(std::string &line);
+    bool Write(const std::string &text);
+
+    // 关闭两个方向的传输，可以在其他线程上调用，阻塞在 ReadLine 中的线程随即返回 false
+    void Shutdown();
+
+private:
+    SocketHandle socket_ = static_cast<SocketHandle>(-1);
+    std::string buffer_;
+};
+
+// 连接到在 path 上监听的 LocalSocketServer，失败时返回无效的连接
+LocalConnection ConnectLocalSocket(const std::string &path);
+
+class LocalSocketServer {
+public:
+    LocalSocketServer() = default;
+    ~LocalSocketServer();
+
+    LocalSocketServer(const LocalSocketServer &) = delete;
+    LocalSocketServer &operator=(const LocalSocketServer &) = delete;
+
+    // 在 path 上监听，path 已存在时先删除（上一次运行留下的 socket 文件）
+    bool Listen(const std::string &path);
+
+    // 等待下一个连接，失败时返回无效的连接
+    LocalConnection Accept();
+
+    // 关闭监听端并删除 socket 文件
+    void Close();
+
+private:
+    SocketHandle socket_ = static_cast<SocketHandle>(-1);
+    std::string path_;
+};
@@ -0,0 +1,76 @@
+#include "sharedMemory.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+std::string GetSharedMemoryName(const std::string &prefix, uint64_t id) {
+#ifdef _WIN32
+    return "Local\\" + prefix + "-" + std::to_string(_getpid()) + "-" + std::to_string(id);
+#else
+    return "/" + prefix + "-" + std::to_string(getpid()) + "-" + std::to_string(id);
+#endif
+}
+
+SharedMemoryRegion::~SharedMemoryRegion() {
+    if (!data_) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+    CloseHandle(handle_);
+#else
+    munmap(data_, size_);
+    shm_unlink(name_.c_str());
+#endif
+}
+
+bool SharedMemoryRegion::Create(const std::string &name, size_t size) {
+    if (data_ || size == 0) {
+        return false;
+    }
+#ifdef _WIN32
+    const unsigned long long size64 = size;
+    HANDLE handle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+        static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64 & 0xffffffffu), name.c_str());
+    if (!handle) {
+        return false;
+    }
+    if (GetLastError() == ERROR_ALREADY_EXISTS) {
+        CloseHandle(handle);
+        return false;
+    }
+    void *data = MapViewOfFile(handle, FILE_MAP_WRITE, 0, 0, size);
+    if (!data) {
+        CloseHandle(handle);
+        return false;
+    }
+    handle_ = handle;
+#else
+    const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    void *data = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(size)) == 0) {
+        data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    // 映射建立后不再需要文件描述符
+    close(fd);
+    if (data == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return false;
+    }
+#endif
+    name_ = name;
+    data_ = data;
+    size_ = size;
+    return true;
+}
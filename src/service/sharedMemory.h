@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 本进程的第 id 个共享内存的名字，加上平台需要的前缀与进程号，不同进程的名字不会冲突
+std::string GetSharedMemoryName(const std::string &prefix, uint64_t id);
+
+// 有名字的共享内存，其他进程可以按名字只读映射：
+// POSIX 上为 shm_open 的对象，名字以 / 开头；Windows 上为 CreateFileMapping 的 Local\ 对象
+// 析构时删除名字（Windows 上为关闭句柄），已经映射的进程仍可以读取
+class SharedMemoryRegion {
+public:
+    SharedMemoryRegion() = default;
+    ~SharedMemoryRegion();
+
+    SharedMemoryRegion(const SharedMemoryRegion &) = delete;
+    SharedMemoryRegion &operator=(const SharedMemoryRegion &) = delete;
+
+    // 创建 size 字节、名为 name 的共享内存并映射为可写
+    bool Create(const std::string &name, size_t size);
+
+    void *GetData() const {
+        return data_;
+    }
+
+    size_t GetSize() const {
+        return size_;
+    }
+
+    const std::string &GetName() const {
+        return name_;
+    }
+
+private:
+    std::string name_;
+    void *data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void *handle_ = nullptr;
+#endif
+};